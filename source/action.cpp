@@ -22,6 +22,8 @@
 #include "map.h"
 #include "editor.h"
 #include "gui.h"
+#include "tile_delta.h"
+#include "undo_journal.h"
 
 Change::Change() : type(CHANGE_NONE), data(nullptr)
 {
@@ -62,6 +64,10 @@ void Change::clear()
 			ASSERT(data);
 			delete reinterpret_cast<Tile*>(data);
 			break;
+		case CHANGE_TILE_DELTA:
+			ASSERT(data);
+			delete reinterpret_cast<TileDelta*>(data);
+			break;
 		case CHANGE_MOVE_HOUSE_EXIT:
 			ASSERT(data);
 			delete reinterpret_cast<HouseData*>(data);
@@ -84,11 +90,52 @@ void Change::clear()
 	data = nullptr;
 }
 
+const Position& Change::getTilePosition() const
+{
+	ASSERT(isTileChange());
+	if(type == CHANGE_TILE_DELTA) {
+		return reinterpret_cast<TileDelta*>(data)->getPosition();
+	}
+	return reinterpret_cast<Tile*>(data)->getPosition();
+}
+
+Tile* Change::takeTile(BaseMap& map)
+{
+	ASSERT(isTileChange());
+	Tile* tile;
+	if(type == CHANGE_TILE_DELTA) {
+		TileDelta* delta = reinterpret_cast<TileDelta*>(data);
+		tile = delta->rebuild(map);
+		delete delta;
+	} else {
+		tile = reinterpret_cast<Tile*>(data);
+	}
+	type = CHANGE_NONE;
+	data = nullptr;
+	return tile;
+}
+
+void Change::storeTile(Tile* old_tile, const Tile* tile, bool encode)
+{
+	ASSERT(type == CHANGE_NONE && old_tile);
+	TileDelta* delta = encode ? TileDelta::Create(old_tile, tile) : nullptr;
+	if(delta) {
+		delete old_tile;
+		type = CHANGE_TILE_DELTA;
+		data = delta;
+	} else {
+		type = CHANGE_TILE;
+		data = old_tile;
+	}
+}
+
 uint32_t Change::memsize() const
 {
 	uint32_t mem = sizeof(*this);
 	if(type == CHANGE_TILE) {
 		mem += reinterpret_cast<Tile*>(data)->memsize();
+	} else if(type == CHANGE_TILE_DELTA) {
+		mem += reinterpret_cast<TileDelta*>(data)->memsize();
 	}
 	return mem;
 }
@@ -111,7 +158,14 @@ Action::~Action()
 size_t Action::approx_memsize() const
 {
 	uint32_t mem = sizeof(*this);
-	mem += changes.size() * (sizeof(Change) + sizeof(Tile) + sizeof(Item) + 6/* approx overhead*/);
+	for(const Change* change : changes) {
+		if(change->getType() == CHANGE_TILE_DELTA) {
+			// Deltas hold few items, so they are cheap to count exactly
+			mem += change->memsize();
+		} else {
+			mem += sizeof(Change) + sizeof(Tile) + sizeof(Item) + 6/* approx overhead*/;
+		}
+	}
 	return mem;
 }
 
@@ -121,8 +175,8 @@ size_t Action::memsize() const
 	mem += sizeof(Change*) * 3 * changes.size();
 
 	for(const Change* change : changes) {
-		if(change && change->getType() == CHANGE_TILE) {
-			mem += reinterpret_cast<Tile*>(change->getData())->memsize();
+		if(change && change->isTileChange()) {
+			mem += change->memsize();
 		}
 	}
 
@@ -137,14 +191,10 @@ void Action::commit(DirtyList* dirty_list)
 
 	for (Change* change : changes) {
 		switch(change->getType()) {
-			case CHANGE_TILE: {
-				void** data = &change->data;
-				Tile* new_tile = reinterpret_cast<Tile*>(*data);
-				ASSERT(new_tile);
-
-				const Position& pos = new_tile->getPosition();
-
+			case CHANGE_TILE:
+			case CHANGE_TILE_DELTA: {
 				if(editor.IsLiveClient()) {
+					const Position& pos = change->getTilePosition();
 					QTreeNode* node = map.getLeaf(pos.x, pos.y);
 					if(!node || !node->isVisible(pos.z > rme::MapGroundLayer)) {
 						change->clear();
@@ -152,6 +202,10 @@ void Action::commit(DirtyList* dirty_list)
 					}
 				}
 
+				Tile* new_tile = change->takeTile(map);
+				ASSERT(new_tile);
+
+				const Position& pos = new_tile->getPosition();
 				Tile* old_tile = map.swapTile(pos, new_tile);
 				TileLocation* location = new_tile->getLocation();
 
@@ -192,10 +246,8 @@ void Action::commit(DirtyList* dirty_list)
 					//oldtile->update();
 					if(old_tile->isSelected())
 						selection.removeInternal(old_tile);
-
-					*data = old_tile;
 				} else {
-					*data = map.allocator(location);
+					old_tile = map.allocator(location);
 					if(new_tile->getHouseID() != 0) {
 						// oooooomggzzz we need to add it to the appropriate house!
 						House* house = map.houses.getHouse(new_tile->getHouseID());
@@ -210,6 +262,9 @@ void Action::commit(DirtyList* dirty_list)
 				}
 				new_tile->modify();
 
+				// Remote actions are thrown away right after, don't bother encoding
+				change->storeTile(old_tile, new_tile, type != ACTION_REMOTE);
+
 				// Update client dirty list
 				if(editor.IsLiveClient() && dirty_list && type != ACTION_REMOTE) {
 					dirty_list->AddChange(change);
@@ -270,13 +325,10 @@ void Action::undo(DirtyList* dirty_list)
 
 	for (Change* change : changes) {
 		switch(change->getType()) {
-			case CHANGE_TILE: {
-				void** data = &change->data;
-				Tile* old_tile = reinterpret_cast<Tile*>(*data);
-				ASSERT(old_tile);
-				const Position& pos = old_tile->getPosition();
-
+			case CHANGE_TILE:
+			case CHANGE_TILE_DELTA: {
 				if(editor.IsLiveClient()) {
+					const Position& pos = change->getTilePosition();
 					QTreeNode* node = map.getLeaf(pos.x, pos.y);
 					if(!node || !node->isVisible(pos.z > rme::MapGroundLayer)) {
 						// Delete all changes that affect tiles outside our view
@@ -285,6 +337,10 @@ void Action::undo(DirtyList* dirty_list)
 					}
 				}
 
+				Tile* old_tile = change->takeTile(map);
+				ASSERT(old_tile);
+
+				const Position& pos = old_tile->getPosition();
 				Tile* new_tile = map.swapTile(pos, old_tile);
 
 				// Update server side change list (for broadcast)
@@ -324,7 +380,7 @@ void Action::undo(DirtyList* dirty_list)
 				} else if(new_tile->spawn) {
 					map.removeSpawn(new_tile);
 				}
-				*data = new_tile;
+				change->storeTile(new_tile, old_tile, type != ACTION_REMOTE);
 
 				// Update client dirty list
 				if(editor.IsLiveClient() && dirty_list && type != ACTION_REMOTE) {
@@ -380,7 +436,12 @@ BatchAction::BatchAction(Editor& editor, ActionIdentifier ident) :
 	editor(editor),
     timestamp(0),
     memory_size(0),
-    type(ident)
+    type(ident),
+    spilled(false),
+    journal_count(0),
+    journal_size(0),
+    journal_offset(0),
+    page_in_time(-1)
 {
     ////
 }
@@ -396,6 +457,10 @@ BatchAction::~BatchAction()
 
 size_t BatchAction::memsize(bool recalc) const
 {
+	if(spilled) {
+		return sizeof(*this);
+	}
+
 	// Expensive operation, only evaluate once (won't change anyways)
 	if(!recalc && memory_size > 0) {
 		return memory_size;
@@ -485,7 +550,7 @@ void BatchAction::merge(BatchAction* other)
 }
 
 ActionQueue::ActionQueue(Editor& editor) :
-	current(0), memory_size(0), editor(editor)
+	current(0), memory_size(0), editor(editor), journal(new UndoJournal())
 {
 	////
 }
@@ -496,6 +561,7 @@ ActionQueue::~ActionQueue()
 		delete batch;
 	}
 	actions.clear();
+	delete journal;
 }
 
 Action* ActionQueue::createAction(ActionIdentifier identifier) const
@@ -546,12 +612,15 @@ void ActionQueue::addBatch(BatchAction* batch, int stacking_delay)
 		memory_size -= actions.back()->memsize();
 		BatchAction* todelete = actions.back();
 		actions.pop_back();
-		delete todelete;
+		destroyBatch(todelete);
 	}
 
-	while(memory_size > size_t(1024 * 1024 * g_settings.getInteger(Config::UNDO_MEM_SIZE)) && !actions.empty()) {
+	spillBatches();
+
+	// Spilled batches cost next to nothing, only the undo size limits them
+	while(memory_size > size_t(1024 * 1024 * g_settings.getInteger(Config::UNDO_MEM_SIZE)) && !actions.empty() && !actions.front()->isSpilled()) {
 		memory_size -= actions.front()->memsize();
-		delete actions.front();
+		destroyBatch(actions.front());
 		actions.pop_front();
 		current--;
 	}
@@ -560,14 +629,14 @@ void ActionQueue::addBatch(BatchAction* batch, int stacking_delay)
 		memory_size -= actions.front()->memsize();
 		BatchAction* todelete = actions.front();
 		actions.pop_front();
-		delete todelete;
+		destroyBatch(todelete);
 		current--;
 	}
 
 	do {
 		if(!actions.empty()) {
 			BatchAction* lastAction = actions.back();
-			if(lastAction->type == batch->type && g_settings.getInteger(Config::GROUP_ACTIONS) && time(nullptr) - stacking_delay < lastAction->timestamp) {
+			if(lastAction->type == batch->type && !lastAction->isSpilled() && g_settings.getInteger(Config::GROUP_ACTIONS) && time(nullptr) - stacking_delay < lastAction->timestamp) {
 				lastAction->merge(batch);
 				lastAction->timestamp = time(nullptr);
 				memory_size -= lastAction->memsize();
@@ -617,9 +686,21 @@ bool ActionQueue::undo()
 	if(current > 0) {
 		current--;
 		BatchAction* batch = actions.at(current);
+		if(batch->isSpilled() && !pageIn(batch)) {
+			// Nothing before it can be undone either
+			for(size_t index = 0; index <= current; ++index) {
+				memory_size -= actions[index]->memsize();
+				destroyBatch(actions[index]);
+			}
+			actions.erase(actions.begin(), actions.begin() + current + 1);
+			current = 0;
+			g_gui.PopupDialog("Error", "Could not read the undo history back from disk, older actions can no longer be undone.", wxOK);
+			return false;
+		}
 		if(batch) {
 			batch->undo();
 		}
+		spillBatches();
 
 		// Update title
 		if(batch->isNoSelection() && editor.getMap().doChange()) {
@@ -634,10 +715,21 @@ bool ActionQueue::redo()
 {
 	if(current < actions.size()) {
 		BatchAction* batch = actions.at(current);
+		if(batch->isSpilled() && !pageIn(batch)) {
+			// Nothing after it can be redone either
+			while(actions.size() > current) {
+				memory_size -= actions.back()->memsize();
+				destroyBatch(actions.back());
+				actions.pop_back();
+			}
+			g_gui.PopupDialog("Error", "Could not read the undo history back from disk, newer actions can no longer be redone.", wxOK);
+			return false;
+		}
 		if(batch) {
 			batch->redo();
 		}
 		current++;
+		spillBatches();
 
 		// Update title
 		if(batch->isNoSelection() && editor.getMap().doChange()) {
@@ -664,7 +756,56 @@ void ActionQueue::clear()
 		delete batch;
 	}
 	actions.clear();
+	journal->clear();
 	current = 0;
+	memory_size = 0;
+}
+
+void ActionQueue::spillBatches()
+{
+	if(!g_settings.getBoolean(Config::UNDO_JOURNAL)) {
+		return;
+	}
+
+	const size_t limit = size_t(1024 * 1024 * g_settings.getInteger(Config::UNDO_MEM_SIZE));
+	for(size_t index = 0; index < actions.size() && memory_size > limit; ++index) {
+		// Keep the next batch to undo and the next to redo at hand
+		if(index + 1 == current || index == current) {
+			continue;
+		}
+
+		BatchAction* batch = actions[index];
+		if(batch->isSpilled()) {
+			continue;
+		}
+
+		const size_t size = batch->memsize();
+		if(!journal->spill(*batch)) {
+			break;
+		}
+		memory_size -= size;
+		memory_size += batch->memsize();
+	}
+}
+
+bool ActionQueue::pageIn(BatchAction* batch)
+{
+	wxStopWatch watch;
+	const size_t size = batch->memsize();
+	if(!journal->load(*this, *batch)) {
+		return false;
+	}
+
+	batch->page_in_time = watch.Time();
+	memory_size -= size;
+	memory_size += batch->memsize(true);
+	return true;
+}
+
+void ActionQueue::destroyBatch(BatchAction* batch)
+{
+	journal->discard(*batch);
+	delete batch;
 }
 
 wxString ActionQueue::createLabel(ActionIdentifier type)
@@ -23,6 +23,7 @@
 #include <deque>
 
 class Editor;
+class BaseMap;
 class Tile;
 class House;
 class Waypoint;
@@ -30,6 +31,7 @@ class Change;
 class Action;
 class BatchAction;
 class ActionQueue;
+class UndoJournal;
 
 enum ActionIdentifier {
 	ACTION_MOVE,
@@ -52,6 +54,7 @@ enum ActionIdentifier {
 enum ChangeType {
 	CHANGE_NONE,
 	CHANGE_TILE,
+	CHANGE_TILE_DELTA, // A TileDelta against the tile on the map
 	CHANGE_MOVE_HOUSE_EXIT,
 	CHANGE_MOVE_WAYPOINT,
 };
@@ -82,13 +85,23 @@ public:
 	ChangeType getType() const noexcept { return type; }
 	void* getData() const noexcept { return data; }
 
+	bool isTileChange() const noexcept { return type == CHANGE_TILE || type == CHANGE_TILE_DELTA; }
+	const Position& getTilePosition() const;
+
 	uint32_t memsize() const;
 
 private:
+	// Hands over the tile to put on the map, leaving the change empty
+	Tile* takeTile(BaseMap& map);
+	// Keeps what it takes to put old_tile back, tile is what replaced it.
+	// Without encode the whole tile is kept.
+	void storeTile(Tile* old_tile, const Tile* tile, bool encode);
+
 	ChangeType type;
 	void* data;
 
 	friend class Action;
+	friend class UndoJournal;
 };
 
 typedef std::vector<Change*> ChangeList;
@@ -156,6 +169,7 @@ protected:
 	ActionIdentifier type;
 
 	friend class ActionQueue;
+	friend class UndoJournal;
 };
 
 typedef std::vector<Action*> ActionVector;
@@ -169,12 +183,18 @@ public:
 
 	// Get memory footprint
 	size_t memsize(bool resize = false) const;
-	size_t size() const noexcept { return batch.size(); }
-	bool empty() const noexcept { return batch.empty(); }
+	size_t size() const noexcept { return spilled ? journal_count : batch.size(); }
+	bool empty() const noexcept { return size() == 0; }
 	ActionIdentifier getType() const noexcept { return type; }
 	const wxString& getLabel() const noexcept { return label; }
 	bool isNoSelection() const noexcept;
 
+	// The actions are in the undo journal, not in memory
+	bool isSpilled() const noexcept { return spilled; }
+	// Milliseconds it took to read the batch back from the undo journal,
+	// -1 if it never was
+	long getPageInTime() const noexcept { return page_in_time; }
+
 	virtual void addAction(Action* action);
 	virtual void addAndCommitAction(Action* action);
 
@@ -194,7 +214,14 @@ protected:
 	ActionVector batch;
 	wxString label;
 
+	bool spilled;
+	uint32_t journal_count;
+	uint32_t journal_size;
+	uint64_t journal_offset;
+	long page_in_time;
+
 	friend class ActionQueue;
+	friend class UndoJournal;
 };
 
 class ActionQueue
@@ -233,10 +260,17 @@ public:
 protected:
 	static wxString createLabel(ActionIdentifier type);
 
+	// Moves the oldest batches to the undo journal while over the memory limit
+	void spillBatches();
+	// Reads a spilled batch back, if that fails the history can't go past it
+	bool pageIn(BatchAction* batch);
+	void destroyBatch(BatchAction* batch);
+
 	size_t current;
 	size_t memory_size;
 	Editor& editor;
 	ActionList actions;
+	UndoJournal* journal;
 };
 
 #endif
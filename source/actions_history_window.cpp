@@ -65,7 +65,13 @@ void HistoryListBox::OnDrawItem(wxDC& dc, const wxRect& rect, size_t index) cons
 	if(action) {
 		const wxBitmap& bitmap = getIconBitmap(action->getType());
 		dc.DrawBitmap(bitmap, rect.GetX() + 4, rect.GetY() + 4, true);
-		dc.DrawText(action->getLabel(), rect.GetX() + 28, rect.GetY() + 3);
+		wxString label = action->getLabel();
+		if(action->isSpilled()) {
+			label << " (on disk)";
+		} else if(action->getPageInTime() >= 0) {
+			label << wxString::Format(" (loaded in %ld ms)", action->getPageInTime());
+		}
+		dc.DrawText(label, rect.GetX() + 28, rect.GetY() + 3);
 	} else {
 		dc.DrawBitmap(open_bitmap, rect.GetX() + 4, rect.GetY() + 4, true);
 		dc.DrawText("Open Map", rect.GetX() + 28, rect.GetY() + 3);
@@ -34,9 +34,16 @@
 #include "map.h"
 #include "complexitem.h"
 #include "creature.h"
+#include "live_host.h"
 
 #include <wx/snglinst.h>
 
+#include <csignal>
+
+#ifdef __WINDOWS__
+#include <wx/msw/wrapwin.h>
+#endif
+
 #if defined(__LINUX__) || defined(__WINDOWS__)
 #include <GL/glut.h>
 #endif
@@ -87,7 +94,12 @@ BEGIN_EVENT_TABLE(MapScrollBar, wxScrollBar)
 	EVT_MOUSEWHEEL(MapScrollBar::OnWheel)
 END_EVENT_TABLE()
 
+#ifdef RME_TESTS
+// The tests bring their own main()
+wxIMPLEMENT_APP_NO_MAIN(Application);
+#else
 wxIMPLEMENT_APP(Application);
+#endif
 
 Application::~Application()
 {
@@ -113,6 +125,12 @@ bool Application::OnInit()
 	wxAppConsole::SetInstance(this);
 	wxArtProvider::Push(new ArtProvider());
 
+	m_live_host = nullptr;
+	m_startup = false;
+	if(ParseCommandLineServe()) {
+		return StartLiveHost();
+	}
+
 #if defined(__LINUX__) || defined(__WINDOWS__)
 	int argc = 1;
 	char* argv[1] = { wxString(this->argv[0]).char_str() };
@@ -332,6 +350,14 @@ void Application::Unload()
 
 int Application::OnExit()
 {
+	if(m_live_host) {
+		delete m_live_host;
+		m_live_host = nullptr;
+
+		g_gui.UnloadVersion();
+		ClientVersion::unloadVersions();
+	}
+
 #ifdef _USE_PROCESS_COM
 	wxDELETE(m_proc_server);
 	wxDELETE(m_single_instance_checker);
@@ -353,6 +379,103 @@ bool Application::ParseCommandLineMap(wxString& fileName)
 	return false;
 }
 
+bool Application::ParseCommandLineServe()
+{
+	for(int i = 1; i < argc; ++i) {
+		if(wxString(argv[i]) == "--serve") {
+			return true;
+		}
+	}
+	return false;
+}
+
+#ifdef __WINDOWS__
+static BOOL WINAPI OnServeConsoleEvent(DWORD type)
+{
+	// Runs on its own thread, the main loop has to do the saving
+	wxTheApp->CallAfter([]() { wxTheApp->ExitMainLoop(); });
+	if(type == CTRL_CLOSE_EVENT || type == CTRL_LOGOFF_EVENT || type == CTRL_SHUTDOWN_EVENT) {
+		// The process is killed as soon as this returns, hold it until the main thread exits
+		Sleep(INFINITE);
+	}
+	return TRUE;
+}
+#else
+static void OnServeSignal(int)
+{
+	wxTheApp->ExitMainLoop();
+}
+#endif
+
+bool Application::StartLiveHost()
+{
+	wxString fileName;
+	wxString name = "RME Live Server";
+	wxString password;
+	long port = 31313;
+	long autosave = 5;
+
+	for(int i = 1; i < argc; ++i) {
+		wxString arg(argv[i]);
+		wxString value = i + 1 < argc ? wxString(argv[i + 1]) : wxString();
+		if(arg == "--serve") {
+			fileName = value;
+		} else if(arg == "--port") {
+			value.ToLong(&port);
+		} else if(arg == "--password") {
+			password = value;
+		} else if(arg == "--name") {
+			name = value;
+		} else if(arg == "--autosave") {
+			value.ToLong(&autosave);
+		} else {
+			continue;
+		}
+		++i;
+	}
+
+#ifdef __WINDOWS__
+	// The editor is a GUI program, borrow the console it was started from
+	if(AttachConsole(ATTACH_PARENT_PROCESS)) {
+		freopen("CONOUT$", "w", stdout);
+		freopen("CONOUT$", "w", stderr);
+	}
+#endif
+
+	if(fileName.empty()) {
+		std::cout << "Usage: rme --serve map.otbm [--port N] [--password P] [--name N] [--autosave minutes]" << std::endl;
+		return false;
+	}
+
+	// Settings are read but never saved, the server must not change the user's editor
+	g_settings.load();
+	FixVersionDiscrapencies();
+	ClientVersion::loadVersions();
+
+	m_live_host = newd LiveHost();
+	if(!m_live_host->start(FileName(fileName), port, name, password, autosave)) {
+		std::cout << "Could not start the live server: " << nstr(m_live_host->getLastError()) << std::endl;
+		delete m_live_host;
+		m_live_host = nullptr;
+
+		g_gui.UnloadVersion();
+		ClientVersion::unloadVersions();
+		return false;
+	}
+
+	// Save and disconnect everyone on Ctrl+C or when the service is stopped
+#ifdef __WINDOWS__
+	SetConsoleCtrlHandler(OnServeConsoleEvent, TRUE);
+#else
+	SetSignalHandler(SIGINT, OnServeSignal);
+	SetSignalHandler(SIGTERM, OnServeSignal);
+#endif
+
+	// No windows are ever opened, the event loop runs until one of the events above
+	SetExitOnFrameDelete(false);
+	return true;
+}
+
 MainFrame::MainFrame(const wxString& title, const wxPoint& pos, const wxSize& size) :
 	wxFrame((wxFrame *)nullptr, -1, title, pos, size, wxDEFAULT_FRAME_STYLE)
 {
@@ -32,6 +32,7 @@ class Creature;
 
 class MainFrame;
 class MapWindow;
+class LiveHost;
 class wxEventLoopBase;
 class wxSingleInstanceChecker;
 
@@ -50,6 +51,10 @@ private:
     wxString m_file_to_open;
 	void FixVersionDiscrapencies();
 	bool ParseCommandLineMap(wxString& fileName);
+	bool ParseCommandLineServe();
+	bool StartLiveHost();
+
+	LiveHost* m_live_host;
 
 	virtual void OnFatalException();
 
@@ -45,9 +45,9 @@ void BaseMap::clear(bool del)
 	}
 }
 
-void BaseMap::clearVisible(uint32_t mask)
+void BaseMap::clearVisible(uint32_t client)
 {
-	root.clearVisible(mask);
+	root.clearVisible(client);
 }
 
 Tile* BaseMap::createTile(int x, int y, int z)
@@ -118,7 +118,8 @@ void BaseMap::setTile(int x, int y, int z, Tile* new_tile, bool remove)
 	Tile* old_tile = leaf->setTile(x, y, z, new_tile);
 
 	if ((remove && old_tile) || new_tile)
-		updateUniqueIds(remove ? old_tile : nullptr, new_tile);
+		updateIndexes(remove ? old_tile : nullptr, new_tile);
+	tileChanged(x, y, z);
 
 	if (remove) {
 		delete old_tile;
@@ -149,7 +150,8 @@ Tile* BaseMap::swapTile(int x, int y, int z, Tile* new_tile)
 	Tile* old_tile = leaf->setTile(x, y, z, new_tile);
 
 	if (old_tile || new_tile)
-		updateUniqueIds(old_tile, new_tile);
+		updateIndexes(old_tile, new_tile);
+	tileChanged(x, y, z);
 
 	return old_tile;
 }
@@ -188,8 +190,14 @@ MapIterator::MapIterator(const MapIterator& other)
 
 MapIterator BaseMap::begin()
 {
+	return begin(&root);
+}
+
+MapIterator BaseMap::begin(QTreeNode* region)
+{
+	ASSERT(region && !region->isLeaf);
 	MapIterator it(this);
-	it.nodestack.push_back(MapIterator::NodeIndex(&root));
+	it.nodestack.push_back(MapIterator::NodeIndex(region));
 
 	while(true) {
 		MapIterator::NodeIndex& current = it.nodestack.back();
@@ -237,6 +245,31 @@ MapIterator BaseMap::begin()
 	return end();
 }
 
+void BaseMap::getRegions(std::vector<QTreeNode*>& regions, size_t count)
+{
+	regions.assign(1, &root);
+
+	// All leaves are at the same depth, so splitting every region one level
+	// at a time keeps them in iteration order
+	while(regions.size() < count) {
+		std::vector<QTreeNode*> children;
+		for(QTreeNode* region : regions) {
+			for(QTreeNode* child : region->child) {
+				if(child) {
+					if(child->isLeaf) {
+						return;
+					}
+					children.push_back(child);
+				}
+			}
+		}
+		if(children.empty()) {
+			return;
+		}
+		regions.swap(children);
+	}
+}
+
 MapIterator BaseMap::end()
 {
 	MapIterator it(this);
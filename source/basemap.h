@@ -83,6 +83,13 @@ public:
 	void clear(bool del = true);
 	MapIterator begin();
 	MapIterator end();
+	// Iterates over the tiles below one node of the tree only
+	MapIterator begin(QTreeNode* region);
+
+	// Splits the tree into at least count disjoint regions, if it is deep
+	// enough. Iterating over them in order visits tiles in the same order as
+	// iterating over the whole map.
+	void getRegions(std::vector<QTreeNode*>& regions, size_t count);
 	uint64_t size() const noexcept { return tilecount; }
 
 	// these functions take a position and returns a tile on the map
@@ -110,8 +117,8 @@ public:
 	Tile* swapTile(int x, int y, int z, Tile* new_tile);
 	Tile* swapTile(const Position& position, Tile* new_tile);
 
-	// Clears the visiblity according to the mask passed
-	void clearVisible(uint32_t mask);
+	// Forgets which nodes a live client has been sent
+	void clearVisible(uint32_t client);
 
 	uint64_t getTileCount() const noexcept { return tilecount; }
 
@@ -119,7 +126,9 @@ public:
 	MapAllocator allocator;
 
 protected:
-	virtual void updateUniqueIds(Tile* old_tile, Tile* new_tile) { }
+	virtual void updateIndexes(Tile* old_tile, Tile* new_tile) { }
+	// Called whenever the tile at a position is replaced
+	virtual void tileChanged(int x, int y, int z) { }
 
 	uint64_t tilecount;
 
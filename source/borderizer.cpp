@@ -0,0 +1,195 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "borderizer.h"
+#include "basemap.h"
+#include "ground_brush.h"
+#include "threads.h"
+#include "tile.h"
+
+#include <algorithm>
+
+namespace {
+	// Jobs of a few leaves keep the threads from fighting over the job counter
+	const size_t LeavesPerJob = 64;
+
+	uint64_t getLeafKey(int x, int y, int z)
+	{
+		return (static_cast<uint64_t>(z) << 40) | (static_cast<uint64_t>(y >> 2) << 20) | static_cast<uint64_t>(x >> 2);
+	}
+}
+
+void Borderizer::addChanged(const Position& position)
+{
+	for(int y = position.y - 1; y <= position.y + 1; ++y) {
+		for(int x = position.x - 1; x <= position.x + 1; ++x) {
+			addTile(Position(x, y, position.z));
+		}
+	}
+}
+
+void Borderizer::addTile(const Position& position)
+{
+	if(position.x < 0 || position.y < 0 || position.x > 0xFFFF || position.y > 0xFFFF ||
+			position.z < rme::MapMinLayer || position.z > rme::MapMaxLayer) {
+		return;
+	}
+	leaves[getLeafKey(position.x, position.y, position.z)] |= static_cast<uint16_t>(1 << ((position.y & 3) * 4 + (position.x & 3)));
+}
+
+std::vector<Borderizer::Leaf> Borderizer::getLeaves() const
+{
+	std::vector<std::pair<uint64_t, uint16_t>> sorted(leaves.begin(), leaves.end());
+	std::sort(sorted.begin(), sorted.end());
+
+	std::vector<Leaf> result;
+	result.reserve(sorted.size());
+	for(const auto& entry : sorted) {
+		Leaf leaf;
+		leaf.x = static_cast<int>(entry.first & 0xFFFFF) * 4;
+		leaf.y = static_cast<int>((entry.first >> 20) & 0xFFFFF) * 4;
+		leaf.z = static_cast<int>(entry.first >> 40);
+		leaf.tiles = entry.second;
+		result.push_back(leaf);
+	}
+	return result;
+}
+
+template <typename Function>
+void Borderizer::foreachTile(const std::vector<Leaf>& leaves, int threadcount, const std::function<void(int)>& progress, Function function)
+{
+	const size_t job_count = (leaves.size() + LeavesPerJob - 1) / LeavesPerJob;
+	std::function<void(size_t)> report;
+	if(progress) {
+		report = [&](size_t done) { progress(static_cast<int>(100 * done / job_count)); };
+	}
+
+	RunJobs(job_count, std::max(threadcount, 1), [&](size_t job) {
+		const size_t end = std::min(leaves.size(), (job + 1) * LeavesPerJob);
+		for(size_t index = job * LeavesPerJob; index < end; ++index) {
+			const Leaf& leaf = leaves[index];
+
+			// Ground brushes of the leaf and the tiles around it, looked up a leaf at a time
+			GroundBrush* grounds[6][6] = {};
+			Floor* center = nullptr;
+			for(int ly = -1; ly <= 1; ++ly) {
+				for(int lx = -1; lx <= 1; ++lx) {
+					const int base_x = leaf.x + lx * 4;
+					const int base_y = leaf.y + ly * 4;
+					if(base_x < 0 || base_y < 0) {
+						continue;
+					}
+
+					QTreeNode* node = map.getLeaf(base_x, base_y);
+					Floor* floor = node ? node->getFloor(leaf.z) : nullptr;
+					if(!floor) {
+						continue;
+					}
+					if(lx == 0 && ly == 0) {
+						center = floor;
+					}
+
+					for(int ty = 0; ty < 4; ++ty) {
+						const int gy = ly * 4 + ty + 1;
+						if(gy < 0 || gy >= 6) {
+							continue;
+						}
+						for(int tx = 0; tx < 4; ++tx) {
+							const int gx = lx * 4 + tx + 1;
+							if(gx < 0 || gx >= 6) {
+								continue;
+							}
+							if(const Tile* tile = floor->locs[tx * 4 + ty].get()) {
+								grounds[gy][gx] = tile->getGroundBrush();
+							}
+						}
+					}
+				}
+			}
+
+			size_t slot = 0;
+			for(int ty = 0; ty < 4; ++ty) {
+				for(int tx = 0; tx < 4; ++tx) {
+					if(!(leaf.tiles & (1 << (ty * 4 + tx)))) {
+						continue;
+					}
+
+					const int gx = tx + 1;
+					const int gy = ty + 1;
+					GroundBrush* const neighbours[8] = {
+						grounds[gy - 1][gx - 1], grounds[gy - 1][gx], grounds[gy - 1][gx + 1],
+						grounds[gy][gx - 1], grounds[gy][gx + 1],
+						grounds[gy + 1][gx - 1], grounds[gy + 1][gx], grounds[gy + 1][gx + 1]
+					};
+					Tile* tile = center ? center->locs[tx * 4 + ty].get() : nullptr;
+					function(index, slot++, tile, neighbours);
+				}
+			}
+		}
+	}, report);
+}
+
+void Borderizer::borderize(int threadcount, const std::function<void(int)>& progress)
+{
+	std::vector<Leaf> sorted = getLeaves();
+	foreachTile(sorted, threadcount, progress, [&](size_t, size_t, Tile* tile, GroundBrush* const neighbours[8]) {
+		if(tile) {
+			GroundBrush::doBorders(tile, neighbours);
+		}
+	});
+}
+
+std::vector<Borderizer::Copy> Borderizer::borderizeCopies(int threadcount)
+{
+	std::vector<Leaf> sorted = getLeaves();
+
+	// Creating tiles changes the tree, so it can't be done on the worker threads
+	std::vector<std::vector<Copy>> copies(sorted.size());
+	for(size_t index = 0; index < sorted.size(); ++index) {
+		const Leaf& leaf = sorted[index];
+		for(int bit = 0; bit < 16; ++bit) {
+			if(leaf.tiles & (1 << bit)) {
+				TileLocation* location = map.createTileL(leaf.x + (bit & 3), leaf.y + (bit >> 2), leaf.z);
+				const Tile* tile = location->get();
+				copies[index].push_back(Copy { tile, tile ? nullptr : map.allocator(location) });
+			}
+		}
+	}
+
+	// Tiles of a leaf come in bit order, the same order they were added in above
+	foreachTile(sorted, threadcount, nullptr, [&](size_t index, size_t slot, Tile*, GroundBrush* const neighbours[8]) {
+		Copy& copy = copies[index][slot];
+		if(copy.tile) {
+			copy.copy = copy.tile->deepCopy(map);
+		}
+		GroundBrush::doBorders(copy.copy, neighbours);
+	});
+
+	std::vector<Copy> result;
+	for(std::vector<Copy>& leaf_copies : copies) {
+		for(Copy& copy : leaf_copies) {
+			if(copy.tile || copy.copy->size() > 0) {
+				result.push_back(copy);
+			} else {
+				delete copy.copy;
+			}
+		}
+	}
+	return result;
+}
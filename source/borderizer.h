@@ -0,0 +1,73 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_BORDERIZER_H_
+#define RME_BORDERIZER_H_
+
+#include "position.h"
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+class BaseMap;
+class Tile;
+class TileLocation;
+
+// Puts new borders on a set of tiles. Tiles are collected per 4x4 leaf of
+// the map tree; every leaf looks up the grounds of the 6x6 tiles around it
+// at once instead of eight lookups per tile, and leaves are borderized on
+// worker threads. Bordering a tile only changes its own border items and only
+// reads the grounds around it, so leaves never get in each other's way.
+class Borderizer
+{
+public:
+	explicit Borderizer(BaseMap& map) : map(map) {}
+
+	// The ground at the position changed, so it and the tiles around it need new borders
+	void addChanged(const Position& position);
+	// Only the tile at the position needs new borders
+	void addTile(const Position& position);
+	bool empty() const noexcept { return leaves.empty(); }
+
+	// Borders the tiles where they are on the map, positions without a tile are skipped
+	void borderize(int threadcount, const std::function<void(int)>& progress = nullptr);
+
+	struct Copy {
+		const Tile* tile; // nullptr if there was no tile
+		Tile* copy;
+	};
+	// Borders copies of the tiles instead and leaves the map as it is. Positions
+	// without a tile get a new one, which is only returned if it got borders.
+	// The copies always come in the same order, sorted by leaf.
+	std::vector<Copy> borderizeCopies(int threadcount);
+
+private:
+	struct Leaf {
+		int x, y, z; // Top left tile
+		uint16_t tiles; // Bit (y & 3) * 4 + (x & 3) for every tile to border
+	};
+
+	std::vector<Leaf> getLeaves() const;
+	template <typename Function>
+	void foreachTile(const std::vector<Leaf>& leaves, int threadcount, const std::function<void(int)>& progress, Function function);
+
+	BaseMap& map;
+	std::unordered_map<uint64_t, uint16_t> leaves;
+};
+
+#endif
@@ -173,6 +173,17 @@ bool isTrueString(std::string& str)
 	return !isFalseString(str);
 }
 
+namespace {
+	// Scales a 32 bit draw of the mersenne twister to [low, high]
+	int scaleRandom(unsigned long value, int low, int high)
+	{
+		int range = high - low;
+
+		double dist = double(value) / 0xFFFFFFFF;
+		return low + std::min(range, int((1 + range) * dist));
+	}
+}
+
 int random(int low, int high)
 {
 	if(low == high) {
@@ -183,10 +194,16 @@ int random(int low, int high)
 		return low;
 	}
 
-	int range = high - low;
+	return scaleRandom(mt_randi(), low, high);
+}
+
+int random(MTRandom& generator, int low, int high)
+{
+	if(low >= high) {
+		return low;
+	}
 
-	double dist = double(mt_randi()) / 0xFFFFFFFF;
-	return low + std::min(range, int((1 + range) * dist));
+	return scaleRandom(generator.randi(), low, high);
 }
 
 int random(int high)
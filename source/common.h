@@ -65,6 +65,8 @@ bool isTrueString(std::string& str);
 // Generates a random number between low and high using the mersenne twister
 int random(int high);
 int random(int low, int high);
+// Same, drawing from a generator of its own
+int random(MTRandom& generator, int low, int high);
 
 // Unicode conversions
 std::wstring string2wstring(const std::string& utf8string);
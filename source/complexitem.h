@@ -40,10 +40,12 @@ public:
 
 	Item* deepCopy() const override;
 	Container* getContainer() override { return this; }
+	const Container* getContainer() const override { return this; }
 
 	Item* getItem(size_t index) const;
 
 	ItemVector& getVector() noexcept { return contents; }
+	const ItemVector& getVector() const noexcept { return contents; }
 	size_t getItemCount() const noexcept { return contents.size(); }
 	size_t getVolume() const noexcept { return getItemType().volume; }
 	double getWeight() noexcept { return getItemType().weight; }
@@ -35,6 +35,9 @@ constexpr int MapMaxLayer = 15;
 // The sea layer
 constexpr int MapGroundLayer = 7;
 
+// Clients a live server keeps apart in the tree nodes' visibility masks
+constexpr int MaxLiveClients = 64;
+
 constexpr int ClientMapWidth = 18;
 constexpr int ClientMapHeight = 14;
 
@@ -21,6 +21,7 @@
 #include "editor.h"
 #include "gui.h"
 #include "creature.h"
+#include "borderizer.h"
 
 CopyBuffer::CopyBuffer() :
 	tiles(newd BaseMap())
@@ -127,7 +128,7 @@ void CopyBuffer::cut(Editor& editor, int floor)
 	BatchAction* batch = editor.createBatch(ACTION_CUT_TILES);
 	Action* action = editor.createAction(batch);
 
-	PositionList tilestoborder;
+	Borderizer borderizer(map);
 
 	for(Tile* tile : editor.getSelection()) {
 		tile_count++;
@@ -170,37 +171,20 @@ void CopyBuffer::cut(Editor& editor, int floor)
 		}
 
 		if(g_settings.getInteger(Config::USE_AUTOMAGIC)) {
-			for(int y = -1; y <= 1; y++)
-				for(int x = -1; x <= 1; x++)
-					tilestoborder.push_back(Position(tile->getX() + x, tile->getY() + y, tile->getZ()));
+			borderizer.addChanged(tile->getPosition());
 		}
 		action->addChange(newd Change(newtile));
 	}
 
 	batch->addAndCommitAction(action);
 
-	// Remove duplicates
-	tilestoborder.sort();
-	tilestoborder.unique();
-
 	if(g_settings.getInteger(Config::USE_AUTOMAGIC)) {
 		action = editor.createAction(batch);
-		for(PositionList::iterator it = tilestoborder.begin(); it != tilestoborder.end(); ++it) {
-			TileLocation* location = map.createTileL(*it);
-			if(location->get()) {
-				Tile* new_tile = location->get()->deepCopy(map);
-				new_tile->borderize(&map);
-				new_tile->wallize(&map);
-				action->addChange(newd Change(new_tile));
-			} else {
-				Tile* new_tile = map.allocator(location);
-				new_tile->borderize(&map);
-				if(new_tile->size()) {
-					action->addChange(newd Change(new_tile));
-				} else {
-					delete new_tile;
-				}
+		for(const Borderizer::Copy& copy : borderizer.borderizeCopies(g_settings.getInteger(Config::WORKER_THREADS))) {
+			if(copy.tile) {
+				copy.copy->wallize(&map);
 			}
+			action->addChange(newd Change(copy.copy));
 		}
 
 		batch->addAndCommitAction(action);
@@ -265,7 +249,7 @@ void CopyBuffer::paste(Editor& editor, const Position& toPosition)
 
 	if(g_settings.getInteger(Config::USE_AUTOMAGIC) && g_settings.getInteger(Config::BORDERIZE_PASTE)) {
 		action = editor.createAction(batchAction);
-		TileList borderize_tiles;
+		Borderizer borderizer(map);
 
 		// Go through all modified (selected) tiles (might be slow)
 		for(MapIterator it = tiles->begin(); it != tiles->end(); ++it) {
@@ -275,33 +259,30 @@ void CopyBuffer::paste(Editor& editor, const Position& toPosition)
 				continue;
 			}
 			// Go through all neighbours
-			Tile* t;
-			t = map.getTile(pos.x-1, pos.y-1, pos.z); if(t && !t->isSelected()) { borderize_tiles.push_back(t); add_me = true; }
-			t = map.getTile(pos.x  , pos.y-1, pos.z); if(t && !t->isSelected()) { borderize_tiles.push_back(t); add_me = true; }
-			t = map.getTile(pos.x+1, pos.y-1, pos.z); if(t && !t->isSelected()) { borderize_tiles.push_back(t); add_me = true; }
-			t = map.getTile(pos.x-1, pos.y  , pos.z); if(t && !t->isSelected()) { borderize_tiles.push_back(t); add_me = true; }
-			t = map.getTile(pos.x+1, pos.y  , pos.z); if(t && !t->isSelected()) { borderize_tiles.push_back(t); add_me = true; }
-			t = map.getTile(pos.x-1, pos.y+1, pos.z); if(t && !t->isSelected()) { borderize_tiles.push_back(t); add_me = true; }
-			t = map.getTile(pos.x  , pos.y+1, pos.z); if(t && !t->isSelected()) { borderize_tiles.push_back(t); add_me = true; }
-			t = map.getTile(pos.x+1, pos.y+1, pos.z); if(t && !t->isSelected()) { borderize_tiles.push_back(t); add_me = true; }
-			if(add_me) borderize_tiles.push_back(map.getTile(pos));
-		}
-		// Remove duplicates
-		borderize_tiles.sort();
-		borderize_tiles.unique();
-
-		for(Tile* tile : borderize_tiles) {
-			if(tile) {
-				Tile* newTile = tile->deepCopy(map);
-				newTile->borderize(&map);
-
-				if(tile->ground && tile->ground->isSelected()) {
-					newTile->selectGround();
+			for(int y = pos.y - 1; y <= pos.y + 1; ++y) {
+				for(int x = pos.x - 1; x <= pos.x + 1; ++x) {
+					if(x == pos.x && y == pos.y) {
+						continue;
+					}
+					Tile* t = map.getTile(x, y, pos.z);
+					if(t && !t->isSelected()) {
+						borderizer.addTile(t->getPosition());
+						add_me = true;
+					}
 				}
+			}
+			if(add_me && map.getTile(pos)) {
+				borderizer.addTile(pos);
+			}
+		}
 
-				newTile->wallize(&map);
-				action->addChange(newd Change(newTile));
+		for(const Borderizer::Copy& copy : borderizer.borderizeCopies(g_settings.getInteger(Config::WORKER_THREADS))) {
+			if(copy.tile && copy.tile->ground && copy.tile->ground->isSelected()) {
+				copy.copy->selectGround();
 			}
+
+			copy.copy->wallize(&map);
+			action->addChange(newd Change(copy.copy));
 		}
 
 		// Commit changes to map
@@ -54,6 +54,7 @@ public:
 	bool isNpc() const;
 
 	std::string getName() const;
+	const std::string& getTypeName() const noexcept { return type_name; }
 	CreatureBrush* getBrush() const;
 
 	int getSpawnTime() const noexcept { return spawntime; }
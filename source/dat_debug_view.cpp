@@ -101,6 +101,19 @@ DatDebugView::DatDebugView(wxWindow* parent) : wxPanel(parent)
 	item_list->SetMinSize(wxSize(470, 400));
 	sizer->Add(item_list, 1, wxEXPAND | wxALL, 2);
 
+	const TextureAtlas::Statistics atlas = g_gui.gfx.getAtlas().getStatistics();
+	const uint64_t lookups = atlas.hits + atlas.misses;
+	wxString atlas_info;
+	atlas_info << "Texture atlas: " << atlas.pages << " pages, "
+		<< (atlas.pages * atlas.page_bytes / (1024 * 1024)) << " of " << (atlas.budget / (1024 * 1024)) << " MB, "
+		<< atlas.used_slots << " sprites loaded\n";
+	atlas_info << "Hits: " << atlas.hits << ", misses: " << atlas.misses;
+	if(lookups > 0) {
+		atlas_info << wxString::Format(" (%.2f%% hit rate)", 100.0 * atlas.hits / lookups);
+	}
+	atlas_info << ", pages evicted: " << atlas.evictions;
+	sizer->Add(newd wxStaticText(this, wxID_ANY, atlas_info), 0, wxEXPAND | wxALL, 4);
+
 	SetSizerAndFit(sizer);
 	Centre(wxBOTH);
 }
@@ -26,7 +26,7 @@
 #define __RME_VERSION_MINOR__      8
 #define __RME_SUBVERSION__         0
 
-#define __LIVE_NET_VERSION__       5
+#define __LIVE_NET_VERSION__       6
 
 #define MAKE_VERSION_ID(major, minor, subversion) \
 	((major)      * 10000000 + \
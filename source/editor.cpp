@@ -38,6 +38,8 @@
 #include "live_server.h"
 #include "live_client.h"
 #include "live_action.h"
+#include "borderizer.h"
+#include "threads.h"
 
 Editor::Editor(CopyBuffer& copybuffer) :
 	live_server(nullptr),
@@ -47,6 +49,8 @@ Editor::Editor(CopyBuffer& copybuffer) :
 	copybuffer(copybuffer),
 	replace_brush(nullptr)
 {
+	map.setItemIndexEnabled(g_settings.getBoolean(Config::ITEM_INDEX));
+
 	wxString error;
 	wxArrayString warnings;
 	bool ok = true;
@@ -96,6 +100,8 @@ Editor::Editor(CopyBuffer& copybuffer, const FileName& fn) :
 	copybuffer(copybuffer),
 	replace_brush(nullptr)
 {
+	map.setItemIndexEnabled(g_settings.getBoolean(Config::ITEM_INDEX));
+
 	MapVersion ver;
 	if(!IOMapOTBM::getVersionInfo(fn, ver)) {
 		// g_gui.PopupDialog("Error", "Could not open file \"" + fn.GetFullPath() + "\".", wxOK);
@@ -151,7 +157,7 @@ Editor::Editor(CopyBuffer& copybuffer, LiveClient* client) :
 	copybuffer(copybuffer),
 	replace_brush(nullptr)
 {
-	;
+	map.setItemIndexEnabled(g_settings.getBoolean(Config::ITEM_INDEX));
 }
 
 Editor::~Editor()
@@ -297,6 +303,7 @@ void Editor::saveMap(FileName filename, bool showdialog)
 	// Make temporary backups
 	//converter.Assign(wxstr(savefile));
 	std::string backup_otbm, backup_house, backup_spawn;
+	std::string indexed_otbm;
 
 	if(converter.GetExt() == "otgz") {
 		save_otgz = true;
@@ -310,6 +317,12 @@ void Editor::saveMap(FileName filename, bool showdialog)
 			backup_otbm = map_path + nstr(converter.GetName()) + ".otbm~";
 			std::remove(backup_otbm.c_str());
 			std::rename(savefile.c_str(), backup_otbm.c_str());
+
+			// Unchanged areas are copied from the old file, so follow it to its new name
+			if(map.otbm_index && FileName(wxstr(map.otbm_index->filename)).SameAs(converter)) {
+				indexed_otbm = map.otbm_index->filename;
+				map.otbm_index->filename = backup_otbm;
+			}
 		}
 
 		converter.SetFullName(wxstr(map.housefile));
@@ -361,6 +374,9 @@ void Editor::saveMap(FileName filename, bool showdialog)
 				converter.SetFullName(wxstr(savefile));
 				std::string otbm_filename = map_path + nstr(converter.GetName());
 				std::rename(backup_otbm.c_str(), std::string(otbm_filename + (save_otgz ? ".otgz" : ".otbm")).c_str());
+				if(!indexed_otbm.empty() && map.otbm_index) {
+					map.otbm_index->filename = indexed_otbm;
+				}
 			}
 
 			if(!backup_house.empty()) {
@@ -775,12 +791,15 @@ void Editor::borderizeSelection()
 		return;
 	}
 
-	Action* action = actionQueue->createAction(ACTION_BORDERIZE);
+	Borderizer borderizer(map);
 	for(const Tile* tile : selection) {
-		Tile* new_tile = tile->deepCopy(map);
-		new_tile->borderize(&map);
-		new_tile->select();
-		action->addChange(new Change(new_tile));
+		borderizer.addTile(tile->getPosition());
+	}
+
+	Action* action = actionQueue->createAction(ACTION_BORDERIZE);
+	for(const Borderizer::Copy& copy : borderizer.borderizeCopies(g_settings.getInteger(Config::WORKER_THREADS))) {
+		copy.copy->select();
+		action->addChange(new Change(copy.copy));
 	}
 	addAction(action);
 	updateActions();
@@ -792,18 +811,17 @@ void Editor::borderizeMap(bool showdialog)
 		g_gui.CreateLoadBar("Borderizing map...");
 	}
 
-	uint64_t tiles_done = 0;
+	Borderizer borderizer(map);
 	for(TileLocation* tileLocation : map) {
-		if(showdialog && tiles_done % 4096 == 0) {
-			g_gui.SetLoadDone(static_cast<int32_t>(tiles_done / double(map.tilecount) * 100.0));
-		}
-
-		Tile* tile = tileLocation->get();
-		ASSERT(tile);
+		borderizer.addTile(tileLocation->getPosition());
+	}
 
-		tile->borderize(&map);
-		++tiles_done;
+	std::function<void(int)> progress;
+	if(showdialog) {
+		progress = [](int percent) { g_gui.SetLoadDone(percent); };
 	}
+	borderizer.borderize(g_settings.getInteger(Config::WORKER_THREADS), progress);
+	map.markAllAreasDirty();
 
 	if(showdialog) {
 		g_gui.DestroyLoadBar();
@@ -839,44 +857,65 @@ void Editor::randomizeSelection()
 	updateActions();
 }
 
-void Editor::randomizeMap(bool showdialog)
+void Editor::randomizeMap(uint32_t seed, bool showdialog)
 {
 	if(showdialog) {
 		g_gui.CreateLoadBar("Randomizing map...");
 	}
 
-	uint64_t tiles_done = 0;
+	std::vector<Tile*> tiles;
 	for(TileLocation* tileLocation : map) {
-		if(showdialog && tiles_done % 4096 == 0) {
-			g_gui.SetLoadDone(static_cast<int32_t>(tiles_done / double(map.tilecount) * 100.0));
-		}
-
 		Tile* tile = tileLocation->get();
 		ASSERT(tile);
+		if(tile->getGroundBrush()) {
+			tiles.push_back(tile);
+		}
+	}
 
-		GroundBrush* groundBrush = tile->getGroundBrush();
-		if(groundBrush) {
-			Item* oldGround = tile->ground;
+	// Every run of tiles draws from a generator of its own, seeded from the run
+	// index, so the same seed gives the same map whatever the thread count is
+	const size_t TilesPerRun = 4096;
+	const size_t run_count = (tiles.size() + TilesPerRun - 1) / TilesPerRun;
 
-			uint16_t actionId, uniqueId;
-			if(oldGround) {
-				actionId = oldGround->getActionID();
-				uniqueId = oldGround->getUniqueID();
-			} else {
-				actionId = 0;
-				uniqueId = 0;
-			}
-			groundBrush->draw(&map, tile, nullptr);
+	std::function<void(size_t)> progress;
+	if(showdialog) {
+		progress = [run_count](size_t done) { g_gui.SetLoadDone(static_cast<int32_t>(100 * done / run_count)); };
+	}
 
-			Item* newGround = tile->ground;
-			if(newGround) {
-				newGround->setActionID(actionId);
-				newGround->setUniqueID(uniqueId);
+	std::vector<Tile*> new_tiles(tiles.size());
+	RunJobs(run_count, std::max(g_settings.getInteger(Config::WORKER_THREADS), 1), [&](size_t run) {
+		// Neighbouring runs must not get neighbouring seeds (splitmix64 finalizer),
+		// the seed is 32 bits so it never overlaps the run index
+		uint64_t run_seed = (static_cast<uint64_t>(seed) << 32) + run;
+		run_seed = (run_seed ^ (run_seed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		run_seed = (run_seed ^ (run_seed >> 27)) * 0x94D049BB133111EBULL;
+		run_seed ^= run_seed >> 31;
+		MTRandom generator(static_cast<unsigned long>(run_seed & 0xFFFFFFFF));
+
+		const size_t end = std::min(tiles.size(), (run + 1) * TilesPerRun);
+		for(size_t index = run * TilesPerRun; index < end; ++index) {
+			const Tile* tile = tiles[index];
+			Tile* new_tile = tile->deepCopy(map);
+			new_tile->getGroundBrush()->drawRandom(new_tile, generator);
+
+			Item* old_ground = tile->ground;
+			Item* new_ground = new_tile->ground;
+			if(old_ground && new_ground) {
+				new_ground->setActionID(old_ground->getActionID());
+				new_ground->setUniqueID(old_ground->getUniqueID());
 			}
-			tile->update();
+			// addItem leaves the flags alone, blocking and minimap color may have changed
+			new_tile->update();
+			new_tiles[index] = new_tile;
 		}
-		++tiles_done;
+	}, progress);
+
+	Action* action = actionQueue->createAction(ACTION_RANDOMIZE);
+	for(Tile* new_tile : new_tiles) {
+		action->addChange(new Change(new_tile));
 	}
+	addAction(action);
+	updateActions();
 
 	if(showdialog) {
 		g_gui.DestroyLoadBar();
@@ -927,6 +966,7 @@ void Editor::clearInvalidHouseTiles(bool showdialog)
 		if(tile->isHouseTile()) {
 			if(houses.getHouse(tile->getHouseID()) == nullptr) {
 				tile->setHouse(nullptr);
+				map.markAreaDirty(tile->getPosition());
 			}
 		}
 		++tiles_done;
@@ -954,6 +994,7 @@ void Editor::clearModifiedTileState(bool showdialog)
 		tile->unmodify();
 		++tiles_done;
 	}
+	map.markAllChanged();
 
 	if(showdialog) {
 		g_gui.DestroyLoadBar();
@@ -1880,6 +1921,12 @@ void Editor::QueryNode(int ndx, int ndy, bool underground)
 	live_client->queryNode(ndx, ndy, underground);
 }
 
+void Editor::SetNodeRequestView(int start_x, int start_y, int end_x, int end_y, bool underground)
+{
+	ASSERT(live_client);
+	live_client->setNodeRequestView(start_x, start_y, end_x, end_y, underground);
+}
+
 void Editor::SendNodeRequests()
 {
 	if(live_client) {
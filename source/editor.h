@@ -68,6 +68,7 @@ public: // Functions
 
 	// Client side
 	void QueryNode(int ndx, int ndy, bool underground);
+	void SetNodeRequestView(int start_x, int start_y, int end_x, int end_y, bool underground);
 	void SendNodeRequests();
 
 	bool hasChanges() const;
@@ -114,10 +115,10 @@ public: // Functions
 	void randomizeSelection();
 
 	// Same as above although it applies to the entire map
-	// action queue is flushed when these functions are called
 	// showdialog is whether a progress bar should be shown
 	void borderizeMap(bool showdialog);
-	void randomizeMap(bool showdialog);
+	// The same seed always gives the same map, the result is a single undoable action
+	void randomizeMap(uint32_t seed, bool showdialog);
 	void clearInvalidHouseTiles(bool showdialog);
 	void clearModifiedTileState(bool showdialog);
 
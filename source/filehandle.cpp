@@ -22,6 +22,10 @@
 #include <stdio.h>
 #include <assert.h>
 
+#if defined __VISUALC__ && defined _UNICODE
+#include <boost/filesystem/path.hpp>
+#endif
+
 uint8_t NodeFileWriteHandle::NODE_START = ::NODE_START;
 uint8_t NodeFileWriteHandle::NODE_END = ::NODE_END;
 uint8_t NodeFileWriteHandle::ESCAPE_CHAR = ::ESCAPE_CHAR;
@@ -147,6 +151,7 @@ bool FileReadHandle::getLongString(std::string& str)
 
 NodeFileReadHandle::NodeFileReadHandle() :
 	last_was_start(false),
+	stable_cache(false),
 	cache(nullptr),
 	cache_size(32768),
 	cache_length(0),
@@ -189,6 +194,7 @@ void NodeFileReadHandle::freeNode(BinaryNode* node)
 
 MemoryNodeFileReadHandle::MemoryNodeFileReadHandle(const uint8_t* data, size_t size)
 {
+	stable_cache = true;
 	assign(data, size);
 }
 
@@ -228,6 +234,97 @@ BinaryNode* MemoryNodeFileReadHandle::getRootNode()
 	return root_node;
 }
 
+//=============================================================================
+// Memory mapped node file read handle
+
+MappedNodeFileReadHandle::MappedNodeFileReadHandle(const std::string& name, const std::vector<std::string>& acceptable_identifiers)
+{
+	stable_cache = true;
+	try {
+#if defined __VISUALC__ && defined _UNICODE
+		mapping.open(boost::filesystem::path(string2wstring(name)));
+#else
+		mapping.open(name);
+#endif
+	} catch(std::exception&) {
+		error_code = FILE_COULD_NOT_OPEN;
+		return;
+	}
+
+	if(!mapping.is_open()) {
+		error_code = FILE_COULD_NOT_OPEN;
+		return;
+	}
+
+	const char* ver = mapping.data();
+	if(mapping.size() < 4) {
+		mapping.close();
+		error_code = FILE_SYNTAX_ERROR;
+		return;
+	}
+
+	// 0x00 00 00 00 is accepted as a wildcard version
+
+	if(ver[0] != 0 || ver[1] != 0 || ver[2] != 0 || ver[3] != 0) {
+		bool accepted = false;
+		for(const std::string& identifier : acceptable_identifiers) {
+			if(memcmp(ver, identifier.c_str(), 4) == 0) {
+				accepted = true;
+				break;
+			}
+		}
+
+		if(!accepted) {
+			mapping.close();
+			error_code = FILE_SYNTAX_ERROR;
+			return;
+		}
+	}
+
+	// The mapping is read-only, nodes never write through the cache
+	cache = reinterpret_cast<uint8_t*>(const_cast<char*>(mapping.data())) + 4;
+	cache_size = cache_length = mapping.size() - 4;
+	local_read_index = 0;
+}
+
+MappedNodeFileReadHandle::~MappedNodeFileReadHandle()
+{
+	close();
+}
+
+void MappedNodeFileReadHandle::close()
+{
+	freeNode(root_node);
+	root_node = nullptr;
+	cache = nullptr;
+	cache_size = cache_length = 0;
+	local_read_index = 0;
+	if(mapping.is_open()) {
+		mapping.close();
+	}
+}
+
+bool MappedNodeFileReadHandle::renewCache()
+{
+	// The whole file is already in the cache
+	return false;
+}
+
+BinaryNode* MappedNodeFileReadHandle::getRootNode()
+{
+	assert(root_node == nullptr); // You should never do this twice
+	if(local_read_index >= cache_length || cache[local_read_index] != NODE_START) {
+		error_code = FILE_SYNTAX_ERROR;
+		return nullptr;
+	}
+
+	local_read_index++;
+	last_was_start = true;
+	root_node = getNode(nullptr);
+	root_node->load();
+	return root_node;
+}
+
 //=============================================================================
 // File based node file read handle
 
@@ -319,6 +416,9 @@ BinaryNode* DiskNodeFileReadHandle::getRootNode()
 // Binary file node
 
 BinaryNode::BinaryNode(NodeFileReadHandle* file, BinaryNode* parent) :
+	data(nullptr),
+	data_size(0),
+	offset(0),
 	read_offset(0),
 	file(file),
 	parent(parent),
@@ -347,22 +447,22 @@ BinaryNode* BinaryNode::getChild()
 
 bool BinaryNode::getRAW(uint8_t* ptr, size_t sz)
 {
-	if(read_offset + sz > data.size()) {
-		read_offset = data.size();
+	if(read_offset + sz > data_size) {
+		read_offset = data_size;
 		return false;
 	}
-	memcpy(ptr, data.data() + read_offset, sz);
+	memcpy(ptr, data + read_offset, sz);
 	read_offset += sz;
 	return true;
 }
 
 bool BinaryNode::getRAW(std::string& str, size_t sz)
 {
-	if(read_offset + sz > data.size()) {
-		read_offset = data.size();
+	if(read_offset + sz > data_size) {
+		read_offset = data_size;
 		return false;
 	}
-	str.assign(data.data() + read_offset, sz);
+	str.assign(reinterpret_cast<const char*>(data) + read_offset, sz);
 	read_offset += sz;
 	return true;
 }
@@ -429,7 +529,6 @@ BinaryNode* BinaryNode::advance()
 			// Another node follows this.
 			// Load this node as the next one
 			read_offset = 0;
-			data.clear();
 			load();
 			return this;
 		} else if(op == NODE_END) {
@@ -445,6 +544,50 @@ BinaryNode* BinaryNode::advance()
 	}
 }
 
+bool BinaryNode::skipChildren(const uint8_t*& node_data, size_t& node_size)
+{
+	ASSERT(file);
+	ASSERT(child == nullptr);
+
+	if(!file->stable_cache) {
+		return false;
+	}
+
+	uint8_t* cache = file->cache;
+	size_t cache_length = file->cache_length;
+	size_t& local_read_index = file->local_read_index;
+
+	if(file->last_was_start) {
+		// The start marker of the first child has already been read, walk
+		// until the end marker that belongs to this node.
+		int depth = 1;
+		while(true) {
+			if(local_read_index >= cache_length) {
+				file->error_code = FILE_PREMATURE_END;
+				return false;
+			}
+
+			uint8_t op = cache[local_read_index];
+			++local_read_index;
+			if(op == ESCAPE_CHAR) {
+				++local_read_index;
+			} else if(op == NODE_START) {
+				++depth;
+			} else if(op == NODE_END) {
+				if(depth == 0) {
+					break;
+				}
+				--depth;
+			}
+		}
+		file->last_was_start = false;
+	}
+
+	node_data = cache + offset - 1;
+	node_size = local_read_index - (offset - 1);
+	return true;
+}
+
 void BinaryNode::load()
 {
 	ASSERT(file);
@@ -452,49 +595,80 @@ void BinaryNode::load()
 	uint8_t*& cache = file->cache;
 	size_t& cache_length = file->cache_length;
 	size_t& local_read_index = file->local_read_index;
+
+	// As long as no escaped byte has been seen and the cache outlives us,
+	// the node data is simply the span between the start and the next marker.
+	bool copying = !file->stable_cache;
+	size_t start = local_read_index;
+	offset = start;
+
+	buffer.clear();
+	data = nullptr;
+	data_size = 0;
+
 	while(true) {
 		if(local_read_index >= cache_length) {
 			if(!file->renewCache()) {
 				// Failed to renew, exit
 				file->error_code = FILE_PREMATURE_END;
-				return;
+				if(!copying) {
+					data = cache + start;
+					data_size = local_read_index - start;
+					return;
+				}
+				break;
 			}
 		}
 
+		// Find the next special byte and take everything before it in one go
+		const uint8_t* run = cache + local_read_index;
+		const uint8_t* end = cache + cache_length;
+		const uint8_t* next = run;
+		while(next != end && *next != NODE_START && *next != NODE_END && *next != ESCAPE_CHAR) {
+			++next;
+		}
+
+		if(copying) {
+			buffer.append(reinterpret_cast<const char*>(run), next - run);
+		}
+		local_read_index += next - run;
+		if(next == end) {
+			continue;
+		}
+
 		uint8_t op = cache[local_read_index];
 		++local_read_index;
 
-		switch(op) {
-			case NODE_START: {
-				file->last_was_start = true;
-				return;
-			}
-
-			case NODE_END: {
-				file->last_was_start = false;
+		if(op == NODE_START || op == NODE_END) {
+			file->last_was_start = (op == NODE_START);
+			if(!copying) {
+				data = cache + start;
+				data_size = local_read_index - 1 - start;
 				return;
 			}
+			break;
+		}
 
-			case ESCAPE_CHAR: {
-				if(local_read_index >= cache_length) {
-					if(!file->renewCache()) {
-						// Failed to renew, exit
-						file->error_code = FILE_PREMATURE_END;
-						return;
-					}
-				}
+		// ESCAPE_CHAR, from here on the node has to be decoded into our own buffer
+		if(!copying) {
+			buffer.assign(reinterpret_cast<const char*>(cache + start), local_read_index - 1 - start);
+			copying = true;
+		}
 
-				op = cache[local_read_index];
-				++local_read_index;
+		if(local_read_index >= cache_length) {
+			if(!file->renewCache()) {
+				// Failed to renew, exit
+				file->error_code = FILE_PREMATURE_END;
 				break;
 			}
-
-			default:
-				break;
 		}
-		//std::cout << "Appending..." << std::endl;
-		data.append(1, op);
+
+		buffer.append(1, static_cast<char>(cache[local_read_index]));
+		++local_read_index;
 	}
+
+	data = reinterpret_cast<const uint8_t*>(buffer.data());
+	data_size = buffer.size();
 }
 
 //=============================================================================
@@ -771,3 +945,18 @@ bool NodeFileWriteHandle::addRAW(const uint8_t* ptr, size_t sz)
 	writeBytes(ptr, sz);
 	return error_code == FILE_NO_ERROR;
 }
+
+bool NodeFileWriteHandle::addEncoded(const uint8_t* ptr, size_t sz)
+{
+	while(sz > 0) {
+		size_t chunk = std::min(sz, cache_size - local_write_index);
+		memcpy(cache + local_write_index, ptr, chunk);
+		local_write_index += chunk;
+		ptr += chunk;
+		sz -= chunk;
+		if(local_write_index >= cache_size) {
+			renewCache();
+		}
+	}
+	return error_code == FILE_NO_ERROR;
+}
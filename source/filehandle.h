@@ -25,6 +25,8 @@
 #include <stack>
 #include <stdio.h>
 
+#include <boost/iostreams/device/mapped_file.hpp>
+
 #ifndef FORCEINLINE
 #   ifdef _MSV_VER
 #       define FORCEINLINE __forceinline
@@ -107,6 +109,7 @@ protected:
 class NodeFileReadHandle;
 class DiskNodeFileReadHandle;
 class MemoryNodeFileReadHandle;
+class MappedNodeFileReadHandle;
 
 class BinaryNode
 {
@@ -120,8 +123,8 @@ public:
 	FORCEINLINE bool getU32(uint32_t& u32) { return getType(u32); }
 	FORCEINLINE bool getU64(uint64_t& u64) { return getType(u64); }
 	FORCEINLINE bool skip(size_t sz) {
-		if(read_offset + sz > data.size()) {
-			read_offset = data.size();
+		if(read_offset + sz > data_size) {
+			read_offset = data_size;
 			return false;
 		}
 		read_offset += sz;
@@ -132,24 +135,39 @@ public:
 	bool getString(std::string& str);
 	bool getLongString(std::string& str);
 
+	// Unescaped payload of this node. Points straight into the file buffer
+	// when the handle keeps it alive and the node holds no escaped bytes.
+	const uint8_t* getData() const { return data; }
+	size_t getDataSize() const { return data_size; }
+
 	BinaryNode* getChild();
 	// Returns this on success, nullptr on failure
 	BinaryNode* advance();
+	// Moves past all children of this node without loading them, and returns
+	// the raw (still escaped) bytes of the whole node, markers included, so it
+	// can be read again through a MemoryNodeFileReadHandle.
+	// Only possible when the handle has a stable cache.
+	bool skipChildren(const uint8_t*& node_data, size_t& node_size);
 protected:
 	template<class T>
 	bool getType(T& ref) {
-		if(read_offset + sizeof(ref) > data.size()) {
-			read_offset = data.size();
+		if(read_offset + sizeof(ref) > data_size) {
+			read_offset = data_size;
 			return false;
 		}
-		ref = *(T*)(data.data()+read_offset);
+		memcpy(&ref, data + read_offset, sizeof(ref));
 
 		read_offset += sizeof(ref);
 		return true;
 	}
 
 	void load();
-	std::string data;
+	const uint8_t* data;
+	size_t data_size;
+	// Only used when the node must be unescaped or the cache is volatile
+	std::string buffer;
+	// Position of the node in the file cache, right after its start marker
+	size_t offset;
 	size_t read_offset;
 	NodeFileReadHandle* file;
 	BinaryNode* parent;
@@ -157,6 +175,7 @@ protected:
 
 	friend class DiskNodeFileReadHandle;
 	friend class MemoryNodeFileReadHandle;
+	friend class MappedNodeFileReadHandle;
 };
 
 class NodeFileReadHandle : public FileHandle
@@ -167,6 +186,11 @@ public:
 
 	virtual BinaryNode* getRootNode() = 0;
 
+	bool hasStableCache() const { return stable_cache; }
+	// Offset of a pointer into the cache from the start of the node data,
+	// only meaningful for handles with a stable cache
+	size_t getStreamOffset(const uint8_t* ptr) const { return ptr - cache; }
+
 	virtual size_t size() = 0;
 	virtual size_t tell() = 0;
 protected:
@@ -176,6 +200,9 @@ protected:
 	virtual bool renewCache() = 0;
 
 	bool last_was_start;
+	// True if the cache is never overwritten while nodes are alive,
+	// which lets nodes point into it instead of copying their data.
+	bool stable_cache;
 	uint8_t* cache;
 	size_t cache_size;
 	size_t cache_length;
@@ -226,6 +253,29 @@ protected:
 	uint8_t* index;
 };
 
+class MappedNodeFileReadHandle : public NodeFileReadHandle
+{
+public:
+	MappedNodeFileReadHandle(const std::string& name, const std::vector<std::string>& acceptable_identifiers);
+	virtual ~MappedNodeFileReadHandle();
+
+	virtual void close();
+	virtual bool isOpen() { return mapping.is_open(); }
+	virtual bool isOk() { return isOpen() && error_code == FILE_NO_ERROR; }
+	virtual BinaryNode* getRootNode();
+
+	virtual size_t size() { return mapping.is_open() ? mapping.size() : 0; }
+	virtual size_t tell() { return local_read_index + 4; }
+
+	// The raw node data following the identifier
+	const uint8_t* getMemory() const { return cache; }
+	size_t getMemorySize() const { return cache_length; }
+protected:
+	virtual bool renewCache();
+
+	boost::iostreams::mapped_file_source mapping;
+};
+
 class FileWriteHandle : public FileHandle
 {
 public:
@@ -272,6 +322,12 @@ public:
 	bool addRAW(std::string& str);
 	bool addRAW(const uint8_t* ptr, size_t sz);
 	bool addRAW(const char* c) { return addRAW(reinterpret_cast<const uint8_t*>(c), strlen(c)); }
+	// Appends data that is already node encoded (escaped, with node markers),
+	// such as the contents of a MemoryNodeFileWriteHandle
+	bool addEncoded(const uint8_t* ptr, size_t sz);
+
+	// How many bytes of node data have been written so far, not counting the identifier
+	virtual size_t getStreamOffset() = 0;
 
 protected:
 	virtual void renewCache() = 0;
@@ -312,6 +368,8 @@ public:
 
 	virtual void close();
 
+	virtual size_t getStreamOffset() { return (file ? ftell(file) - 4 : 0) + local_write_index; }
+
 protected:
 	virtual void renewCache();
 };
@@ -328,6 +386,8 @@ public:
 	uint8_t* getMemory();
 	size_t getSize();
 
+	virtual size_t getStreamOffset() { return local_write_index; }
+
 protected:
 	virtual void renewCache();
 };
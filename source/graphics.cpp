@@ -67,8 +67,8 @@ GraphicManager::GraphicManager() :
 	has_transparency(false),
 	has_frame_durations(false),
 	has_frame_groups(false),
-	loaded_textures(0),
-	lastclean(0)
+	lastclean(0),
+	lastdumpclean(0)
 {
 	animation_timer = newd wxStopWatch();
 	animation_timer->Start();
@@ -124,10 +124,10 @@ void GraphicManager::clear()
 	sprite_space.swap(new_sprite_space);
 	image_space.clear();
 	cleanup_list.clear();
+	dump_cleanup_list.clear();
 
 	item_count = 0;
 	creature_count = 0;
-	loaded_textures = 0;
 	lastclean = time(nullptr);
 	spritefile = "";
 
@@ -833,23 +833,42 @@ void GraphicManager::addSpriteToCleanup(GameSprite* spr)
 	}
 }
 
+void GraphicManager::addDumpToCleanup(GameSprite::NormalImage* image)
+{
+	dump_cleanup_list.push_back(image);
+}
+
 void GraphicManager::garbageCollection()
 {
+	// Called once per frame, this is the clock the atlas pages age by
+	const long now = getElapsedTime();
+	atlas.setTime(now);
+	atlas.setBudget(static_cast<size_t>(std::max(1, g_settings.getInteger(Config::TEXTURE_ATLAS_BUDGET))) * 1024 * 1024);
+
+	int t = time(nullptr);
+
+	// We keep dumps around for 5 seconds, so textures can be built again without reading the file
+	if(g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) {
+		dump_cleanup_list.clear();
+	} else if(t != lastdumpclean) {
+		size_t dumps = dump_cleanup_list.size();
+		while(dumps-- > 0) {
+			GameSprite::NormalImage* image = dump_cleanup_list.front();
+			dump_cleanup_list.pop_front();
+			if(t - image->lastaccess > 5) {
+				image->unloadDump();
+			} else {
+				dump_cleanup_list.push_back(image);
+			}
+		}
+		lastdumpclean = t;
+	}
+
 	if(g_settings.getInteger(Config::TEXTURE_MANAGEMENT)) {
-		int t = time(nullptr);
-		if(loaded_textures > g_settings.getInteger(Config::TEXTURE_CLEAN_THRESHOLD) &&
+		if(static_cast<int>(atlas.getUsedSlots()) > g_settings.getInteger(Config::TEXTURE_CLEAN_THRESHOLD) &&
 			t - lastclean > g_settings.getInteger(Config::TEXTURE_CLEAN_PULSE)) {
-			ImageMap::iterator iit = image_space.begin();
-			while(iit != image_space.end()) {
-				iit->second->clean(t);
-				++iit;
-			}
-			SpriteMap::iterator sit = sprite_space.begin();
-			while(sit != sprite_space.end()) {
-				GameSprite* gs = dynamic_cast<GameSprite*>(sit->second);
-				if(gs) gs->clean(t);
-				++sit;
-			}
+			// Only whole pages are released, and only those idle for long enough
+			atlas.collect(now - g_settings.getInteger(Config::TEXTURE_LONGEVITY) * 1000L);
 			lastclean = t;
 		}
 	}
@@ -910,15 +929,6 @@ GameSprite::~GameSprite()
 	delete animator;
 }
 
-void GameSprite::clean(int time) {
-	for(std::list<TemplateImage*>::iterator iter = instanced_templates.begin();
-			iter != instanced_templates.end();
-			++iter)
-	{
-		(*iter)->clean(time);
-	}
-}
-
 void GameSprite::unloadDC()
 {
 	delete dc[SPRITE_SIZE_16x16];
@@ -938,7 +948,7 @@ int GameSprite::getIndex(int width, int height, int layer, int pattern_x, int pa
 		this->width + width;
 }
 
-GLuint GameSprite::getHardwareID(int _x, int _y, int _layer, int _count, int _pattern_x, int _pattern_y, int _pattern_z, int _frame)
+const AtlasRegion* GameSprite::getAtlasRegion(int _x, int _y, int _layer, int _count, int _pattern_x, int _pattern_y, int _pattern_z, int _frame)
 {
 	uint32_t v;
 	if(_count >= 0 && height <= 1 && width <= 1) {
@@ -953,7 +963,7 @@ GLuint GameSprite::getHardwareID(int _x, int _y, int _layer, int _count, int _pa
 			v %= numsprites;
 		}
 	}
-	return spriteList[v]->getHardwareID();
+	return spriteList[v]->getAtlasRegion();
 }
 
 GameSprite::TemplateImage* GameSprite::getTemplateImage(int sprite_index, const Outfit& outfit)
@@ -978,7 +988,7 @@ GameSprite::TemplateImage* GameSprite::getTemplateImage(int sprite_index, const
 	return img;
 }
 
-GLuint GameSprite::getHardwareID(int _x, int _y, int _dir, int _addon, int _pattern_z, const Outfit& _outfit, int _frame)
+const AtlasRegion* GameSprite::getAtlasRegion(int _x, int _y, int _dir, int _addon, int _pattern_z, const Outfit& _outfit, int _frame)
 {
 	uint32_t v = getIndex(_x, _y, 0, _dir, _addon, _pattern_z, _frame);
 	if(v >= numsprites) {
@@ -990,9 +1000,9 @@ GLuint GameSprite::getHardwareID(int _x, int _y, int _dir, int _addon, int _patt
 	}
 	if(layers > 1) { // Template
 		TemplateImage* img = getTemplateImage(v, _outfit);
-		return img->getHardwareID();
+		return img->getAtlasRegion();
 	}
-	return spriteList[v]->getHardwareID();
+	return spriteList[v]->getAtlasRegion();
 }
 
 wxMemoryDC* GameSprite::getDC(SpriteSize size)
@@ -1112,7 +1122,6 @@ void GameSprite::DrawTo(wxDC* context, const wxRect& rect, const Outfit& outfit)
 }
 
 GameSprite::Image::Image() :
-	isGLLoaded(false),
 	lastaccess(0)
 {
 	////
@@ -1120,36 +1129,38 @@ GameSprite::Image::Image() :
 
 GameSprite::Image::~Image()
 {
-	unloadGLTexture(0);
+	unloadGLTexture();
 }
 
-void GameSprite::Image::createGLTexture(GLuint textureId)
+const AtlasRegion* GameSprite::Image::getAtlasRegion()
 {
-	ASSERT(!isGLLoaded);
+	// The region is reset when the atlas evicts its page
+	if(region.isValid()) {
+		g_gui.gfx.atlas.touch(region);
+	} else {
+		createGLTexture();
+		if(!region.isValid()) {
+			return nullptr;
+		}
+	}
+	visit();
+	return &region;
+}
 
+void GameSprite::Image::createGLTexture()
+{
 	uint8_t* rgba = getRGBAData();
 	if(!rgba) {
 		return;
 	}
 
-	isGLLoaded = true;
-	g_gui.gfx.loaded_textures += 1;
-
-	glBindTexture(GL_TEXTURE_2D, textureId);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // Linear Filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // Linear Filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, 0x812F); // GL_CLAMP_TO_EDGE
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, 0x812F); // GL_CLAMP_TO_EDGE
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, rme::SpritePixels, rme::SpritePixels, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
-
+	g_gui.gfx.atlas.add(rgba, region);
 	delete[] rgba;
 }
 
-void GameSprite::Image::unloadGLTexture(GLuint textureId)
+void GameSprite::Image::unloadGLTexture()
 {
-	isGLLoaded = false;
-	g_gui.gfx.loaded_textures -= 1;
-	glDeleteTextures(1, &textureId);
+	g_gui.gfx.atlas.remove(region);
 }
 
 void GameSprite::Image::visit()
@@ -1157,13 +1168,6 @@ void GameSprite::Image::visit()
 	lastaccess = time(nullptr);
 }
 
-void GameSprite::Image::clean(int time)
-{
-	if(isGLLoaded && time - lastaccess > g_settings.getInteger(Config::TEXTURE_LONGEVITY)) {
-		unloadGLTexture(0);
-	}
-}
-
 GameSprite::NormalImage::NormalImage() :
 	id(0),
 	size(0),
@@ -1177,13 +1181,10 @@ GameSprite::NormalImage::~NormalImage()
 	delete[] dump;
 }
 
-void GameSprite::NormalImage::clean(int time)
+void GameSprite::NormalImage::unloadDump()
 {
-	Image::clean(time);
-	if(time - lastaccess > 5 && !g_settings.getInteger(Config::USE_MEMCACHED_SPRITES)) { // We keep dumps around for 5 seconds.
-		delete[] dump;
-		dump = nullptr;
-	}
+	delete[] dump;
+	dump = nullptr;
 }
 
 uint8_t* GameSprite::NormalImage::getRGBData()
@@ -1196,6 +1197,10 @@ uint8_t* GameSprite::NormalImage::getRGBData()
 		if(!g_gui.gfx.loadSpriteDump(dump, size, id)) {
 			return nullptr;
 		}
+		if(dump) {
+			visit();
+			g_gui.gfx.addDumpToCleanup(this);
+		}
 	}
 
 	const int pixels_data_size = rme::SpritePixels * rme::SpritePixels * 3;
@@ -1246,6 +1251,10 @@ uint8_t* GameSprite::NormalImage::getRGBAData()
 		if(!g_gui.gfx.loadSpriteDump(dump, size, id)) {
 			return nullptr;
 		}
+		if(dump) {
+			visit();
+			g_gui.gfx.addDumpToCleanup(this);
+		}
 	}
 
 	const int pixels_data_size = rme::SpritePixelsSize * 4;
@@ -1292,42 +1301,21 @@ uint8_t* GameSprite::NormalImage::getRGBAData()
 	return data;
 }
 
-GLuint GameSprite::NormalImage::getHardwareID()
-{
-	if(!isGLLoaded) {
-		createGLTexture(id);
-	}
-	visit();
-	return id;
-}
-
-void GameSprite::NormalImage::createGLTexture(GLuint textureId)
-{
-	Image::createGLTexture(id);
-}
-
-void GameSprite::NormalImage::unloadGLTexture(GLuint textureId)
-{
-	Image::unloadGLTexture(id);
-}
-
 GameSprite::EditorImage::EditorImage(const wxArtID& bitmapId) :
 	NormalImage(),
 	bitmapId(bitmapId)
 { }
 
-void GameSprite::EditorImage::createGLTexture(GLuint textureId)
+uint8_t* GameSprite::EditorImage::getRGBAData()
 {
-	ASSERT(!isGLLoaded);
-
 	wxSize size(rme::SpritePixels, rme::SpritePixels);
 	wxBitmap bitmap = wxArtProvider::GetBitmap(bitmapId, wxART_OTHER, size);
 
 	wxNativePixelData data(bitmap);
-	if(!data) return;
+	if(!data) return nullptr;
 
 	const int imageSize = rme::SpritePixelsSize * 4;
-	GLubyte *imageData = new GLubyte[imageSize];
+	uint8_t* imageData = newd uint8_t[imageSize];
 	int write = 0;
 
 	wxNativePixelData::Iterator it(data);
@@ -1354,28 +1342,10 @@ void GameSprite::EditorImage::createGLTexture(GLuint textureId)
 		it = row_start;
 		it.OffsetY(data, 1);
 	}
-
-	isGLLoaded = true;
-	id = g_gui.gfx.getFreeTextureID();
-	g_gui.gfx.loaded_textures += 1;
-
-	glBindTexture(GL_TEXTURE_2D, id);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // Linear Filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // Linear Filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, 0x812F); // GL_CLAMP_TO_EDGE
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, 0x812F); // GL_CLAMP_TO_EDGE
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, rme::SpritePixels, rme::SpritePixels, 0, GL_RGBA, GL_UNSIGNED_BYTE, imageData);
-
-	delete[] imageData;
-}
-
-void GameSprite::EditorImage::unloadGLTexture(GLuint textureId)
-{
-	Image::unloadGLTexture(id);
+	return imageData;
 }
 
 GameSprite::TemplateImage::TemplateImage(GameSprite* parent, int v, const Outfit& outfit) :
-	gl_tid(0),
 	parent(parent),
 	sprite_index(v),
 	lookHead(outfit.lookHead),
@@ -1506,31 +1476,6 @@ uint8_t* GameSprite::TemplateImage::getRGBAData()
 	return rgbadata;
 }
 
-GLuint GameSprite::TemplateImage::getHardwareID()
-{
-	if(!isGLLoaded) {
-		if(gl_tid == 0) {
-			gl_tid = g_gui.gfx.getFreeTextureID();
-		}
-		createGLTexture(gl_tid);
-		if(!isGLLoaded) {
-			return 0;
-		}
-	}
-	visit();
-	return gl_tid;
-}
-
-void GameSprite::TemplateImage::createGLTexture(GLuint unused)
-{
-	Image::createGLTexture(gl_tid);
-}
-
-void GameSprite::TemplateImage::unloadGLTexture(GLuint unused)
-{
-	Image::unloadGLTexture(gl_tid);
-}
-
 GameSprite* GameSprite::createFromBitmap(const wxArtID& bitmapId)
 {
 	GameSprite::EditorImage* image = new GameSprite::EditorImage(bitmapId);
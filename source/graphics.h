@@ -23,6 +23,7 @@
 #include <deque>
 
 #include "client_version.h"
+#include "texture_atlas.h"
 
 #include <wx/artprov.h>
 
@@ -84,15 +85,13 @@ public:
 	virtual ~GameSprite();
 
 	int getIndex(int width, int height, int layer, int pattern_x, int pattern_y, int pattern_z, int frame) const;
-	GLuint getHardwareID(int _x, int _y, int _layer, int _subtype, int _pattern_x, int _pattern_y, int _pattern_z, int _frame);
-	GLuint getHardwareID(int _x, int _y, int _dir, int _addon, int _pattern_z, const Outfit& _outfit, int _frame); // CreatureDatabase
+	const AtlasRegion* getAtlasRegion(int _x, int _y, int _layer, int _subtype, int _pattern_x, int _pattern_y, int _pattern_z, int _frame);
+	const AtlasRegion* getAtlasRegion(int _x, int _y, int _dir, int _addon, int _pattern_z, const Outfit& _outfit, int _frame); // CreatureDatabase
 	virtual void DrawTo(wxDC* dc, SpriteSize sz, int start_x, int start_y, int width = -1, int height = -1);
 	void DrawTo(wxDC* context, const wxRect& rect, const Outfit& outfit);
 
 	virtual void unloadDC();
 
-	void clean(int time);
-
 	uint16_t getDrawHeight() const noexcept { return draw_height; }
 	const wxPoint& getDrawOffset() const noexcept { return draw_offset; }
 	uint8_t getMiniMapColor() const noexcept { return minimap_color; }
@@ -116,19 +115,19 @@ protected:
 		Image();
 		virtual ~Image();
 
-		bool isGLLoaded;
 		int lastaccess;
+		AtlasRegion region;
 
 		void visit();
-		virtual void clean(int time);
 
-		virtual GLuint getHardwareID() = 0;
+		// Uploads the image to the texture atlas if it isn't there yet
+		const AtlasRegion* getAtlasRegion();
 		virtual uint8_t* getRGBData() = 0;
 		virtual uint8_t* getRGBAData() = 0;
 
 	protected:
-		virtual void createGLTexture(GLuint textureId);
-		virtual void unloadGLTexture(GLuint textureId);
+		void createGLTexture();
+		void unloadGLTexture();
 	};
 
 	class NormalImage : public Image {
@@ -136,30 +135,24 @@ protected:
 		NormalImage();
 		virtual ~NormalImage();
 
-		// We use the sprite id as GL texture id
+		// Sprite id in the .spr file
 		uint32_t id;
 
 		// This contains the pixel data
 		uint16_t size;
 		uint8_t* dump;
 
-		virtual void clean(int time);
+		void unloadDump();
 
-		virtual GLuint getHardwareID();
 		virtual uint8_t* getRGBData();
 		virtual uint8_t* getRGBAData();
-
-	protected:
-		virtual void createGLTexture(GLuint textureId = 0);
-		virtual void unloadGLTexture(GLuint textureId = 0);
 	};
 
 	class EditorImage : public NormalImage {
 	public:
 		EditorImage(const wxArtID& bitmapId);
-	protected:
-		void createGLTexture(GLuint textureId) override;
-		void unloadGLTexture(GLuint textureId) override;
+
+		uint8_t* getRGBAData() override;
 	private:
 		wxArtID bitmapId;
 	};
@@ -169,11 +162,9 @@ protected:
 		TemplateImage(GameSprite* parent, int v, const Outfit& outfit);
 		virtual ~TemplateImage();
 
-		virtual GLuint getHardwareID();
 		virtual uint8_t* getRGBData();
 		virtual uint8_t* getRGBAData();
 
-		GLuint gl_tid;
 		GameSprite* parent;
 		int sprite_index;
 		uint8_t lookHead;
@@ -182,9 +173,6 @@ protected:
 		uint8_t lookFeet;
 	protected:
 		void colorizePixel(uint8_t color, uint8_t &r, uint8_t &b, uint8_t &g);
-
-		virtual void createGLTexture(GLuint ignored = 0);
-		virtual void unloadGLTexture(GLuint ignored = 0);
 	};
 
 	uint32_t id;
@@ -299,6 +287,9 @@ public:
 	// Get an unused texture id (this is acquired by simply increasing a value starting from 0x10000000)
 	GLuint getFreeTextureID();
 
+	TextureAtlas& getAtlas() noexcept { return atlas; }
+	const TextureAtlas& getAtlas() const noexcept { return atlas; }
+
 	// This is part of the binary
 	bool loadEditorSprites();
 	// Metadata should be loaded first
@@ -311,6 +302,7 @@ public:
 	// Cleans old & unused textures according to config settings
 	void garbageCollection();
 	void addSpriteToCleanup(GameSprite* spr);
+	void addDumpToCleanup(GameSprite::NormalImage* image);
 
 	wxFileName getMetadataFileName() const { return metadata_file; }
 	wxFileName getSpritesFileName() const { return sprites_file; }
@@ -331,6 +323,7 @@ private:
 	typedef std::map<int, GameSprite::Image*> ImageMap;
 	ImageMap image_space;
 	std::deque<GameSprite*> cleanup_list;
+	std::deque<GameSprite::NormalImage*> dump_cleanup_list;
 
 	DatFormat dat_format;
 	uint16_t item_count;
@@ -343,8 +336,9 @@ private:
 	wxFileName metadata_file;
 	wxFileName sprites_file;
 
-	int loaded_textures;
+	TextureAtlas atlas;
 	int lastclean;
+	int lastdumpclean;
 
 	wxStopWatch* animation_timer;
 
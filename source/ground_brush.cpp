@@ -555,7 +555,19 @@ void GroundBrush::draw(BaseMap* map, Tile* tile, void* parameter)
 			return;
 		}
 	}
-	int chance = random(1, total_chance);
+	tile->addItem(Item::Create(getGroundID(random(1, total_chance))));
+}
+
+void GroundBrush::drawRandom(Tile* tile, MTRandom& generator)
+{
+	ASSERT(tile);
+	if(border_items.empty()) return;
+
+	tile->addItem(Item::Create(getGroundID(random(generator, 1, total_chance))));
+}
+
+uint16_t GroundBrush::getGroundID(int chance) const
+{
 	uint16_t id = 0;
 	for(std::vector<ItemChanceBlock>::const_iterator it = border_items.begin(); it != border_items.end(); ++it) {
 		if(chance < it->chance) {
@@ -566,8 +578,7 @@ void GroundBrush::draw(BaseMap* map, Tile* tile, void* parameter)
 	if(id == 0) {
 		id = border_items.front().id;
 	}
-
-	tile->addItem(Item::Create(id));
+	return id;
 }
 
 const GroundBrush::BorderBlock* GroundBrush::getBrushTo(GroundBrush* first, GroundBrush* second) {
@@ -650,62 +661,75 @@ void GroundBrush::doBorders(BaseMap* map, Tile* tile)
 
 	ASSERT(tile);
 
-	GroundBrush* borderBrush;
-	if(tile->ground) {
-		borderBrush = tile->ground->getGroundBrush();
-	} else {
-		borderBrush = nullptr;
-	}
-
 	const Position& position = tile->getPosition();
 
 	uint32_t x = position.x;
 	uint32_t y = position.y;
 	uint32_t z = position.z;
 
-	// Pair of visited / what border type
-	std::pair<bool, GroundBrush*> neighbours[8];
+	GroundBrush* neighbours[8];
 	if(x == 0) {
 		if(y == 0) {
-			neighbours[0] = { false, nullptr };
-			neighbours[1] = { false, nullptr };
-			neighbours[2] = { false, nullptr };
-			neighbours[3] = { false, nullptr };
-			neighbours[4] = { false, extractGroundBrushFromTile(map, x + 1, y,     z) };
-			neighbours[5] = { false, nullptr };
-			neighbours[6] = { false, extractGroundBrushFromTile(map, x,     y + 1, z) };
-			neighbours[7] = { false, extractGroundBrushFromTile(map, x + 1, y + 1, z) };
+			neighbours[0] = nullptr;
+			neighbours[1] = nullptr;
+			neighbours[2] = nullptr;
+			neighbours[3] = nullptr;
+			neighbours[4] = extractGroundBrushFromTile(map, x + 1, y,     z);
+			neighbours[5] = nullptr;
+			neighbours[6] = extractGroundBrushFromTile(map, x,     y + 1, z);
+			neighbours[7] = extractGroundBrushFromTile(map, x + 1, y + 1, z);
 		} else {
-			neighbours[0] = { false, nullptr };
-			neighbours[1] = { false, extractGroundBrushFromTile(map, x,     y - 1, z) };
-			neighbours[2] = { false, extractGroundBrushFromTile(map, x + 1, y - 1, z) };
-			neighbours[3] = { false, nullptr };
-			neighbours[4] = { false, extractGroundBrushFromTile(map, x + 1, y,     z) };
-			neighbours[5] = { false, nullptr };
-			neighbours[6] = { false, extractGroundBrushFromTile(map, x,     y + 1, z) };
-			neighbours[7] = { false, extractGroundBrushFromTile(map, x + 1, y + 1, z) };
+			neighbours[0] = nullptr;
+			neighbours[1] = extractGroundBrushFromTile(map, x,     y - 1, z);
+			neighbours[2] = extractGroundBrushFromTile(map, x + 1, y - 1, z);
+			neighbours[3] = nullptr;
+			neighbours[4] = extractGroundBrushFromTile(map, x + 1, y,     z);
+			neighbours[5] = nullptr;
+			neighbours[6] = extractGroundBrushFromTile(map, x,     y + 1, z);
+			neighbours[7] = extractGroundBrushFromTile(map, x + 1, y + 1, z);
 		}
 	} else if(y == 0) {
-		neighbours[0] = { false, nullptr };
-		neighbours[1] = { false, nullptr };
-		neighbours[2] = { false, nullptr };
-		neighbours[3] = { false, extractGroundBrushFromTile(map, x - 1, y,     z) };
-		neighbours[4] = { false, extractGroundBrushFromTile(map, x + 1, y,     z) };
-		neighbours[5] = { false, extractGroundBrushFromTile(map, x - 1, y + 1, z) };
-		neighbours[6] = { false, extractGroundBrushFromTile(map, x,     y + 1, z) };
-		neighbours[7] = { false, extractGroundBrushFromTile(map, x + 1, y + 1, z) };
+		neighbours[0] = nullptr;
+		neighbours[1] = nullptr;
+		neighbours[2] = nullptr;
+		neighbours[3] = extractGroundBrushFromTile(map, x - 1, y,     z);
+		neighbours[4] = extractGroundBrushFromTile(map, x + 1, y,     z);
+		neighbours[5] = extractGroundBrushFromTile(map, x - 1, y + 1, z);
+		neighbours[6] = extractGroundBrushFromTile(map, x,     y + 1, z);
+		neighbours[7] = extractGroundBrushFromTile(map, x + 1, y + 1, z);
+	} else {
+		neighbours[0] = extractGroundBrushFromTile(map, x - 1, y - 1, z);
+		neighbours[1] = extractGroundBrushFromTile(map, x,     y - 1, z);
+		neighbours[2] = extractGroundBrushFromTile(map, x + 1, y - 1, z);
+		neighbours[3] = extractGroundBrushFromTile(map, x - 1, y,     z);
+		neighbours[4] = extractGroundBrushFromTile(map, x + 1, y,     z);
+		neighbours[5] = extractGroundBrushFromTile(map, x - 1, y + 1, z);
+		neighbours[6] = extractGroundBrushFromTile(map, x,     y + 1, z);
+		neighbours[7] = extractGroundBrushFromTile(map, x + 1, y + 1, z);
+	}
+
+	doBorders(tile, neighbours);
+}
+
+void GroundBrush::doBorders(Tile* tile, GroundBrush* const groundBrushes[8])
+{
+	ASSERT(tile);
+
+	GroundBrush* borderBrush;
+	if(tile->ground) {
+		borderBrush = tile->ground->getGroundBrush();
 	} else {
-		neighbours[0] = { false, extractGroundBrushFromTile(map, x - 1, y - 1, z) };
-		neighbours[1] = { false, extractGroundBrushFromTile(map, x,     y - 1, z) };
-		neighbours[2] = { false, extractGroundBrushFromTile(map, x + 1, y - 1, z) };
-		neighbours[3] = { false, extractGroundBrushFromTile(map, x - 1, y,     z) };
-		neighbours[4] = { false, extractGroundBrushFromTile(map, x + 1, y,     z) };
-		neighbours[5] = { false, extractGroundBrushFromTile(map, x - 1, y + 1, z) };
-		neighbours[6] = { false, extractGroundBrushFromTile(map, x,     y + 1, z) };
-		neighbours[7] = { false, extractGroundBrushFromTile(map, x + 1, y + 1, z) };
+		borderBrush = nullptr;
+	}
+
+	// Pair of visited / what border type
+	std::pair<bool, GroundBrush*> neighbours[8];
+	for(int32_t i = 0; i < 8; ++i) {
+		neighbours[i] = { false, groundBrushes[i] };
 	}
 
-	static std::vector<const BorderBlock*> specificList;
+	// Borders are done on worker threads by Borderizer
+	thread_local std::vector<const BorderBlock*> specificList;
 	specificList.clear();
 
 	std::vector<BorderCluster> borderList;
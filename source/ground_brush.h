@@ -40,9 +40,19 @@ public:
 
 	virtual void draw(BaseMap* map, Tile* tile, void* parameter);
 	virtual void undraw(BaseMap* map, Tile* tile);
+	// Same as draw without a parameter, with the ground picked by the given generator
+	void drawRandom(Tile* tile, MTRandom& generator);
 	static void doBorders(BaseMap* map, Tile* tile);
+	// Same, with the ground brushes around the tile already looked up, in the
+	// order north west, north, north east, west, east, south west, south, south east
+	static void doBorders(Tile* tile, GroundBrush* const neighbours[8]);
 	static const BorderBlock* getBrushTo(GroundBrush* first, GroundBrush* second);
 
+protected:
+	uint16_t getGroundID(int chance) const;
+
+public:
+
 	virtual int32_t getZ() const { return z_order; }
 	bool useSoloOptionalBorder() const { return use_only_optional; }
 	bool isReRandomizable() const { return randomize; }
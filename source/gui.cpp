@@ -94,6 +94,7 @@ GUI::GUI() :
 	use_custom_thickness(false),
 	custom_thickness_mod(0.0),
 	progressBar(nullptr),
+	hostedServer(nullptr),
 	disabled_counter(0)
 {
 	doodad_buffer_map = newd BaseMap();
@@ -652,6 +653,9 @@ int GUI::GetTabCount() const
 
 EditorTab* GUI::GetCurrentTab()
 {
+	if(!tabbook) {
+		return nullptr;
+	}
 	return tabbook->GetCurrentTab();
 }
 
@@ -778,6 +782,10 @@ void GUI::NewMapView()
 
 void GUI::LoadPerspective()
 {
+	if(!root) {
+		return;
+	}
+
 	if(!IsVersionLoaded()) {
 		if(g_settings.getInteger(Config::WINDOW_MAXIMIZED)) {
 			root->Maximize();
@@ -1055,6 +1063,10 @@ void GUI::ActivatePalette(PaletteWindow* p)
 
 void GUI::DestroyPalettes()
 {
+	if(!aui_manager) {
+		return;
+	}
+
 	for(auto palette : palettes) {
 		aui_manager->DetachPane(palette);
 		palette->Destroy();
@@ -1196,6 +1208,16 @@ void GUI::CreateLoadBar(wxString message, bool canCancel /* = false */ )
 	progressTo = 100;
 	currentProgress = -1;
 
+	// Nothing to show it in when serving without windows
+	if(!root) {
+		std::cout << nstr(progressText) << "..." << std::endl;
+		if(hostedServer) {
+			currentProgress = 0;
+			hostedServer->startOperation(progressText);
+		}
+		return;
+	}
+
 	progressBar = newd wxGenericProgressDialog("Loading", progressText + " (0%)", 100, root,
 		wxPD_APP_MODAL | wxPD_SMOOTH | (canCancel ? wxPD_CAN_ABORT : 0)
 	);
@@ -1240,9 +1262,13 @@ bool GUI::SetLoadDone(int32_t done, const wxString& newMessage)
 			&skip
 		);
 		currentProgress = newProgress;
+	} else if(hostedServer) {
+		// No dialog to track it when serving headless, the clients still want it
+		currentProgress = newProgress;
+		hostedServer->updateOperation(newProgress);
 	}
 
-	for(int32_t index = 0; index < tabbook->GetTabCount(); ++index) {
+	for(int32_t index = 0; tabbook && index < tabbook->GetTabCount(); ++index) {
 		auto * mapTab = dynamic_cast<MapTab*>(tabbook->GetTab(index));
 		if(mapTab && mapTab->GetEditor()) {
 			LiveServer* server = mapTab->GetEditor()->GetLiveServer();
@@ -1269,6 +1295,9 @@ void GUI::DestroyLoadBar()
 		} else {
 			root->RequestUserAttention();
 		}
+	} else if(hostedServer && currentProgress != -1) {
+		currentProgress = -1;
+		hostedServer->updateOperation(100);
 	}
 }
 
@@ -1497,6 +1526,10 @@ void GUI::SetTitle(wxString title)
 
 void GUI::UpdateTitle()
 {
+	if(!tabbook) {
+		return;
+	}
+
 	if(tabbook->GetTabCount() > 0) {
 		SetTitle(tabbook->GetCurrentTab()->GetTitle());
 		for(int idx = 0; idx < tabbook->GetTabCount(); ++idx) {
@@ -1516,6 +1549,10 @@ void GUI::UpdateMenus()
 
 void GUI::UpdateActions()
 {
+	if(!root) {
+		return;
+	}
+
 	wxCommandEvent evt(EVT_UPDATE_ACTIONS);
 	g_gui.root->AddPendingEvent(evt);
 }
@@ -1984,6 +2021,12 @@ long GUI::PopupDialog(wxWindow* parent, wxString title, wxString text, long styl
 
 long GUI::PopupDialog(wxString title, wxString text, long style, wxString configsavename, uint32_t configsavevalue)
 {
+	if(!root) {
+		if(!text.empty()) {
+			std::cout << nstr(title) << ": " << nstr(text) << std::endl;
+		}
+		return wxID_CANCEL;
+	}
 	return g_gui.PopupDialog(g_gui.root, title, text, style, configsavename, configsavevalue);
 }
 
@@ -34,6 +34,7 @@ class BaseMap;
 class Map;
 
 class Editor;
+class LiveServer;
 class Brush;
 class HouseBrush;
 class HouseExitBrush;
@@ -146,6 +147,13 @@ public:
 	 */
 	bool SetLoadDone(int32_t done, const wxString& newMessage = "");
 
+	/**
+	 * The server of a headless host (rme --serve), which has no map tab for
+	 * the load bar to find it through.
+	 */
+	void SetHostedLiveServer(LiveServer* server) { hostedServer = server; }
+	LiveServer* GetHostedLiveServer() const { return hostedServer; }
+
 	/**
 	 * Sets the scale of the loading bar.
 	 * Calling this with (50, 80) means that setting 50 as 'done',
@@ -450,6 +458,7 @@ protected:
 	int32_t progressFrom;
 	int32_t progressTo;
 	int32_t currentProgress;
+	LiveServer* hostedServer;
 
 	wxWindowDisabler* winDisabler;
 	int disabled_counter;
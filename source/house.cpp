@@ -95,8 +95,10 @@ void House::clean()
 {
 	for(PositionList::const_iterator pos_iter = tiles.begin(); pos_iter != tiles.end(); ++pos_iter) {
 		Tile* tile = map->getTile(*pos_iter);
-		if(tile)
+		if(tile) {
 			tile->setHouse(nullptr);
+			map->markAreaDirty(*pos_iter);
+		}
 	}
 
 	Tile* tile = map->getTile(exit);
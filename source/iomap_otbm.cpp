@@ -36,6 +36,11 @@
 
 #include "iomap_otbm.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
 typedef uint8_t attribute_t;
 typedef uint32_t flags_t;
 
@@ -405,6 +410,22 @@ bool Container::serializeItemNode_OTBM(const IOMap& maphandle, NodeFileWriteHand
 	|--- OTBM_ITEM_DEF (not implemented)
 */
 
+void OTBMFileIndex::stamp(const std::string& name)
+{
+	FileName file(wxstr(name));
+	filename = name;
+	file_size = file.GetSize();
+	modified = file.GetModificationTime();
+}
+
+bool OTBMFileIndex::isCurrent() const
+{
+	FileName file(wxstr(filename));
+	if(!valid || !file.FileExists())
+		return false;
+	return file.GetSize() == file_size && file.GetModificationTime() == modified;
+}
+
 bool IOMapOTBM::getVersionInfo(const FileName& filename, MapVersion& out_ver)
 {
 #if OTGZ_SUPPORT > 0
@@ -600,15 +621,42 @@ bool IOMapOTBM::loadMap(Map& map, const FileName& filename)
 	}
 #endif
 
-	DiskNodeFileReadHandle f(nstr(filename.GetFullPath()), StringVector(1, "OTBM"));
-	if(!f.isOk()) {
-		error(("Couldn't open file for reading\nThe error reported was: " + wxstr(f.getErrorMessage())).wc_str());
+	std::unique_ptr<NodeFileReadHandle> f;
+	if(g_settings.getInteger(Config::LOAD_WITH_MEMORY_MAPPING)) {
+		f.reset(newd MappedNodeFileReadHandle(nstr(filename.GetFullPath()), StringVector(1, "OTBM")));
+		if(!f->isOk() && f->error_code != FILE_SYNTAX_ERROR) {
+			// Mapping can fail where plain reading doesn't (e.g. out of address space)
+			f.reset();
+		}
+	}
+	if(!f) {
+		f.reset(newd DiskNodeFileReadHandle(nstr(filename.GetFullPath()), StringVector(1, "OTBM")));
+	}
+	if(!f->isOk()) {
+		error(("Couldn't open file for reading\nThe error reported was: " + wxstr(f->getErrorMessage())).wc_str());
 		return false;
 	}
 
-	if(!loadMap(map, f))
+	// Remember where the tile areas are so the next save can reuse the unchanged ones
+	std::unique_ptr<OTBMFileIndex> index;
+	if(f->hasStableCache()) {
+		index.reset(newd OTBMFileIndex());
+		file_index = index.get();
+	}
+
+	bool loaded = loadMap(map, *f);
+	file_index = nullptr;
+	if(!loaded)
 		return false;
 
+	if(index && index->valid && f->isOk()) {
+		index->version = version;
+		index->stamp(nstr(filename.GetFullPath()));
+		map.otbm_index = std::move(index);
+	} else {
+		map.otbm_index.reset();
+	}
+
 	// Read auxilliary files
 	if(!loadHouses(map, filename)) {
 		warning("Failed to load houses.");
@@ -713,214 +761,394 @@ bool IOMapOTBM::loadMap(Map& map, NodeFileReadHandle& f)
 		}
 	}
 
-	int nodes_loaded = 0;
+	int threadcount = std::max(g_settings.getInteger(Config::WORKER_THREADS), 1);
+	if(f.hasStableCache() && (threadcount > 1 || file_index)) {
+		// The index can only be built from a file that is entirely in memory
+		loadMapNodesThreaded(map, f, mapHeaderNode, threadcount);
+	} else {
+		int nodes_loaded = 0;
+		for(BinaryNode* mapNode = mapHeaderNode->getChild(); mapNode != nullptr; mapNode = mapNode->advance()) {
+			++nodes_loaded;
+			if(nodes_loaded % 15 == 0) {
+				g_gui.SetLoadDone(static_cast<int32_t>(100.0 * f.tell() / f.size()));
+			}
+			loadMapNode(map, mapNode);
+		}
+	}
 
-	for(BinaryNode* mapNode = mapHeaderNode->getChild(); mapNode != nullptr; mapNode = mapNode->advance()) {
-		++nodes_loaded;
-		if(nodes_loaded % 15 == 0) {
-			g_gui.SetLoadDone(static_cast<int32_t>(100.0 * f.tell() / f.size()));
+	if(!f.isOk())
+		warning(wxstr(f.getErrorMessage()).wc_str());
+	return true;
+}
+
+// Tiles of one OTBM_TILE_AREA node, decoded but not yet placed on the map.
+// Warnings are kept in the order they were found so the merge can report them
+// exactly as if the area had been read straight into the map.
+struct IOMapOTBM::DecodedTile
+{
+	Position position;
+	Tile* tile; // nullptr if the tile is to be discarded
+	uint32_t house_id;
+	// Warnings belonging to this tile, dropped if the tile turns out to be a duplicate
+	size_t first_warning;
+	size_t warning_count;
+};
+
+struct IOMapOTBM::DecodedTileArea
+{
+	std::vector<DecodedTile> tiles;
+	wxArrayString warnings;
+
+	void warning(const wxString format, ...) {
+		wxString s;
+		va_list argp;
+		va_start(argp, format);
+		s.PrintfV(format, argp);
+		va_end(argp);
+		warnings.push_back(s);
+	}
+};
+
+void IOMapOTBM::loadMapNode(Map& map, BinaryNode* mapNode)
+{
+	uint8_t node_type;
+	if(!mapNode->getByte(node_type)) {
+		warning("Invalid map node");
+		return;
+	}
+
+	if(node_type == OTBM_TILE_AREA) {
+		DecodedTileArea area;
+		decodeTileArea(mapNode, area);
+		mergeTileArea(map, area);
+	} else if(node_type == OTBM_TOWNS) {
+		loadTowns(map, mapNode);
+	} else if(node_type == OTBM_WAYPOINTS) {
+		loadWaypoints(map, mapNode);
+	}
+}
+
+void IOMapOTBM::decodeTileArea(BinaryNode* mapNode, DecodedTileArea& area) const
+{
+	uint16_t base_x, base_y;
+	uint8_t base_z;
+	if(!mapNode->getU16(base_x) || !mapNode->getU16(base_y) || !mapNode->getU8(base_z)) {
+		area.warning("Invalid map node, no base coordinate");
+		return;
+	}
+
+	for(BinaryNode* tileNode = mapNode->getChild(); tileNode != nullptr; tileNode = tileNode->advance()) {
+		uint8_t tile_type;
+		if(!tileNode->getByte(tile_type)) {
+			area.warning("Invalid tile type");
+			continue;
+		}
+		if(tile_type != OTBM_TILE && tile_type != OTBM_HOUSETILE) {
+			area.warning("Unknown type of tile node");
+			continue;
 		}
 
-		uint8_t node_type;
-		if(!mapNode->getByte(node_type)) {
-			warning("Invalid map node");
+		uint8_t x_offset, y_offset;
+		if(!tileNode->getU8(x_offset) || !tileNode->getU8(y_offset)) {
+			area.warning("Could not read position of tile");
 			continue;
 		}
-		if(node_type == OTBM_TILE_AREA) {
-			uint16_t base_x, base_y;
-			uint8_t base_z;
-			if(!mapNode->getU16(base_x) || !mapNode->getU16(base_y) || !mapNode->getU8(base_z)) {
-				warning("Invalid map node, no base coordinate");
+		const Position pos(base_x + x_offset, base_y + y_offset, base_z);
+
+		area.tiles.push_back(DecodedTile {pos, nullptr, 0, area.warnings.size(), 0});
+		DecodedTile& decoded = area.tiles.back();
+
+		if(tile_type == OTBM_HOUSETILE) {
+			if(!tileNode->getU32(decoded.house_id)) {
+				area.warning("House tile without house data, discarding tile");
+				decoded.warning_count = area.warnings.size() - decoded.first_warning;
 				continue;
 			}
+			if(!decoded.house_id) {
+				area.warning("Invalid house id from tile %d:%d:%d", pos.x, pos.y, pos.z);
+			}
+		}
 
-			for(BinaryNode* tileNode = mapNode->getChild(); tileNode != nullptr; tileNode = tileNode->advance()) {
-				Tile* tile = nullptr;
-				uint8_t tile_type;
-				if(!tileNode->getByte(tile_type)) {
-					warning("Invalid tile type");
-					continue;
+		// The location is assigned once the tile is placed on the map
+		Tile* tile = newd Tile(pos.x, pos.y, pos.z);
+
+		uint8_t attribute;
+		while(tileNode->getU8(attribute)) {
+			switch(attribute) {
+				case OTBM_ATTR_TILE_FLAGS: {
+					uint32_t flags = 0;
+					if(!tileNode->getU32(flags)) {
+						area.warning("Invalid tile flags of tile on %d:%d:%d", pos.x, pos.y, pos.z);
+					}
+					tile->setMapFlags(flags);
+					break;
 				}
-				if(tile_type == OTBM_TILE || tile_type == OTBM_HOUSETILE) {
-					//printf("Start\n");
-					uint8_t x_offset, y_offset;
-					if(!tileNode->getU8(x_offset) || !tileNode->getU8(y_offset)) {
-						warning("Could not read position of tile");
-						continue;
+				case OTBM_ATTR_ITEM: {
+					Item* item = Item::Create_OTBM(*this, tileNode);
+					if(item == nullptr)
+					{
+						area.warning("Invalid item at tile %d:%d:%d", pos.x, pos.y, pos.z);
 					}
-					const Position pos(base_x + x_offset, base_y + y_offset, base_z);
+					tile->addItem(item);
+					break;
+				}
+				default: {
+					area.warning("Unknown tile attribute at %d:%d:%d", pos.x, pos.y, pos.z);
+					break;
+				}
+			}
+		}
 
-					if(map.getTile(pos)) {
-						warning("Duplicate tile at %d:%d:%d, discarding duplicate", pos.x, pos.y, pos.z);
-						continue;
+		for(BinaryNode* itemNode = tileNode->getChild(); itemNode != nullptr; itemNode = itemNode->advance()) {
+			Item* item = nullptr;
+			uint8_t item_type;
+			if(!itemNode->getByte(item_type)) {
+				area.warning("Unknown item type %d:%d:%d", pos.x, pos.y, pos.z);
+				continue;
+			}
+			if(item_type == OTBM_ITEM) {
+				item = Item::Create_OTBM(*this, itemNode);
+				if(item) {
+					if(!item->unserializeItemNode_OTBM(*this, itemNode)) {
+						area.warning("Couldn't unserialize item attributes at %d:%d:%d", pos.x, pos.y, pos.z);
 					}
+					//reform(&map, tile, item);
+					tile->addItem(item);
+				}
+			} else {
+				area.warning("Unknown type of tile child node");
+			}
+		}
 
-					tile = map.allocator(map.createTileL(pos));
-					House* house = nullptr;
-					if(tile_type == OTBM_HOUSETILE) {
-						uint32_t house_id;
-						if(!tileNode->getU32(house_id)) {
-							warning("House tile without house data, discarding tile");
-							continue;
-						}
-						if(house_id) {
-							house = map.houses.getHouse(house_id);
-							if(!house) {
-								house = newd House(map);
-								house->id = house_id;
-								map.houses.addHouse(house);
-							}
-						} else {
-							warning("Invalid house id from tile %d:%d:%d", pos.x, pos.y, pos.z);
-						}
-					}
+		tile->update();
+		decoded.tile = tile;
+		decoded.warning_count = area.warnings.size() - decoded.first_warning;
+	}
+}
 
-					//printf("So far so good\n");
-
-					uint8_t attribute;
-					while(tileNode->getU8(attribute)) {
-						switch(attribute) {
-							case OTBM_ATTR_TILE_FLAGS: {
-								uint32_t flags = 0;
-								if(!tileNode->getU32(flags)) {
-									warning("Invalid tile flags of tile on %d:%d:%d", pos.x, pos.y, pos.z);
-								}
-								tile->setMapFlags(flags);
-								break;
-							}
-							case OTBM_ATTR_ITEM: {
-								Item* item = Item::Create_OTBM(*this, tileNode);
-								if(item == nullptr)
-								{
-									warning("Invalid item at tile %d:%d:%d", pos.x, pos.y, pos.z);
-								}
-								tile->addItem(item);
-								break;
-							}
-							default: {
-								warning("Unknown tile attribute at %d:%d:%d", pos.x, pos.y, pos.z);
-								break;
-							}
-						}
-					}
+void IOMapOTBM::mergeTileArea(Map& map, DecodedTileArea& area)
+{
+	size_t next_warning = 0;
+	for(DecodedTile& decoded : area.tiles) {
+		// Warnings that came before this tile
+		for(; next_warning < decoded.first_warning; ++next_warning) {
+			warnings.push_back(area.warnings[next_warning]);
+		}
+		next_warning = decoded.first_warning + decoded.warning_count;
 
-					//printf("Didn't die in loop\n");
+		const Position& pos = decoded.position;
+		if(map.getTile(pos)) {
+			warning("Duplicate tile at %d:%d:%d, discarding duplicate", pos.x, pos.y, pos.z);
+			delete decoded.tile;
+			continue;
+		}
 
-					for(BinaryNode* itemNode = tileNode->getChild(); itemNode != nullptr; itemNode = itemNode->advance()) {
-						Item* item = nullptr;
-						uint8_t item_type;
-						if(!itemNode->getByte(item_type)) {
-							warning("Unknown item type %d:%d:%d", pos.x, pos.y, pos.z);
-							continue;
-						}
-						if(item_type == OTBM_ITEM) {
-							item = Item::Create_OTBM(*this, itemNode);
-							if(item) {
-								if(!item->unserializeItemNode_OTBM(*this, itemNode)) {
-									warning("Couldn't unserialize item attributes at %d:%d:%d", pos.x, pos.y, pos.z);
-								}
-								//reform(&map, tile, item);
-								tile->addItem(item);
-							}
-						} else {
-							warning("Unknown type of tile child node");
-						}
-					}
+		for(size_t i = decoded.first_warning; i < next_warning; ++i) {
+			warnings.push_back(area.warnings[i]);
+		}
 
-					tile->update();
-					if(house)
-						house->addTile(tile);
+		Tile* tile = decoded.tile;
+		if(!tile) {
+			continue;
+		}
+		tile->setLocation(map.createTileL(pos));
 
-					map.setTile(pos.x, pos.y, pos.z, tile);
-				} else {
-					warning("Unknown type of tile node");
-				}
+		if(decoded.house_id) {
+			House* house = map.houses.getHouse(decoded.house_id);
+			if(!house) {
+				house = newd House(map);
+				house->id = decoded.house_id;
+				map.houses.addHouse(house);
 			}
-		} else if(node_type == OTBM_TOWNS) {
-			for(BinaryNode* townNode = mapNode->getChild(); townNode != nullptr; townNode = townNode->advance()) {
-				Town* town = nullptr;
-				uint8_t town_type;
-				if(!townNode->getByte(town_type)) {
-					warning("Invalid town type (1)");
-					continue;
-				}
-				if(town_type != OTBM_TOWN) {
-					warning("Invalid town type (2)");
-					continue;
-				}
-				uint32_t town_id;
-				if(!townNode->getU32(town_id)) {
-					warning("Invalid town id");
-					continue;
-				}
+			house->addTile(tile);
+		}
 
-				town = map.towns.getTown(town_id);
-				if(town) {
-					warning("Duplicate town id %d, discarding duplicate", town_id);
-					continue;
-				} else {
-					town = newd Town(town_id);
-					if(!map.towns.addTown(town)) {
-						delete town;
-						continue;
-					}
-				}
-				std::string town_name;
-				if(!townNode->getString(town_name)) {
-					warning("Invalid town name");
-					continue;
-				}
-				town->setName(town_name);
-				Position pos;
-				uint16_t x;
-				uint16_t y;
-				uint8_t z;
-				if(!townNode->getU16(x) || !townNode->getU16(y) || !townNode->getU8(z)) {
-					warning("Invalid town temple position");
-					continue;
-				}
-				pos.x = x;
-				pos.y = y;
-				pos.z = z;
-				town->setTemplePosition(pos);
+		map.setTile(pos.x, pos.y, pos.z, tile);
+	}
+
+	for(; next_warning < area.warnings.size(); ++next_warning) {
+		warnings.push_back(area.warnings[next_warning]);
+	}
+	area.tiles.clear();
+}
+
+void IOMapOTBM::loadMapNodesThreaded(Map& map, NodeFileReadHandle& f, BinaryNode* mapHeaderNode, int threadcount)
+{
+	struct Job {
+		const uint8_t* data;
+		size_t size;
+		bool is_tile_area;
+		bool done; // Guarded by the done lock
+	};
+
+	// First pass, find where every map node starts and ends without decoding any tiles
+	std::vector<Job> jobs;
+	for(BinaryNode* mapNode = mapHeaderNode->getChild(); mapNode != nullptr; mapNode = mapNode->advance()) {
+		uint8_t node_type = 0;
+		mapNode->getByte(node_type);
+
+		uint16_t base_x = 0, base_y = 0;
+		uint8_t base_z = 0;
+		if(node_type == OTBM_TILE_AREA && file_index) {
+			if(!mapNode->getU16(base_x) || !mapNode->getU16(base_y) || !mapNode->getU8(base_z)) {
+				base_z = 0xFF; // Broken, leave it to the decoder to complain
 			}
-		} else if(node_type == OTBM_WAYPOINTS) {
-			for(BinaryNode* waypointNode = mapNode->getChild(); waypointNode != nullptr; waypointNode = waypointNode->advance()) {
-				uint8_t waypoint_type;
-				if(!waypointNode->getByte(waypoint_type)) {
-					warning("Invalid waypoint type (1)");
-					continue;
-				}
-				if(waypoint_type != OTBM_WAYPOINT) {
-					warning("Invalid waypoint type (2)");
-					continue;
-				}
+		}
 
-				Waypoint wp;
+		Job job;
+		if(!mapNode->skipChildren(job.data, job.size)) {
+			break;
+		}
+		job.is_tile_area = (node_type == OTBM_TILE_AREA);
+		job.done = false;
+		jobs.push_back(job);
+
+		if(job.is_tile_area && file_index) {
+			if(base_z > rme::MapMaxLayer || (base_x & 0xFF) || (base_y & 0xFF)) {
+				// Not written by us, areas might overlap so the index is useless
+				file_index->valid = false;
+			} else {
+				indexTileArea(f.getStreamOffset(job.data), job.size, Map::getAreaKey(base_x, base_y, base_z));
+			}
+		}
+	}
 
-				if(!waypointNode->getString(wp.name)) {
-					warning("Invalid waypoint name");
-					continue;
-				}
-				uint16_t x;
-				uint16_t y;
-				uint8_t z;
-				if(!waypointNode->getU16(x) || !waypointNode->getU16(y) || !waypointNode->getU8(z)) {
-					warning("Invalid waypoint position");
-					continue;
-				}
-				wp.pos.x = x;
-				wp.pos.y = y;
-				wp.pos.z = z;
+	// Second pass, decode all tile areas on the worker threads
+	std::vector<DecodedTileArea> areas(jobs.size());
+	std::mutex done_lock;
+	std::condition_variable done_signal;
+
+	std::function<void(size_t)> decode = [&](size_t index) {
+		Job& job = jobs[index];
+		if(job.is_tile_area) {
+			MemoryNodeFileReadHandle reader(job.data, job.size);
+			BinaryNode* areaNode = reader.getRootNode();
+			areaNode->skip(1); // Skip the type byte
+			decodeTileArea(areaNode, areas[index]);
+		}
+		{
+			std::lock_guard<std::mutex> guard(done_lock);
+			job.done = true;
+		}
+		done_signal.notify_one();
+	};
+
+	std::atomic<size_t> next_job(0);
+	std::vector<std::unique_ptr<WorkerThread>> threads;
+	for(int i = 0; i < threadcount; ++i) {
+		threads.emplace_back(newd WorkerThread(decode, next_job, jobs.size()));
+		threads.back()->Execute();
+	}
+
+	// Place the decoded tiles on the map in file order, as soon as they are ready
+	for(size_t index = 0; index < jobs.size(); ++index) {
+		Job& job = jobs[index];
+		{
+			std::unique_lock<std::mutex> guard(done_lock);
+			done_signal.wait(guard, [&job]() { return job.done; });
+		}
+
+		if(job.is_tile_area) {
+			mergeTileArea(map, areas[index]);
+		} else {
+			// Towns, waypoints and broken nodes are cheap, read them as usual
+			MemoryNodeFileReadHandle reader(job.data, job.size);
+			loadMapNode(map, reader.getRootNode());
+		}
+
+		if(index % 15 == 0) {
+			g_gui.SetLoadDone(static_cast<int32_t>(100.0 * (index + 1) / jobs.size()));
+		}
+	}
+
+	for(auto& thread : threads) {
+		thread->Wait();
+	}
+}
 
-				map.waypoints.addWaypoint(newd Waypoint(wp));
+void IOMapOTBM::loadTowns(Map& map, BinaryNode* mapNode)
+{
+	for(BinaryNode* townNode = mapNode->getChild(); townNode != nullptr; townNode = townNode->advance()) {
+		Town* town = nullptr;
+		uint8_t town_type;
+		if(!townNode->getByte(town_type)) {
+			warning("Invalid town type (1)");
+			continue;
+		}
+		if(town_type != OTBM_TOWN) {
+			warning("Invalid town type (2)");
+			continue;
+		}
+		uint32_t town_id;
+		if(!townNode->getU32(town_id)) {
+			warning("Invalid town id");
+			continue;
+		}
+
+		town = map.towns.getTown(town_id);
+		if(town) {
+			warning("Duplicate town id %d, discarding duplicate", town_id);
+			continue;
+		} else {
+			town = newd Town(town_id);
+			if(!map.towns.addTown(town)) {
+				delete town;
+				continue;
 			}
 		}
+		std::string town_name;
+		if(!townNode->getString(town_name)) {
+			warning("Invalid town name");
+			continue;
+		}
+		town->setName(town_name);
+		Position pos;
+		uint16_t x;
+		uint16_t y;
+		uint8_t z;
+		if(!townNode->getU16(x) || !townNode->getU16(y) || !townNode->getU8(z)) {
+			warning("Invalid town temple position");
+			continue;
+		}
+		pos.x = x;
+		pos.y = y;
+		pos.z = z;
+		town->setTemplePosition(pos);
 	}
+}
 
-	if(!f.isOk())
-		warning(wxstr(f.getErrorMessage()).wc_str());
-	return true;
+void IOMapOTBM::loadWaypoints(Map& map, BinaryNode* mapNode)
+{
+	for(BinaryNode* waypointNode = mapNode->getChild(); waypointNode != nullptr; waypointNode = waypointNode->advance()) {
+		uint8_t waypoint_type;
+		if(!waypointNode->getByte(waypoint_type)) {
+			warning("Invalid waypoint type (1)");
+			continue;
+		}
+		if(waypoint_type != OTBM_WAYPOINT) {
+			warning("Invalid waypoint type (2)");
+			continue;
+		}
+
+		Waypoint wp;
+
+		if(!waypointNode->getString(wp.name)) {
+			warning("Invalid waypoint name");
+			continue;
+		}
+		uint16_t x;
+		uint16_t y;
+		uint8_t z;
+		if(!waypointNode->getU16(x) || !waypointNode->getU16(y) || !waypointNode->getU8(z)) {
+			warning("Invalid waypoint position");
+			continue;
+		}
+		wp.pos.x = x;
+		wp.pos.y = y;
+		wp.pos.z = z;
+
+		map.waypoints.addWaypoint(newd Waypoint(wp));
+	}
 }
 
 bool IOMapOTBM::loadSpawns(Map& map, const FileName& dir)
@@ -1235,18 +1463,77 @@ bool IOMapOTBM::saveMap(Map& map, const FileName& identifier)
 	}
 #endif
 
-	DiskNodeFileWriteHandle f(
-		nstr(identifier.GetFullPath()),
-		(g_settings.getInteger(Config::SAVE_WITH_OTB_MAGIC_NUMBER) ? "OTBM" : std::string(4, '\0'))
-		);
+	std::string filename = nstr(identifier.GetFullPath());
 
-	if(!f.isOk()) {
-		error("Can not open file %s for writing", (const char*)identifier.GetFullPath().mb_str(wxConvUTF8));
-		return false;
+	// If the file the map was loaded from (or last saved to) is untouched, the
+	// areas that haven't changed since can be copied from it as they are
+	std::unique_ptr<MappedNodeFileReadHandle> previous;
+	const OTBMFileIndex* index = map.otbm_index.get();
+	if(g_settings.getInteger(Config::SAVE_INCREMENTALLY) && index && !map.all_areas_dirty &&
+		index->version.otbm == map.getVersion().otbm && index->version.client == map.getVersion().client && index->isCurrent())
+	{
+		previous.reset(newd MappedNodeFileReadHandle(index->filename, StringVector(1, "OTBM")));
+		if(previous->isOk()) {
+			for(const OTBMFileIndex::Area& area : index->areas) {
+				if(area.offset + area.size > previous->getMemorySize()) {
+					previous.reset();
+					break;
+				}
+			}
+		} else {
+			previous.reset();
+		}
 	}
 
-	if(!saveMap(map, f))
-		return false;
+	// Never overwrite the file that is being copied from
+	std::string write_filename = filename;
+	if(previous && FileName(wxstr(index->filename)).SameAs(identifier)) {
+		write_filename += ".tmp";
+	}
+
+	std::unique_ptr<OTBMFileIndex> new_index(newd OTBMFileIndex());
+	new_index->version = map.getVersion();
+	{
+		DiskNodeFileWriteHandle f(
+			write_filename,
+			(g_settings.getInteger(Config::SAVE_WITH_OTB_MAGIC_NUMBER) ? "OTBM" : std::string(4, '\0'))
+			);
+
+		if(!f.isOk()) {
+			error("Can not open file %s for writing", (const char*)wxstr(write_filename).mb_str(wxConvUTF8));
+			return false;
+		}
+
+		file_index = new_index.get();
+		if(previous) {
+			previous_index = index;
+			previous_data = previous->getMemory();
+		}
+
+		bool saved = saveMap(map, f);
+
+		file_index = nullptr;
+		previous_index = nullptr;
+		previous_data = nullptr;
+		if(!saved || !f.isOk()) {
+			if(saved) {
+				error("Could not write file %s", (const char*)wxstr(write_filename).mb_str(wxConvUTF8));
+			}
+			return false;
+		}
+	}
+
+	if(write_filename != filename) {
+		previous.reset();
+		if(!wxRenameFile(wxstr(write_filename), identifier.GetFullPath(), true)) {
+			error("Could not replace %s", (const char*)identifier.GetFullPath().mb_str(wxConvUTF8));
+			return false;
+		}
+	}
+
+	new_index->stamp(filename);
+	map.otbm_index = std::move(new_index);
+	map.clearDirtyAreas();
 
 	g_gui.SetLoadDone(99, "Saving spawns...");
 	saveSpawns(map, identifier);
@@ -1269,8 +1556,6 @@ bool IOMapOTBM::saveMap(Map& map, NodeFileWriteHandle& f)
 	 * format.
 	 */
 
-	const IOMapOTBM& self = *this;
-
 	FileName tmpName;
 	MapVersion mapVersion = map.getVersion();
 
@@ -1302,96 +1587,13 @@ bool IOMapOTBM::saveMap(Map& map, NodeFileWriteHandle& f)
 			f.addString(nstr(tmpName.GetFullName()));
 
 			// Start writing tiles
-			uint32_t tiles_saved = 0;
-			bool first = true;
-
-			int local_x = -1, local_y = -1, local_z = -1;
-
-			MapIterator map_iterator = map.begin();
-			while(map_iterator != map.end()) {
-				// Update progressbar
-				++tiles_saved;
-				if(tiles_saved % 8192 == 0)
-					g_gui.SetLoadDone(int(tiles_saved / double(map.getTileCount()) * 100.0));
-
-				// Get tile
-				Tile* save_tile = (*map_iterator)->get();
-
-				// Is it an empty tile that we can skip? (Leftovers...)
-				if(!save_tile || save_tile->size() == 0) {
-					++map_iterator;
-					continue;
-				}
-
-				const Position& pos = save_tile->getPosition();
-
-				// Decide if newd node should be created
-				if(pos.x < local_x || pos.x >= local_x + 256 || pos.y < local_y || pos.y >= local_y + 256 || pos.z != local_z) {
-					// End last node
-					if(!first) {
-						f.endNode();
-					}
-					first = false;
-
-					// Start newd node
-					f.addNode(OTBM_TILE_AREA);
-					f.addU16(local_x = pos.x & 0xFF00);
-					f.addU16(local_y = pos.y & 0xFF00);
-					f.addU8( local_z = pos.z);
-				}
-				f.addNode(save_tile->isHouseTile()? OTBM_HOUSETILE : OTBM_TILE);
-
-				f.addU8(save_tile->getX() & 0xFF);
-				f.addU8(save_tile->getY() & 0xFF);
-
-				if(save_tile->isHouseTile()) {
-					f.addU32(save_tile->getHouseID());
-				}
-
-				if(save_tile->getMapFlags()) {
-					f.addByte(OTBM_ATTR_TILE_FLAGS);
-					f.addU32(save_tile->getMapFlags());
-				}
-
-				if(save_tile->ground) {
-					Item* ground = save_tile->ground;
-					if(ground->isMetaItem()) {
-						// Do nothing, we don't save metaitems...
-					} else if(ground->hasBorderEquivalent()) {
-						bool found = false;
-						for(Item* item : save_tile->items) {
-							if(item->getGroundEquivalent() == ground->getID()) {
-								// Do nothing
-								// Found equivalent
-								found = true;
-								break;
-							}
-						}
-
-						if(!found) {
-							ground->serializeItemNode_OTBM(self, f);
-						}
-					} else if(ground->isComplex()) {
-						ground->serializeItemNode_OTBM(self, f);
-					} else {
-						f.addByte(OTBM_ATTR_ITEM);
-						ground->serializeItemCompact_OTBM(self, f);
-					}
-				}
-
-				for(Item* item : save_tile->items) {
-					if(!item->isMetaItem()) {
-						item->serializeItemNode_OTBM(self, f);
-					}
-				}
-
-				f.endNode();
-				++map_iterator;
-			}
-
-			// Only close the last node if one has actually been created
-			if(!first) {
-				f.endNode();
+			int threadcount = std::max(g_settings.getInteger(Config::WORKER_THREADS), 1);
+			if(previous_data) {
+				saveTileAreasIncremental(map, f);
+			} else if(threadcount > 1) {
+				saveTileAreasThreaded(map, f, threadcount);
+			} else {
+				saveTileAreas(map, f);
 			}
 
 			f.addNode(OTBM_TOWNS);
@@ -1428,6 +1630,310 @@ bool IOMapOTBM::saveMap(Map& map, NodeFileWriteHandle& f)
 	return true;
 }
 
+void IOMapOTBM::serializeTile(const Tile* save_tile, NodeFileWriteHandle& f) const
+{
+	const IOMapOTBM& self = *this;
+
+	f.addNode(save_tile->isHouseTile()? OTBM_HOUSETILE : OTBM_TILE);
+
+	f.addU8(save_tile->getX() & 0xFF);
+	f.addU8(save_tile->getY() & 0xFF);
+
+	if(save_tile->isHouseTile()) {
+		f.addU32(save_tile->getHouseID());
+	}
+
+	if(save_tile->getMapFlags()) {
+		f.addByte(OTBM_ATTR_TILE_FLAGS);
+		f.addU32(save_tile->getMapFlags());
+	}
+
+	if(save_tile->ground) {
+		Item* ground = save_tile->ground;
+		if(ground->isMetaItem()) {
+			// Do nothing, we don't save metaitems...
+		} else if(ground->hasBorderEquivalent()) {
+			bool found = false;
+			for(Item* item : save_tile->items) {
+				if(item->getGroundEquivalent() == ground->getID()) {
+					// Do nothing
+					// Found equivalent
+					found = true;
+					break;
+				}
+			}
+
+			if(!found) {
+				ground->serializeItemNode_OTBM(self, f);
+			}
+		} else if(ground->isComplex()) {
+			ground->serializeItemNode_OTBM(self, f);
+		} else {
+			f.addByte(OTBM_ATTR_ITEM);
+			ground->serializeItemCompact_OTBM(self, f);
+		}
+	}
+
+	for(Item* item : save_tile->items) {
+		if(!item->isMetaItem()) {
+			item->serializeItemNode_OTBM(self, f);
+		}
+	}
+
+	f.endNode();
+}
+
+void IOMapOTBM::saveTileAreas(Map& map, NodeFileWriteHandle& f)
+{
+	uint32_t tiles_saved = 0;
+	bool first = true;
+
+	int local_x = -1, local_y = -1, local_z = -1;
+	size_t area_offset = 0;
+
+	MapIterator map_iterator = map.begin();
+	while(map_iterator != map.end()) {
+		// Update progressbar
+		++tiles_saved;
+		if(tiles_saved % 8192 == 0)
+			g_gui.SetLoadDone(int(tiles_saved / double(map.getTileCount()) * 100.0));
+
+		// Get tile
+		Tile* save_tile = (*map_iterator)->get();
+
+		// Is it an empty tile that we can skip? (Leftovers...)
+		if(!save_tile || save_tile->size() == 0) {
+			++map_iterator;
+			continue;
+		}
+
+		const Position& pos = save_tile->getPosition();
+
+		// Decide if newd node should be created
+		if(pos.x < local_x || pos.x >= local_x + 256 || pos.y < local_y || pos.y >= local_y + 256 || pos.z != local_z) {
+			// End last node
+			if(!first) {
+				f.endNode();
+				indexTileArea(area_offset, f.getStreamOffset() - area_offset, Map::getAreaKey(local_x, local_y, local_z));
+			}
+			first = false;
+
+			// Start newd node
+			area_offset = f.getStreamOffset();
+			f.addNode(OTBM_TILE_AREA);
+			f.addU16(local_x = pos.x & 0xFF00);
+			f.addU16(local_y = pos.y & 0xFF00);
+			f.addU8( local_z = pos.z);
+		}
+		serializeTile(save_tile, f);
+		++map_iterator;
+	}
+
+	// Only close the last node if one has actually been created
+	if(!first) {
+		f.endNode();
+		indexTileArea(area_offset, f.getStreamOffset() - area_offset, Map::getAreaKey(local_x, local_y, local_z));
+	}
+}
+
+void IOMapOTBM::saveTileAreasThreaded(Map& map, NodeFileWriteHandle& f, int threadcount)
+{
+	// A run of tiles that goes into one OTBM_TILE_AREA node. The iteration
+	// order decides where nodes are split, so it is done up front exactly
+	// like the single threaded writer does it.
+	struct Job {
+		size_t first_tile;
+		size_t tile_count;
+		Position base;
+		std::unique_ptr<MemoryNodeFileWriteHandle> buffer;
+		bool done; // Guarded by the lock
+	};
+
+	std::vector<const Tile*> tiles;
+	tiles.reserve(map.getTileCount());
+	std::vector<Job> jobs;
+
+	int local_x = -1, local_y = -1, local_z = -1;
+	for(MapIterator map_iterator = map.begin(); map_iterator != map.end(); ++map_iterator) {
+		const Tile* save_tile = (*map_iterator)->get();
+		if(!save_tile || save_tile->size() == 0) {
+			continue;
+		}
+
+		const Position& pos = save_tile->getPosition();
+		if(jobs.empty() || pos.x < local_x || pos.x >= local_x + 256 || pos.y < local_y || pos.y >= local_y + 256 || pos.z != local_z) {
+			local_x = pos.x & 0xFF00;
+			local_y = pos.y & 0xFF00;
+			local_z = pos.z;
+			jobs.push_back(Job {tiles.size(), 0, Position(local_x, local_y, local_z), nullptr, false});
+		}
+		tiles.push_back(save_tile);
+		++jobs.back().tile_count;
+	}
+
+	// Workers may only run this far ahead of the file, so finished
+	// buffers don't pile up in memory while the disk catches up
+	const size_t window = static_cast<size_t>(threadcount) * 4;
+	size_t written = 0;
+	std::mutex lock;
+	std::condition_variable signal;
+
+	std::function<void(size_t)> encode = [&](size_t index) {
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			signal.wait(guard, [&]() { return index < written + window; });
+		}
+
+		Job& job = jobs[index];
+		std::unique_ptr<MemoryNodeFileWriteHandle> buffer(newd MemoryNodeFileWriteHandle);
+		buffer->addNode(OTBM_TILE_AREA);
+		buffer->addU16(job.base.x);
+		buffer->addU16(job.base.y);
+		buffer->addU8(job.base.z);
+		for(size_t i = job.first_tile; i < job.first_tile + job.tile_count; ++i) {
+			serializeTile(tiles[i], *buffer);
+		}
+		buffer->endNode();
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			job.buffer = std::move(buffer);
+			job.done = true;
+		}
+		signal.notify_all();
+	};
+
+	std::atomic<size_t> next_job(0);
+	std::vector<std::unique_ptr<WorkerThread>> threads;
+	for(int i = 0; i < threadcount; ++i) {
+		threads.emplace_back(newd WorkerThread(encode, next_job, jobs.size()));
+		threads.back()->Execute();
+	}
+
+#ifdef __DEBUG__
+	// Everything written is kept, to compare it with the serial writer at the end
+	MemoryNodeFileWriteHandle written_copy;
+#endif
+
+	// Write the areas to the file in order as they are finished
+	size_t tiles_saved = 0;
+	for(size_t index = 0; index < jobs.size(); ++index) {
+		Job& job = jobs[index];
+		std::unique_ptr<MemoryNodeFileWriteHandle> buffer;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			signal.wait(guard, [&job]() { return job.done; });
+			buffer = std::move(job.buffer);
+		}
+
+		indexTileArea(f.getStreamOffset(), buffer->getSize(), Map::getAreaKey(job.base.x, job.base.y, job.base.z));
+		f.addEncoded(buffer->getMemory(), buffer->getSize());
+#ifdef __DEBUG__
+		written_copy.addEncoded(buffer->getMemory(), buffer->getSize());
+#endif
+		buffer.reset();
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			++written;
+		}
+		signal.notify_all();
+
+		tiles_saved += job.tile_count;
+		g_gui.SetLoadDone(int(tiles_saved / double(map.getTileCount()) * 100.0));
+	}
+
+	for(auto& thread : threads) {
+		thread->Wait();
+	}
+
+#ifdef __DEBUG__
+	// The threaded writer must produce exactly the same bytes as the serial one
+	OTBMFileIndex* index = file_index;
+	file_index = nullptr;
+	MemoryNodeFileWriteHandle serial;
+	saveTileAreas(map, serial);
+	file_index = index;
+	ASSERT(serial.getSize() == written_copy.getSize());
+	ASSERT(memcmp(serial.getMemory(), written_copy.getMemory(), serial.getSize()) == 0);
+#endif
+}
+
+void IOMapOTBM::saveTileAreasIncremental(Map& map, NodeFileWriteHandle& f)
+{
+	ASSERT(previous_index && previous_data);
+
+	// Unchanged areas are copied straight from the previous file, node by node
+	size_t areas_done = 0;
+	const size_t area_count = previous_index->areas.size() + map.dirty_areas.size();
+	for(const OTBMFileIndex::Area& area : previous_index->areas) {
+		++areas_done;
+		if(map.isAreaDirty(area.key)) {
+			continue;
+		}
+
+		indexTileArea(f.getStreamOffset(), area.size, area.key);
+		f.addEncoded(previous_data + area.offset, area.size);
+
+		if(areas_done % 256 == 0) {
+			g_gui.SetLoadDone(int(areas_done / double(area_count) * 100.0));
+		}
+	}
+
+	// The changed ones are written again from the map, in a stable order
+	std::vector<uint32_t> dirty_areas(map.dirty_areas.begin(), map.dirty_areas.end());
+	std::sort(dirty_areas.begin(), dirty_areas.end());
+
+	for(uint32_t key : dirty_areas) {
+		++areas_done;
+		const int base_x = (key & 0xFF) << 8;
+		const int base_y = ((key >> 8) & 0xFF) << 8;
+		const int z = key >> 16;
+
+		size_t area_offset = f.getStreamOffset();
+		bool empty = true;
+		for(int x = base_x; x < base_x + 256; x += 4) {
+			for(int y = base_y; y < base_y + 256; y += 4) {
+				QTreeNode* leaf = map.getLeaf(x, y);
+				Floor* floor = (leaf ? leaf->getFloor(z) : nullptr);
+				if(!floor) {
+					continue;
+				}
+
+				for(TileLocation& location : floor->locs) {
+					const Tile* save_tile = location.get();
+					if(!save_tile || save_tile->size() == 0) {
+						continue;
+					}
+
+					if(empty) {
+						f.addNode(OTBM_TILE_AREA);
+						f.addU16(base_x);
+						f.addU16(base_y);
+						f.addU8(z);
+						empty = false;
+					}
+					serializeTile(save_tile, f);
+				}
+			}
+		}
+
+		// Areas that were cleared entirely simply disappear from the file
+		if(!empty) {
+			f.endNode();
+			indexTileArea(area_offset, f.getStreamOffset() - area_offset, key);
+		}
+		g_gui.SetLoadDone(int(areas_done / double(area_count) * 100.0));
+	}
+}
+
+void IOMapOTBM::indexTileArea(size_t offset, size_t size, uint32_t key)
+{
+	if(file_index) {
+		file_index->areas.push_back(OTBMFileIndex::Area {offset, size, key});
+	}
+}
+
 bool IOMapOTBM::saveSpawns(Map& map, const FileName& dir)
 {
 	wxString filepath = dir.GetPath(wxPATH_GET_SEPARATOR | wxPATH_GET_VOLUME);
@@ -116,10 +116,35 @@ struct OTBM_HouseTile_coords
 
 #pragma pack()
 
+// Where the tile area nodes of the file a map was last loaded from or saved
+// to are, so unchanged areas can be copied as they are on the next save
+struct OTBMFileIndex
+{
+	struct Area {
+		size_t offset; // Relative to the start of the node data, after the identifier
+		size_t size;
+		uint32_t key; // Map::getAreaKey
+	};
+
+	std::string filename;
+	wxULongLong file_size;
+	wxDateTime modified;
+	MapVersion version;
+	std::vector<Area> areas;
+	bool valid;
+
+	OTBMFileIndex() : file_size(0), valid(true) { }
+
+	// Remembers the state of the file, call once it has been written
+	void stamp(const std::string& name);
+	// True if the file is still the one this index was made for
+	bool isCurrent() const;
+};
+
 class IOMapOTBM : public IOMap
 {
 public:
-	IOMapOTBM(MapVersion ver) { version = ver; }
+	IOMapOTBM(MapVersion ver) : file_index(nullptr), previous_index(nullptr), previous_data(nullptr) { version = ver; }
 	~IOMapOTBM() {}
 
 	static bool getVersionInfo(const FileName& identifier, MapVersion& out_ver);
@@ -131,16 +156,39 @@ protected:
 	static bool getVersionInfo(NodeFileReadHandle* f,  MapVersion& out_ver);
 
 	virtual bool loadMap(Map& map, NodeFileReadHandle& handle);
+	void loadMapNode(Map& map, BinaryNode* mapNode);
+	void loadMapNodesThreaded(Map& map, NodeFileReadHandle& handle, BinaryNode* mapHeaderNode, int threadcount);
+	void loadTowns(Map& map, BinaryNode* mapNode);
+	void loadWaypoints(Map& map, BinaryNode* mapNode);
+
+	// Tile areas are decoded apart from the map so it can be done on several threads
+	struct DecodedTile;
+	struct DecodedTileArea;
+	void decodeTileArea(BinaryNode* mapNode, DecodedTileArea& area) const;
+	void mergeTileArea(Map& map, DecodedTileArea& area);
+
 	bool loadSpawns(Map& map, const FileName& dir);
 	bool loadSpawns(Map& map, pugi::xml_document& doc);
 	bool loadHouses(Map& map, const FileName& dir);
 	bool loadHouses(Map& map, pugi::xml_document& doc);
 
 	virtual bool saveMap(Map& map, NodeFileWriteHandle& handle);
+	void serializeTile(const Tile* tile, NodeFileWriteHandle& handle) const;
+	void saveTileAreas(Map& map, NodeFileWriteHandle& handle);
+	void saveTileAreasThreaded(Map& map, NodeFileWriteHandle& handle, int threadcount);
+	// Copies the unchanged areas from the previous file and only serializes the rest
+	void saveTileAreasIncremental(Map& map, NodeFileWriteHandle& handle);
+	void indexTileArea(size_t offset, size_t size, uint32_t key);
 	bool saveSpawns(Map& map, const FileName& dir);
 	bool saveSpawns(Map& map, pugi::xml_document& doc);
 	bool saveHouses(Map& map, const FileName& dir);
 	bool saveHouses(Map& map, pugi::xml_document& doc);
+
+	// Filled with the tile area layout while loading or saving, if set
+	OTBMFileIndex* file_index;
+	// The file being saved over and its layout, when saving incrementally
+	const OTBMFileIndex* previous_index;
+	const uint8_t* previous_data;
 };
 
 #endif
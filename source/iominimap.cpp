@@ -23,10 +23,44 @@
 #include "filehandle.h"
 #include "editor.h"
 #include "gui.h"
+#include "settings.h"
+#include "threads.h"
 
 #include <wx/image.h>
 #include <zlib.h>
 
+namespace {
+	bool isExported(const Tile* tile)
+	{
+		return tile && (tile->ground || !tile->items.empty());
+	}
+
+	uint32_t getChunkKey(int x, int y, int z, int chunk_size)
+	{
+		return (static_cast<uint32_t>(z) << 16) | (static_cast<uint32_t>(y / chunk_size) << 8) | static_cast<uint32_t>(x / chunk_size);
+	}
+
+	// Calls function(tile) for every tile in the area of the floor, a leaf at a time
+	template <typename Function>
+	void foreachTileInArea(Map& map, int start_x, int start_y, int size, int z, Function function)
+	{
+		for(int y = start_y; y < start_y + size; y += 4) {
+			for(int x = start_x; x < start_x + size; x += 4) {
+				QTreeNode* node = map.getLeaf(x, y);
+				Floor* floor = node ? node->getFloor(z) : nullptr;
+				if(!floor) {
+					continue;
+				}
+				for(TileLocation& location : floor->locs) {
+					if(Tile* tile = location.get()) {
+						function(tile);
+					}
+				}
+			}
+		}
+	}
+}
+
 void MinimapBlock::updateTile(int x, int y, const MinimapTile& tile)
 {
 	m_tiles[getTileIndex(x, y)] = tile;
@@ -88,31 +122,17 @@ bool IOMinimap::saveOtmm(const wxFileName& file)
 		writer.addU16(start);
 		writer.seek(start);
 
-		unsigned long blockSize = MMBLOCK_SIZE * MMBLOCK_SIZE * sizeof(MinimapTile);
-		std::vector<uint8_t> buffer(compressBound(blockSize));
-		constexpr int COMPRESS_LEVEL = 3;
-
-		readBlocks();
-
-		for(uint8_t z = 0; z <= rme::MapMaxLayer; ++z) {
-			for(auto& it : m_blocks[z]) {
-				int index = it.first;
-				auto& block = it.second;
-
-				// write index pos
-				uint16_t x = static_cast<uint16_t>((index % (65536 / MMBLOCK_SIZE)) * MMBLOCK_SIZE);
-				uint16_t y = static_cast<uint16_t>((index / (65536 / MMBLOCK_SIZE)) * MMBLOCK_SIZE);
-				writer.addU16(x);
-				writer.addU16(y);
-				writer.addU8(z);
-
-				unsigned long len = blockSize;
-				int ret = compress2(buffer.data(), &len, (uint8_t*)&block.getTiles(), blockSize, COMPRESS_LEVEL);
-				assert(ret == Z_OK);
-				writer.addU16(len);
-				writer.addRAW(buffer.data(), len);
-			}
-			m_blocks[z].clear();
+		if(m_mode != MinimapExportMode::SelectedArea || m_editor->hasSelection()) {
+			std::vector<Chunk> chunks = findChunks(m_mode == MinimapExportMode::SelectedArea);
+			std::vector<std::vector<uint8_t>> data(chunks.size());
+			forEachChunk(chunks, [&](size_t index) {
+				data[index] = writeOtmmChunk(chunks[index]);
+			}, [&](size_t first, size_t last) {
+				for(size_t index = first; index < last; ++index) {
+					writer.addRAW(data[index].data(), data[index].size());
+					std::vector<uint8_t>().swap(data[index]);
+				}
+			});
 		}
 
 		// end of file is an invalid pos
@@ -163,91 +183,10 @@ bool IOMinimap::exportMinimap(const std::string& directory)
 		return true;
 	}
 
-	wxRect bounds[rme::MapLayers];
-	int min_z = m_floor == -1 ? 0 : m_floor;
-	int max_z = m_floor == -1 ? rme::MapMaxLayer : m_floor;
-
-	for (size_t z = min_z; z <= max_z; z++) {
-		auto& rect = bounds[z];
-		rect.x = rme::MapMaxWidth + 1;
-		rect.y = rme::MapMaxHeight + 1;
-		rect.width = 0;
-		rect.height = 0;
-	}
-
-	for(auto it = map.begin(); it != map.end(); ++it) {
-		auto tile = (*it)->get();
-		if(!tile || (!tile->ground && tile->items.empty())) {
-			continue;
-		}
-
-		const auto& position = tile->getPosition();
-		auto& rect = bounds[position.z];
-		if(position.x < rect.x) {
-			rect.x = position.x;
-		}
-		if(position.y < rect.y) {
-			rect.y = position.y;
-		}
-		if (position.x > rect.width) {
-			rect.width = position.x;
-		}
-		if (position.y > rect.height) {
-			rect.height = position.y;
-		}
-	}
-
-	constexpr int image_size = 1024;
-	constexpr int pixels_size = image_size * image_size * rme::PixelFormatRGB;
-	uint8_t* pixels = new uint8_t[pixels_size];
-	auto image = new wxImage(image_size, image_size, pixels, true);
-
-	for(size_t z = min_z; z <= max_z; z++) {
-		auto& rect = bounds[z];
-		if(rect.IsEmpty()) {
-			continue;
-		}
-
-		for (int h = 0; h < rme::MapMaxHeight; h += image_size) {
-			for (int w = 0; w < rme::MapMaxWidth; w += image_size) {
-				if (w < rect.x || w > rect.width || h < rect.y || h > rect.height) {
-					continue;
-				}
-
-				bool empty = true;
-				memset(pixels, 0, pixels_size);
-
-				int index = 0;
-				for (int y = 0; y < image_size; y++) {
-					for (int x = 0; x < image_size; x++) {
-						auto tile = map.getTile(w + x, h + y, z);
-						if(!tile || (!tile->ground && tile->items.empty())) {
-							index += rme::PixelFormatRGB;
-							continue;
-						}
-						uint8_t color = tile->getMiniMapColor();
-						pixels[index  ] = (uint8_t)(static_cast<int>(color / 36) % 6 * 51); // red
-						pixels[index+1] = (uint8_t)(static_cast<int>(color / 6) % 6 * 51);  // green
-						pixels[index+2] = (uint8_t)(color % 6 * 51);                        // blue
-						index += rme::PixelFormatRGB;
-						empty = false;
-					}
-				}
-
-				if (!empty) {
-					image->SetData(pixels, true);
-					wxString extension = m_format == MinimapExportFormat::Png ? "png" : "bmp";
-					wxBitmapType type = m_format == MinimapExportFormat::Png ? wxBITMAP_TYPE_PNG : wxBITMAP_TYPE_BMP; 
-					wxFileName file = wxString::Format("%d-%d-%d.%s", h, w, z, extension);
-					file.Normalize(wxPATH_NORM_ALL, directory);
-					image->SaveFile(file.GetFullPath(), type);
-				}
-			}
-		}
-	}
-
-	image->Destroy();
-	delete[] pixels;
+	std::vector<Chunk> chunks = findChunks(false);
+	forEachChunk(chunks, [&](size_t index) {
+		writeImageChunk(chunks[index], directory);
+	});
 	return true;
 }
 
@@ -348,59 +287,142 @@ bool IOMinimap::exportSelection(const std::string& directory, const std::string&
 	return true;
 }
 
-void IOMinimap::readBlocks()
+std::vector<IOMinimap::Chunk> IOMinimap::findChunks(bool selectedTiles)
 {
-	if (m_mode == MinimapExportMode::SelectedArea && !m_editor->hasSelection()) {
-		return;
-	}
+	struct ChunkFinder {
+		int floor;
+		std::vector<uint32_t> keys;
+		void operator()(Map&, Tile* tile) {
+			const Position& position = tile->getPosition();
+			if(!isExported(tile) || (floor != -1 && position.z != floor)) {
+				return;
+			}
+			// Tiles of a region are close together, most are in the chunk of the last one
+			uint32_t key = getChunkKey(position.x, position.y, position.z, ChunkSize);
+			if(keys.empty() || keys.back() != key) {
+				keys.push_back(key);
+			}
+		}
+	};
 
 	auto& map = m_editor->getMap();
+	const int floor = m_mode == MinimapExportMode::SelectedArea ? -1 : m_floor;
+	std::vector<uint32_t> keys;
+	for(const ChunkFinder& finder : foreach_TileOnMapParallel(map, ChunkFinder{floor, {}}, selectedTiles, g_settings.getInteger(Config::WORKER_THREADS))) {
+		keys.insert(keys.end(), finder.keys.begin(), finder.keys.end());
+	}
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+	std::vector<Chunk> chunks;
+	chunks.reserve(keys.size());
+	for(uint32_t key : keys) {
+		Chunk chunk;
+		chunk.x = static_cast<int>(key & 0xFF) * ChunkSize;
+		chunk.y = static_cast<int>((key >> 8) & 0xFF) * ChunkSize;
+		chunk.z = static_cast<int>(key >> 16);
+		chunks.push_back(chunk);
+	}
+	return chunks;
+}
 
-	int tiles_iterated = 0;
-	for(auto it = map.begin(); it != map.end(); ++it) {
-		auto tile = (*it)->get();
-
-		if (m_updateLoadbar) {
-			++tiles_iterated;
-			if (tiles_iterated % 8192 == 0) {
-				g_gui.SetLoadDone(int(tiles_iterated / double(map.size()) * 90.0));
-			}
+void IOMinimap::forEachChunk(const std::vector<Chunk>& chunks, const std::function<void(size_t)>& work, const std::function<void(size_t, size_t)>& done)
+{
+	const int threadcount = std::max(g_settings.getInteger(Config::WORKER_THREADS), 1);
+	const size_t batch_size = static_cast<size_t>(threadcount) * 4;
+
+	for(size_t first = 0; first < chunks.size(); first += batch_size) {
+		const size_t count = std::min(batch_size, chunks.size() - first);
+		RunJobs(count, threadcount, [&](size_t index) {
+			work(first + index);
+		});
+		if(done) {
+			done(first, first + count);
 		}
 
-		if(!tile || (!tile->ground && tile->items.empty())) {
-			continue;
+		if(m_updateLoadbar) {
+			g_gui.SetLoadDone(static_cast<int>(100 * (first + count) / chunks.size()));
 		}
+	}
+}
 
-		const auto& position = tile->getPosition();
+std::vector<uint8_t> IOMinimap::writeOtmmChunk(const Chunk& chunk)
+{
+	constexpr int COMPRESS_LEVEL = 3;
+	const unsigned long blockSize = MMBLOCK_SIZE * MMBLOCK_SIZE * sizeof(MinimapTile);
+	const bool selectedOnly = m_mode == MinimapExportMode::SelectedArea;
+
+	auto& map = m_editor->getMap();
+	std::vector<uint8_t> buffer(compressBound(blockSize));
+	std::vector<uint8_t> data;
+
+	for(int block_y = chunk.y; block_y < chunk.y + ChunkSize; block_y += MMBLOCK_SIZE) {
+		for(int block_x = chunk.x; block_x < chunk.x + ChunkSize; block_x += MMBLOCK_SIZE) {
+			MinimapBlock block;
+			bool empty = true;
+			foreachTileInArea(map, block_x, block_y, MMBLOCK_SIZE, chunk.z, [&](Tile* tile) {
+				if(!isExported(tile) || (selectedOnly && !tile->isSelected())) {
+					return;
+				}
 
-		if (m_mode == MinimapExportMode::SelectedArea) {
-			if (!tile->isSelected()) {
+				MinimapTile minimapTile;
+				minimapTile.color = tile->getMiniMapColor();
+				minimapTile.flags |= MinimapTileWasSeen;
+				if(tile->isBlocking()) {
+					minimapTile.flags |= MinimapTileNotWalkable;
+				}
+				//if (!tile->isPathable()) {
+					//minimapTile.flags |= MinimapTileNotPathable;
+				//}
+				minimapTile.speed = std::min<int>((int)std::ceil(tile->getGroundSpeed() / 10.f), 0xFF);
+				block.updateTile(tile->getX() - block_x, tile->getY() - block_y, minimapTile);
+				empty = false;
+			});
+			if(empty) {
 				continue;
 			}
-		} else if (m_floor != -1 && position.z != m_floor) {
-			continue;
-		}
 
-		MinimapTile minimapTile;
-		minimapTile.color = tile->getMiniMapColor();
-		minimapTile.flags |= MinimapTileWasSeen;
-		if (tile->isBlocking()) {
-			minimapTile.flags |= MinimapTileNotWalkable;
-		}
-		//if (!tile->isPathable()) {
-			//minimapTile.flags |= MinimapTileNotPathable;
-		//}
-		minimapTile.speed = std::min<int>((int)std::ceil(tile->getGroundSpeed() / 10.f), 0xFF);
-
-		auto& blocks = m_blocks[position.z];
-		uint32_t index = getBlockIndex(position);
-		if (blocks.find(index) == blocks.end()) {
-			blocks.insert({ index, MinimapBlock() });
+			unsigned long len = buffer.size();
+			int ret = compress2(buffer.data(), &len, (uint8_t*)&block.getTiles(), blockSize, COMPRESS_LEVEL);
+			assert(ret == Z_OK);
+
+			// position, compressed size and the block itself
+			const uint8_t header[] = {
+				static_cast<uint8_t>(block_x), static_cast<uint8_t>(block_x >> 8),
+				static_cast<uint8_t>(block_y), static_cast<uint8_t>(block_y >> 8),
+				static_cast<uint8_t>(chunk.z),
+				static_cast<uint8_t>(len), static_cast<uint8_t>(len >> 8)
+			};
+			data.insert(data.end(), header, header + sizeof(header));
+			data.insert(data.end(), buffer.begin(), buffer.begin() + len);
 		}
+	}
+	return data;
+}
+
+void IOMinimap::writeImageChunk(const Chunk& chunk, const std::string& directory)
+{
+	std::vector<uint8_t> pixels(ChunkSize * ChunkSize * rme::PixelFormatRGB, 0);
+	bool empty = true;
 
-		auto& block = blocks.at(index);
-		int offset_x = position.x - (position.x % MMBLOCK_SIZE);
-		int offset_y = position.y - (position.y % MMBLOCK_SIZE);
-		block.updateTile(position.x - offset_x, position.y - offset_y, minimapTile);
+	foreachTileInArea(m_editor->getMap(), chunk.x, chunk.y, ChunkSize, chunk.z, [&](Tile* tile) {
+		if(!isExported(tile)) {
+			return;
+		}
+		uint8_t color = tile->getMiniMapColor();
+		size_t index = ((tile->getY() - chunk.y) * ChunkSize + (tile->getX() - chunk.x)) * rme::PixelFormatRGB;
+		pixels[index  ] = (uint8_t)(static_cast<int>(color / 36) % 6 * 51); // red
+		pixels[index+1] = (uint8_t)(static_cast<int>(color / 6) % 6 * 51);  // green
+		pixels[index+2] = (uint8_t)(color % 6 * 51);                        // blue
+		empty = false;
+	});
+
+	if(!empty) {
+		wxImage image(ChunkSize, ChunkSize, pixels.data(), true);
+		wxString extension = m_format == MinimapExportFormat::Png ? "png" : "bmp";
+		wxBitmapType type = m_format == MinimapExportFormat::Png ? wxBITMAP_TYPE_PNG : wxBITMAP_TYPE_BMP;
+		wxFileName file = wxString::Format("%d-%d-%d.%s", chunk.y, chunk.x, chunk.z, extension);
+		file.Normalize(wxPATH_NORM_ALL, directory);
+		image.SaveFile(file.GetFullPath(), type);
 	}
 }
@@ -80,17 +80,26 @@ private:
 	bool saveImage(const std::string& directory, const std::string& name);
 	bool exportMinimap(const std::string& directory);
 	bool exportSelection(const std::string& directory, const std::string& name);
-	void readBlocks();
-	inline uint32_t getBlockIndex(const Position& pos) {
-		return ((pos.y / MMBLOCK_SIZE) * (65536 / MMBLOCK_SIZE)) + (pos.x / MMBLOCK_SIZE);
-	}
+
+	// The map is exported in chunks of ChunkSize x ChunkSize tiles of a floor,
+	// one image file each. Chunks are built on the worker threads, a batch at a
+	// time, so only a batch of them is ever held in memory.
+	static const int ChunkSize = 1024;
+	struct Chunk {
+		int x, y, z; // Top left tile
+	};
+	std::vector<Chunk> findChunks(bool selectedTiles);
+	// Calls work for every chunk on the worker threads, then done (if any) on
+	// this thread with the range of chunks finished, in order
+	void forEachChunk(const std::vector<Chunk>& chunks, const std::function<void(size_t)>& work, const std::function<void(size_t, size_t)>& done = nullptr);
+	std::vector<uint8_t> writeOtmmChunk(const Chunk& chunk);
+	void writeImageChunk(const Chunk& chunk, const std::string& directory);
 
 	Editor* m_editor;
 	MinimapExportFormat m_format;
 	MinimapExportMode m_mode;
 	bool m_updateLoadbar = false;
 	int m_floor = -1;
-	std::unordered_map<uint32_t, MinimapBlock> m_blocks[rme::MapLayers];
 	std::string m_error;
 };
 
@@ -22,6 +22,7 @@
 #include "iomap_otbm.h"
 //#include "iomap_otmm.h"
 #include "item_attributes.h"
+#include "memory_pool.h"
 
 enum ITEMPROPERTY {
 	BLOCKSOLID,
@@ -80,6 +81,9 @@ struct SpriteLight;
 class Item : public ItemAttributes
 {
 public:
+	// Also covers the subclasses, they all have a virtual destructor through Item
+	POOLED_ALLOCATION
+
 	//Factory member to create item of right type based on type
 	static Item* Create(uint16_t id, uint16_t subtype = 0xFFFF);
 	static Item* Create(pugi::xml_node);
@@ -100,6 +104,7 @@ public:
 	uint32_t memsize() const;
 
 	virtual Container* getContainer() { return nullptr; }
+	virtual const Container* getContainer() const { return nullptr; }
 	virtual Depot* getDepot() { return nullptr; }
 	virtual Teleport* getTeleport() { return nullptr; }
 	virtual Door* getDoor() { return nullptr; }
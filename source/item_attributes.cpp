@@ -26,7 +26,8 @@ ItemAttributes::ItemAttributes() :
 	////
 }
 
-ItemAttributes::ItemAttributes(const ItemAttributes& o)
+ItemAttributes::ItemAttributes(const ItemAttributes& o) :
+	attributes(nullptr)
 {
 	if(o.attributes)
 		attributes = newd ItemAttributeMap(*o.attributes);
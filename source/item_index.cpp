@@ -0,0 +1,215 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "item_index.h"
+#include "basemap.h"
+#include "complexitem.h"
+#include "tile.h"
+
+#include <algorithm>
+
+void ItemIndex::build(BaseMap& map)
+{
+	clear();
+
+	// Cells are only appended while building, then sorted once
+	building = true;
+	for(MapIterator it = map.begin(); it != map.end(); ++it) {
+		addTile((*it)->get());
+	}
+	building = false;
+
+	for(auto& key_values : values) {
+		for(auto& value : key_values) {
+			auto& counts = value.counts;
+			std::sort(counts.begin(), counts.end());
+
+			size_t merged = 0;
+			for(size_t i = 0; i < counts.size(); ++i) {
+				if(merged > 0 && counts[merged - 1].first == counts[i].first) {
+					counts[merged - 1].second += counts[i].second;
+				} else {
+					counts[merged++] = counts[i];
+				}
+			}
+			counts.resize(merged);
+
+			if(counts.size() > getMaxCells()) {
+				value.common = true;
+				counts.clear();
+			}
+			counts.shrink_to_fit();
+		}
+	}
+}
+
+void ItemIndex::clear()
+{
+	for(auto& key_values : values) {
+		key_values.assign(0x10000, Cells());
+	}
+	tiles = 0;
+}
+
+bool ItemIndex::findTiles(BaseMap& map, Key key, uint16_t value, std::vector<Tile*>& tiles) const
+{
+	tiles.clear();
+
+	const Cells& cells = values[key][value];
+	if(cells.common || cells.counts.size() > getMaxCells()) {
+		return false;
+	}
+
+	for(const auto& count : cells.counts) {
+		const uint32_t cell = count.first;
+		const int z = cell >> 28;
+		const int y = ((cell >> 14) & 0x3FFF) * CellSize;
+		const int x = (cell & 0x3FFF) * CellSize;
+		for(int dy = 0; dy < CellSize; ++dy) {
+			for(int dx = 0; dx < CellSize; ++dx) {
+				Tile* tile = map.getTile(x + dx, y + dy, z);
+				if(tile && hasValue(tile, key, value)) {
+					tiles.push_back(tile);
+				}
+			}
+		}
+	}
+
+	std::sort(tiles.begin(), tiles.end(), [](const Tile* a, const Tile* b) {
+		return a->getPosition() < b->getPosition();
+	});
+	return true;
+}
+
+bool ItemIndex::hasValue(const Tile* tile, Key key, uint16_t value)
+{
+	if(tile->ground && hasValue(tile->ground, key, value)) {
+		return true;
+	}
+	for(const Item* item : tile->items) {
+		if(hasValue(item, key, value)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ItemIndex::hasValue(const Item* item, Key key, uint16_t value)
+{
+	const uint16_t item_value = getValue(item, key);
+	if(value == 0 ? item_value != 0 : item_value == value) {
+		return true;
+	}
+	if(const Container* container = item->getContainer()) {
+		for(const Item* inner : container->getVector()) {
+			if(hasValue(inner, key, value)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+uint16_t ItemIndex::getValue(const Item* item, Key key)
+{
+	switch(key) {
+		case ITEM_ID: return item->getID();
+		case ACTION_ID: return item->getActionID();
+		case UNIQUE_ID: return item->getUniqueID();
+		default: return 0;
+	}
+}
+
+size_t ItemIndex::getMaxCells() const
+{
+	// Every tile of a cell is looked at, once the cells hold more than a
+	// quarter of the map's tiles the walk is cheaper
+	return std::max<size_t>(tiles / (4 * CellSize * CellSize), 1);
+}
+
+uint32_t ItemIndex::getCell(const Position& position)
+{
+	return static_cast<uint32_t>(position.x / CellSize) |
+		(static_cast<uint32_t>(position.y / CellSize) << 14) |
+		(static_cast<uint32_t>(position.z) << 28);
+}
+
+void ItemIndex::update(const Tile* tile, int change)
+{
+	if(!tile) {
+		return;
+	}
+
+	tiles += change;
+
+	const uint32_t cell = getCell(tile->getPosition());
+	if(tile->ground) {
+		update(tile->ground, cell, change);
+	}
+	for(const Item* item : tile->items) {
+		update(item, cell, change);
+	}
+}
+
+void ItemIndex::update(const Item* item, uint32_t cell, int change)
+{
+	for(int key = 0; key < KEY_COUNT; ++key) {
+		const uint16_t value = getValue(item, static_cast<Key>(key));
+		if(value != 0) {
+			update(static_cast<Key>(key), value, cell, change);
+			update(static_cast<Key>(key), 0, cell, change);
+		}
+	}
+
+	if(const Container* container = item->getContainer()) {
+		for(const Item* inner : container->getVector()) {
+			update(inner, cell, change);
+		}
+	}
+}
+
+void ItemIndex::update(Key key, uint16_t value, uint32_t cell, int change)
+{
+	Cells& cells = values[key][value];
+	if(cells.common) {
+		return;
+	}
+
+	auto& counts = cells.counts;
+	if(building) {
+		if(!counts.empty() && counts.back().first == cell) {
+			++counts.back().second;
+		} else {
+			counts.emplace_back(cell, 1);
+		}
+		return;
+	}
+
+	auto entry = std::lower_bound(counts.begin(), counts.end(), cell, [](const std::pair<uint32_t, uint32_t>& count, uint32_t cell) {
+		return count.first < cell;
+	});
+	if(change > 0) {
+		if(entry == counts.end() || entry->first != cell) {
+			entry = counts.insert(entry, std::make_pair(cell, 0u));
+		}
+		++entry->second;
+	} else if(entry != counts.end() && entry->first == cell && --entry->second == 0) {
+		counts.erase(entry);
+	}
+}
@@ -0,0 +1,85 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_ITEM_INDEX_H_
+#define RME_ITEM_INDEX_H_
+
+#include "position.h"
+
+#include <vector>
+
+class BaseMap;
+class Item;
+class Tile;
+
+// Keeps track of the 4x4 tile cells of the map holding each item id,
+// action id and unique id, so searches for a rare value only look at its
+// cells instead of walking the whole map. It is built from the whole map
+// on the first search, then whole tiles are added and removed as they are
+// placed on the map or taken off it. Tiles changed in place can leave
+// values behind, so the tiles found are always checked before being
+// returned.
+class ItemIndex
+{
+public:
+	enum Key {
+		ITEM_ID,
+		ACTION_ID,
+		UNIQUE_ID,
+		KEY_COUNT
+	};
+
+	static const int CellSize = 4;
+
+	void build(BaseMap& map);
+	void addTile(const Tile* tile) { update(tile, 1); }
+	void removeTile(const Tile* tile) { update(tile, -1); }
+	void clear();
+
+	// Tiles with an item holding the value (any value but 0 if value is 0),
+	// also inside containers, sorted by position. Returns false without
+	// looking at any tile when the value is in so many cells that walking
+	// the whole map is cheaper.
+	bool findTiles(BaseMap& map, Key key, uint16_t value, std::vector<Tile*>& tiles) const;
+
+	static bool hasValue(const Tile* tile, Key key, uint16_t value);
+
+private:
+	// Cells holding a value and how many items hold it in each, sorted by
+	// cell. Values found in too many cells when building are only marked
+	// as common, cells added later are checked against the limit when
+	// searching.
+	struct Cells {
+		std::vector<std::pair<uint32_t, uint32_t>> counts;
+		bool common = false;
+	};
+
+	static bool hasValue(const Item* item, Key key, uint16_t value);
+	static uint16_t getValue(const Item* item, Key key);
+	static uint32_t getCell(const Position& position);
+	size_t getMaxCells() const;
+	void update(const Tile* tile, int change);
+	void update(const Item* item, uint32_t cell, int change);
+	void update(Key key, uint16_t value, uint32_t cell, int change);
+
+	// Indexed by value, 0 holds the cells with any value
+	std::vector<Cells> values[KEY_COUNT];
+	size_t tiles = 0;
+	bool building = false;
+};
+
+#endif
@@ -0,0 +1,148 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "item_replacer.h"
+#include "complexitem.h"
+#include "editor.h"
+#include "map.h"
+#include "tile.h"
+
+ItemReplacer::ItemReplacer(uint32_t limit) :
+	limit(limit),
+	table(0x10000),
+	rules(0x10000, 0)
+{
+	for(size_t id = 0; id < table.size(); ++id) {
+		table[id] = static_cast<uint16_t>(id);
+	}
+}
+
+void ItemReplacer::addRule(uint16_t from, uint16_t to)
+{
+	const uint16_t rule = static_cast<uint16_t>(counts.size() + 1);
+	for(size_t id = 0; id < table.size(); ++id) {
+		if(table[id] == from) {
+			if(rules[id] == 0) {
+				rules[id] = rule;
+			}
+			table[id] = to;
+		}
+	}
+	counts.push_back(0);
+}
+
+Action* ItemReplacer::execute(Editor& editor, bool selection_only, int threadcount)
+{
+	Map& map = editor.getMap();
+	struct Finder {
+		const ItemReplacer* replacer;
+		std::vector<Tile*> found;
+		void operator()(Map& map, Tile* tile) {
+			if(replacer->hasMatch(tile)) {
+				found.push_back(tile);
+			}
+		}
+	};
+
+	// Finding the tiles only reads the map, so it can go on in parallel
+	std::vector<Finder> found = foreach_TileOnMapParallel(map, Finder{this, {}}, selection_only, threadcount);
+
+	// Regions are in map order, so the limit hits the same items as always
+	Action* action = editor.createAction(ACTION_REPLACE_ITEMS);
+	for(const Finder& finder : found) {
+		for(const Tile* tile : finder.found) {
+			Tile* new_tile = tile->deepCopy(map);
+			if(replaceItems(new_tile) > 0) {
+				action->addChange(newd Change(new_tile));
+			} else {
+				delete new_tile;
+			}
+		}
+	}
+
+	if(action->empty()) {
+		delete action;
+		return nullptr;
+	}
+	return action;
+}
+
+bool ItemReplacer::hasMatch(const Tile* tile) const
+{
+	if(tile->ground && table[tile->ground->getID()] != tile->ground->getID()) {
+		return true;
+	}
+	return hasMatch(tile->items);
+}
+
+bool ItemReplacer::hasMatch(const ItemVector& items) const
+{
+	for(const Item* item : items) {
+		if(table[item->getID()] != item->getID()) {
+			return true;
+		}
+		const Container* container = item->getContainer();
+		if(container && hasMatch(container->getVector())) {
+			return true;
+		}
+	}
+	return false;
+}
+
+uint32_t ItemReplacer::replaceItems(Tile* tile)
+{
+	uint32_t replaced = 0;
+	if(tile->ground) {
+		replaced += replaceItem(tile->ground);
+	}
+	return replaced + replaceItems(tile->items);
+}
+
+uint32_t ItemReplacer::replaceItems(ItemVector& items)
+{
+	uint32_t replaced = 0;
+	for(Item*& item : items) {
+		replaced += replaceItem(item);
+		Container* container = item->getContainer();
+		if(container) {
+			replaced += replaceItems(container->getVector());
+		}
+	}
+	return replaced;
+}
+
+uint32_t ItemReplacer::replaceItem(Item*& item)
+{
+	const uint16_t id = item->getID();
+	const uint16_t new_id = table[id];
+	if(new_id == id) {
+		return 0;
+	}
+
+	uint32_t& count = counts[rules[id] - 1];
+	if(limit > 0 && count >= limit) {
+		return 0;
+	}
+
+	Item* old_item = item;
+	item = transformItem(old_item, new_id);
+	delete old_item;
+	++count;
+	return 1;
+}
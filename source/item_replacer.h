@@ -0,0 +1,62 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_ITEM_REPLACER_H_
+#define RME_ITEM_REPLACER_H_
+
+#include "item.h"
+
+class Editor;
+class Action;
+class Tile;
+
+// Replaces items all over the map in a single pass. The rules are compiled
+// into one table from every item id to the id it ends up as, so the map is
+// walked once no matter how many rules there are. The walk is split over
+// worker threads by tree region, only the tiles found are copied.
+class ItemReplacer
+{
+public:
+	// At most limit items are replaced per rule, 0 for no limit
+	explicit ItemReplacer(uint32_t limit = 0);
+
+	// Rules act as if they ran one after the other, so a rule also
+	// replaces what earlier rules replaced with its id
+	void addRule(uint16_t from, uint16_t to);
+	bool empty() const noexcept { return counts.empty(); }
+
+	// Returns an action with a changed copy of every tile that has items to
+	// replace, nullptr if there are none
+	Action* execute(Editor& editor, bool selection_only, int threadcount);
+
+	// Items replaced for the rule added as the index'th one
+	uint32_t getReplacedCount(size_t index) const { return counts.at(index); }
+
+private:
+	bool hasMatch(const Tile* tile) const;
+	bool hasMatch(const ItemVector& items) const;
+	uint32_t replaceItems(Tile* tile);
+	uint32_t replaceItems(ItemVector& items);
+	uint32_t replaceItem(Item*& item);
+
+	uint32_t limit;
+	std::vector<uint16_t> table; // Item id to the id it is replaced with
+	std::vector<uint16_t> rules; // Item id to the first rule replacing it, plus one
+	std::vector<uint32_t> counts;
+};
+
+#endif
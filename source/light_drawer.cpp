@@ -18,6 +18,38 @@
 #include "main.h"
 #include "light_drawer.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define RME_LIGHT_SSE2
+#	include <emmintrin.h>
+#endif
+
+namespace {
+#ifdef RME_LIGHT_SSE2
+	// Lights four tiles of a row at once, dx is the offset of the first one
+	// from the light. Same math as LightDrawer::calculateIntensity.
+	inline void blendLight4(uint8_t* pixels, int dx, int dy, float light_intensity, __m128 color)
+	{
+		__m128 offset_x = _mm_cvtepi32_ps(_mm_setr_epi32(dx, dx + 1, dx + 2, dx + 3));
+		__m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(offset_x, offset_x), _mm_set1_ps(static_cast<float>(dy * dy))));
+		__m128 intensity = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(light_intensity), distance), _mm_set1_ps(0.2f));
+		__m128 lit = _mm_and_ps(
+			_mm_cmple_ps(distance, _mm_set1_ps(static_cast<float>(rme::MaxLightIntensity))),
+			_mm_cmpge_ps(intensity, _mm_set1_ps(0.01f)));
+		intensity = _mm_and_ps(_mm_min_ps(intensity, _mm_set1_ps(1.f)), lit);
+
+		// One RGBA pixel per intensity, alpha is 0 so max() keeps the old one
+		__m128i p0 = _mm_cvttps_epi32(_mm_mul_ps(_mm_shuffle_ps(intensity, intensity, _MM_SHUFFLE(0, 0, 0, 0)), color));
+		__m128i p1 = _mm_cvttps_epi32(_mm_mul_ps(_mm_shuffle_ps(intensity, intensity, _MM_SHUFFLE(1, 1, 1, 1)), color));
+		__m128i p2 = _mm_cvttps_epi32(_mm_mul_ps(_mm_shuffle_ps(intensity, intensity, _MM_SHUFFLE(2, 2, 2, 2)), color));
+		__m128i p3 = _mm_cvttps_epi32(_mm_mul_ps(_mm_shuffle_ps(intensity, intensity, _MM_SHUFFLE(3, 3, 3, 3)), color));
+		__m128i packed = _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+
+		__m128i* target = reinterpret_cast<__m128i*>(pixels);
+		_mm_storeu_si128(target, _mm_max_epu8(_mm_loadu_si128(target), packed));
+	}
+#endif
+}
+
 LightDrawer::LightDrawer()
 {
 	texture = 0;
@@ -36,34 +68,46 @@ LightDrawer::~LightDrawer()
 
 void LightDrawer::draw(int map_x, int map_y, int scroll_x, int scroll_y)
 {
-	constexpr int half_tile_size = rme::TileSize / 2;
-
-	for (int x = 0; x < rme::ClientMapWidth; ++x) {
-		for (int y = 0; y < rme::ClientMapHeight; ++y) {
-			int mx = (map_x + x);
-			int my = (map_y + y);
-			int px = (mx * rme::TileSize + half_tile_size);
-			int py = (my * rme::TileSize + half_tile_size);
-			int index = (y * rme::ClientMapWidth + x);
-			int color_index = index * rme::PixelFormatRGBA;
-
-			buffer[color_index]	 = global_color.Red();
-			buffer[color_index + 1] = global_color.Green();
-			buffer[color_index + 2] = global_color.Blue();
-			buffer[color_index + 3] = global_color.Alpha();
-
-			for (auto& light : lights) {
-				float intensity = calculateIntensity(mx, my, light);
+	for (size_t index = 0; index < buffer.size(); index += rme::PixelFormatRGBA) {
+		buffer[index] = global_color.Red();
+		buffer[index + 1] = global_color.Green();
+		buffer[index + 2] = global_color.Blue();
+		buffer[index + 3] = global_color.Alpha();
+	}
+
+	// Every tile keeps the brightest light reaching it, so each light only
+	// has to visit the tiles within its intensity
+	for (const Light& light : lights) {
+		const int radius = light.intensity;
+		const int start_x = std::max(light.map_x - radius - map_x, 0);
+		const int start_y = std::max(light.map_y - radius - map_y, 0);
+		const int end_x = std::min(light.map_x + radius - map_x, rme::ClientMapWidth - 1);
+		const int end_y = std::min(light.map_y + radius - map_y, rme::ClientMapHeight - 1);
+		if (start_x > end_x || start_y > end_y) {
+			continue;
+		}
+
+#ifdef RME_LIGHT_SSE2
+		const __m128 color = _mm_setr_ps(light.red, light.green, light.blue, 0.f);
+#endif
+		for (int y = start_y; y <= end_y; ++y) {
+			uint8_t* row = &buffer[static_cast<size_t>(y * rme::ClientMapWidth * rme::PixelFormatRGBA)];
+			int x = start_x;
+#ifdef RME_LIGHT_SSE2
+			// Tiles past end_x are out of reach and stay as they are
+			for (; x <= end_x && x + 4 <= rme::ClientMapWidth; x += 4) {
+				blendLight4(&row[x * rme::PixelFormatRGBA], map_x + x - light.map_x, map_y + y - light.map_y, light.intensity, color);
+			}
+#endif
+			for (; x <= end_x; ++x) {
+				float intensity = calculateIntensity(map_x + x, map_y + y, light);
 				if (intensity == 0.f) {
 					continue;
 				}
-				wxColor light_color = colorFromEightBit(light.color);
-				uint8_t red = static_cast<uint8_t>(light_color.Red() * intensity);
-				uint8_t green = static_cast<uint8_t>(light_color.Green() * intensity);
-				uint8_t blue = static_cast<uint8_t>(light_color.Blue() * intensity);
-				buffer[color_index]	 = std::max(buffer[color_index], red);
-				buffer[color_index + 1] = std::max(buffer[color_index + 1], green);
-				buffer[color_index + 2] = std::max(buffer[color_index + 2], blue);
+				uint8_t* pixel = &row[x * rme::PixelFormatRGBA];
+				pixel[0] = std::max(pixel[0], static_cast<uint8_t>(light.red * intensity));
+				pixel[1] = std::max(pixel[1], static_cast<uint8_t>(light.green * intensity));
+				pixel[2] = std::max(pixel[2], static_cast<uint8_t>(light.blue * intensity));
 			}
 		}
 	}
@@ -115,7 +159,8 @@ void LightDrawer::addLight(int map_x, int map_y, const SpriteLight& light)
 		}
 	}
 
-	lights.push_back(Light{ static_cast<uint16_t>(map_x), static_cast<uint16_t>(map_y), light.color, intensity });
+	wxColor color = colorFromEightBit(light.color);
+	lights.push_back(Light{ static_cast<uint16_t>(map_x), static_cast<uint16_t>(map_y), light.color, intensity, color.Red(), color.Green(), color.Blue() });
 }
 
 void LightDrawer::clear() noexcept
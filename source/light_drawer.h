@@ -28,6 +28,10 @@ class LightDrawer
 		uint16_t map_y = 0;
 		uint8_t color = 0;
 		uint8_t intensity = 0;
+		// color converted once when the light is added
+		uint8_t red = 0;
+		uint8_t green = 0;
+		uint8_t blue = 0;
 	};
 
 public:
@@ -47,7 +51,7 @@ private:
 	inline float calculateIntensity(int map_x, int map_y, const Light& light) {
 		int dx = map_x - light.map_x;
 		int dy = map_y - light.map_y;
-		float distance = std::sqrt(dx * dx + dy * dy);
+		float distance = std::sqrt(static_cast<float>(dx * dx + dy * dy));
 		if (distance > rme::MaxLightIntensity) {
 			return 0.f;
 		}
@@ -25,7 +25,8 @@
 #include <wx/event.h>
 
 LiveClient::LiveClient() : LiveSocket(),
-	readMessage(), queryNodeList(), currentOperation(),
+	readMessage(), queryNodeList(), requestedNodeList(),
+	viewStartX(0), viewStartY(0), viewEndX(-1), viewEndY(-1), viewUnderground(false), currentOperation(),
 	resolver(nullptr), socket(nullptr), editor(nullptr), stopped(false)
 {
 	//
@@ -145,6 +146,10 @@ void LiveClient::close()
 		log = nullptr;
 	}
 
+	// Nothing that was asked for will arrive anymore
+	queryNodeList.clear();
+	requestedNodeList.clear();
+
 	stopped = true;
 }
 
@@ -192,10 +197,13 @@ void LiveClient::receiveHeader()
 
 void LiveClient::receive(uint32_t packetSize)
 {
+	const bool compressed = (packetSize & NetworkMessage::CompressedFlag) != 0;
+	packetSize &= ~NetworkMessage::CompressedFlag;
+
 	readMessage.buffer.resize(readMessage.position + packetSize);
 	asio::async_read(*socket,
 		asio::buffer(&readMessage.buffer[readMessage.position], packetSize),
-		[this](const std::error_code& error, size_t bytesReceived) -> void {
+		[this, compressed](const std::error_code& error, size_t bytesReceived) -> void {
 			if(error) {
 				if(!handleError(error)) {
 					logMessage(wxString() + getHostName() + ": " + error.message());
@@ -203,6 +211,13 @@ void LiveClient::receive(uint32_t packetSize)
 			} else if(bytesReceived < readMessage.buffer.size() - 4) {
 				logMessage(wxString() + getHostName() + ": Could not receive packet[size: " + std::to_string(bytesReceived) + "], disconnecting client.");
 			} else {
+				receivedBytes += readMessage.buffer.size();
+				if(compressed && !readMessage.decompress()) {
+					logMessage(wxString() + getHostName() + ": Could not decompress packet, disconnecting client.");
+					return;
+				}
+				receivedRawBytes += readMessage.buffer.size();
+
 				wxTheApp->CallAfter([this]() {
 					parsePacket(std::move(readMessage));
 					receiveHeader();
@@ -214,10 +229,14 @@ void LiveClient::receive(uint32_t packetSize)
 
 void LiveClient::send(NetworkMessage& message)
 {
-	memcpy(&message.buffer[0], &message.size, 4);
+	// The handler holds on to the buffer until the write is done
+	SharedMessage shared(message);
+	SharedMessageBuffer buffer = shared.get(compression);
+	sentBytes += buffer->size();
+	sentRawBytes += shared.getRawSize();
 	asio::async_write(*socket,
-		asio::buffer(message.buffer, message.size + 4),
-		[this](const std::error_code& error, size_t bytesTransferred) -> void {
+		asio::buffer(*buffer),
+		[this, buffer](const std::error_code& error, size_t bytesTransferred) -> void {
 			if(error) {
 				logMessage(wxString() + getHostName() + ": " + error.message());
 			}
@@ -275,26 +294,84 @@ void LiveClient::sendHello()
 	message.write<uint32_t>(g_gui.GetCurrentVersionID());
 	message.write<std::string>(nstr(name));
 	message.write<std::string>(nstr(password));
+	message.write<uint32_t>(g_settings.getBoolean(Config::LIVE_COMPRESSION) ? LIVE_CAPABILITY_COMPRESSION : 0);
 
+	joinTime = std::chrono::steady_clock::now();
 	send(message);
 }
 
 void LiveClient::sendNodeRequests()
 {
-	if(queryNodeList.empty()) {
+	expireNodeRequests();
+
+	// The server answers in request order, so only keep a few requests in
+	// flight and top them up in batches once half of them have arrived
+	if(queryNodeList.empty() || requestedNodeList.size() > MaxRequestedNodes / 2) {
 		return;
 	}
 
+	const int32_t centerX = (viewStartX + viewEndX) / 2;
+	const int32_t centerY = (viewStartY + viewEndY) / 2;
+
+	std::vector<std::pair<int32_t, uint32_t>> nodes;
+	nodes.reserve(queryNodeList.size());
+	for(uint32_t node : queryNodeList) {
+		int32_t dx = int32_t(node >> 18) - centerX;
+		int32_t dy = int32_t((node >> 4) & 0x3FFF) - centerY;
+		nodes.emplace_back(dx * dx + dy * dy, node);
+	}
+
+	size_t count = std::min(nodes.size(), MaxRequestedNodes - requestedNodeList.size());
+	std::partial_sort(nodes.begin(), nodes.begin() + count, nodes.end());
+
 	NetworkMessage message;
 	message.write<uint8_t>(PACKET_REQUEST_NODES);
 
-	message.write<uint32_t>(queryNodeList.size());
-	for(uint32_t node : queryNodeList) {
+	const auto now = std::chrono::steady_clock::now();
+	message.write<uint32_t>(count);
+	for(size_t i = 0; i < count; ++i) {
+		uint32_t node = nodes[i].second;
 		message.write<uint32_t>(node);
+		queryNodeList.erase(node);
+		requestedNodeList[node] = now;
 	}
 
 	send(message);
-	queryNodeList.clear();
+}
+
+void LiveClient::expireNodeRequests()
+{
+	const auto expired = std::chrono::steady_clock::now() - NodeRequestTimeout;
+	for(auto it = requestedNodeList.begin(); it != requestedNodeList.end();) {
+		if(it->second > expired) {
+			++it;
+			continue;
+		}
+
+		uint32_t node = it->first;
+		if(isNodeInView(node)) {
+			queryNodeList.insert(node);
+		} else {
+			clearNodeRequested(node);
+		}
+		it = requestedNodeList.erase(it);
+	}
+}
+
+void LiveClient::clearNodeRequested(uint32_t node)
+{
+	QTreeNode* leaf = editor->getMap().getLeaf((node >> 18) * 4, ((node >> 4) & 0x3FFF) * 4);
+	if(leaf) {
+		leaf->setRequested(node & 1, false);
+	}
+}
+
+bool LiveClient::isNodeInView(uint32_t node) const
+{
+	int32_t ndx = node >> 18;
+	int32_t ndy = (node >> 4) & 0x3FFF;
+	bool underground = node & 1;
+	return underground == viewUnderground && ndx >= viewStartX && ndx <= viewEndX && ndy >= viewStartY && ndy <= viewEndY;
 }
 
 void LiveClient::sendChanges(DirtyList& dirtyList)
@@ -307,8 +384,9 @@ void LiveClient::sendChanges(DirtyList& dirtyList)
 	mapWriter.reset();
 	for(Change* change : changeList) {
 		switch (change->getType()) {
-			case CHANGE_TILE: {
-				const Position& position = static_cast<Tile*>(change->getData())->getPosition();
+			case CHANGE_TILE:
+			case CHANGE_TILE_DELTA: {
+				const Position& position = change->getTilePosition();
 				sendTile(mapWriter, editor->getMap().getTile(position), &position);
 				break;
 			}
@@ -351,6 +429,75 @@ void LiveClient::queryNode(int32_t ndx, int32_t ndy, bool underground)
 	queryNodeList.insert(nd);
 }
 
+void LiveClient::setNodeRequestView(int32_t startX, int32_t startY, int32_t endX, int32_t endY, bool underground)
+{
+	const int32_t newStartX = std::max<int32_t>(0, (startX >> 2) - 1);
+	const int32_t newStartY = std::max<int32_t>(0, (startY >> 2) - 1);
+	const int32_t newEndX = std::min<int32_t>(0x3FFF, (endX >> 2) + 1);
+	const int32_t newEndY = std::min<int32_t>(0x3FFF, (endY >> 2) + 1);
+
+	// Called on every frame, nothing changes until the view moves or the
+	// floor goes above or below ground
+	if(newStartX == viewStartX && newStartY == viewStartY && newEndX == viewEndX && newEndY == viewEndY && underground == viewUnderground) {
+		return;
+	}
+
+	viewStartX = newStartX;
+	viewStartY = newStartY;
+	viewEndX = newEndX;
+	viewEndY = newEndY;
+	viewUnderground = underground;
+
+	Map& map = editor->getMap();
+
+	// Nodes that scrolled out of view are requested again if they come back.
+	// Those already sent stop taking up a slot, if their answer still comes
+	// it is applied like any node the server sends unasked.
+	for(auto it = queryNodeList.begin(); it != queryNodeList.end();) {
+		uint32_t node = *it;
+		if(isNodeInView(node)) {
+			++it;
+			continue;
+		}
+
+		clearNodeRequested(node);
+		it = queryNodeList.erase(it);
+	}
+	for(auto it = requestedNodeList.begin(); it != requestedNodeList.end();) {
+		uint32_t node = it->first;
+		if(isNodeInView(node)) {
+			++it;
+			continue;
+		}
+
+		clearNodeRequested(node);
+		it = requestedNodeList.erase(it);
+	}
+
+	// Drawing requests everything in view, this adds the ring around it
+	for(int32_t ndx = viewStartX; ndx <= viewEndX; ++ndx) {
+		for(int32_t ndy = viewStartY; ndy <= viewEndY; ++ndy) {
+			QTreeNode* leaf = map.getLeaf(ndx * 4, ndy * 4);
+			if(!leaf) {
+				leaf = map.createLeaf(ndx * 4, ndy * 4);
+				leaf->setVisible(false, false);
+			}
+
+			if(!leaf->isVisible(underground) && !leaf->isRequested(underground)) {
+				queryNode(ndx * 4, ndy * 4, underground);
+				leaf->setRequested(underground, true);
+			}
+		}
+	}
+}
+
+void LiveClient::noteNodeDrawn()
+{
+	if(firstRenderTime < 0) {
+		firstRenderTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - joinTime).count();
+	}
+}
+
 void LiveClient::parsePacket(NetworkMessage message)
 {
 	uint8_t packetType;
@@ -402,6 +549,7 @@ void LiveClient::parseHello(NetworkMessage& message)
 	map.setName("Live Map - " + message.read<std::string>());
 	map.setWidth(message.read<uint16_t>());
 	map.setHeight(message.read<uint16_t>());
+	compression = (message.read<uint32_t>() & LIVE_CAPABILITY_COMPRESSION) != 0;
 
 	createEditorWindow();
 }
@@ -457,6 +605,11 @@ void LiveClient::parseNode(NetworkMessage& message)
 	receiveNode(message, *editor, action, ndx, ndy, underground);
 	editor->addAction(action);
 
+	// Nodes are also sent unasked when another user changes them
+	if(requestedNodeList.erase(ind) != 0) {
+		sendNodeRequests();
+	}
+
 	g_gui.RefreshView();
 	g_gui.UpdateMinimap();
 }
@@ -21,7 +21,10 @@
 #include "live_socket.h"
 #include "net_connection.h"
 
+#include <chrono>
+#include <map>
 #include <set>
+#include <vector>
 
 class DirtyList;
 class MapTab;
@@ -62,6 +65,10 @@ class LiveClient : public LiveSocket
 
 		// Flags a node as queried and stores it, need to call SendNodeRequest to send it to server
 		void queryNode(int32_t ndx, int32_t ndy, bool underground);
+		// Tiles the map is drawn from, queued nodes outside of it (and one node around it) are dropped
+		void setNodeRequestView(int32_t startX, int32_t startY, int32_t endX, int32_t endY, bool underground);
+		// Called by the drawer when a node received from the server was drawn
+		void noteNodeDrawn();
 
 	protected:
 		void parsePacket(NetworkMessage message);
@@ -80,13 +87,29 @@ class LiveClient : public LiveSocket
 		//
 		NetworkMessage readMessage;
 
+		// Requests are sent nearest to the view center first, never more than this many at once
+		static const size_t MaxRequestedNodes = 64;
+		// Requests not answered by then are sent again, or forgotten if out of view
+		static constexpr std::chrono::seconds NodeRequestTimeout { 5 };
+
+		// Sends again or forgets requests that were not answered in time
+		void expireNodeRequests();
+		// Whether a node is in the view set by setNodeRequestView
+		bool isNodeInView(uint32_t node) const;
+		// Lets drawing the node query it again
+		void clearNodeRequested(uint32_t node);
+
 		std::set<uint32_t> queryNodeList;
+		std::map<uint32_t, std::chrono::steady_clock::time_point> requestedNodeList; // Sent and not answered yet
+		int32_t viewStartX, viewStartY, viewEndX, viewEndY; // In nodes, including the prefetched ring
+		bool viewUnderground;
 		wxString currentOperation;
 
 		std::shared_ptr<asio::ip::tcp::resolver> resolver;
 		std::shared_ptr<asio::ip::tcp::socket> socket;
 
 		Editor* editor;
+		std::chrono::steady_clock::time_point joinTime;
 
 		bool stopped;
 };
@@ -0,0 +1,121 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "live_host.h"
+#include "live_server.h"
+#include "iomap_otbm.h"
+#include "editor.h"
+#include "gui.h"
+
+BEGIN_EVENT_TABLE(LiveHost, wxEvtHandler)
+	EVT_TIMER(wxID_ANY, LiveHost::OnAutosaveTimer)
+END_EVENT_TABLE()
+
+namespace {
+	void printWarnings(const wxArrayString& warnings)
+	{
+		for(const wxString& warning : warnings) {
+			std::cout << "Warning: " << nstr(warning) << std::endl;
+		}
+	}
+}
+
+LiveHost::LiveHost() :
+	editor(nullptr),
+	autosave_timer(this)
+{
+	//
+}
+
+LiveHost::~LiveHost()
+{
+	stop();
+}
+
+bool LiveHost::start(const FileName& filename, int32_t port, const wxString& name, const wxString& password, int32_t autosaveMinutes)
+{
+	ASSERT(editor == nullptr);
+
+	// Load the client data up front, the editor would ask about it in dialogs
+	MapVersion version;
+	if(!IOMapOTBM::getVersionInfo(filename, version)) {
+		error = "Could not open file \"" + filename.GetFullPath() + "\".";
+		return false;
+	}
+
+	wxArrayString warnings;
+	if(!g_gui.LoadVersion(version.client, error, warnings)) {
+		return false;
+	}
+	printWarnings(warnings);
+
+	try {
+		editor = newd Editor(g_gui.copybuffer, filename);
+	} catch(std::runtime_error& e) {
+		error = wxString(e.what(), wxConvUTF8);
+		return false;
+	}
+	printWarnings(editor->getMap().getWarnings());
+
+	LiveServer* server = editor->StartLiveServer();
+	if(!server->setName(name) || !server->setPassword(password) || !server->setPort(port) || !server->bind()) {
+		error = server->getLastError();
+		editor->CloseLiveServer();
+		delete editor;
+		editor = nullptr;
+		return false;
+	}
+
+	g_gui.SetHostedLiveServer(server);
+	std::cout << "Serving " << editor->getMap().getFilename() << " on " << server->getHostName() << "." << std::endl;
+
+	if(autosaveMinutes > 0) {
+		autosave_timer.Start(autosaveMinutes * 60 * 1000);
+	}
+	return true;
+}
+
+void LiveHost::stop()
+{
+	autosave_timer.Stop();
+	if(!editor) {
+		return;
+	}
+
+	save();
+	g_gui.SetHostedLiveServer(nullptr);
+	editor->CloseLiveServer();
+	delete editor;
+	editor = nullptr;
+}
+
+void LiveHost::save()
+{
+	if(!editor->hasChanges()) {
+		return;
+	}
+
+	std::cout << "Saving " << editor->getMap().getFilename() << "..." << std::endl;
+	editor->saveMap(FileName(), false);
+}
+
+void LiveHost::OnAutosaveTimer(wxTimerEvent& WXUNUSED(event))
+{
+	save();
+}
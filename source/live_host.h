@@ -0,0 +1,51 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef _RME_LIVE_HOST_H_
+#define _RME_LIVE_HOST_H_
+
+#include "main.h"
+
+class Editor;
+
+// Hosts a live session without any editor windows, so a map can be served
+// from a machine nobody is mapping on. Started with
+//   rme --serve map.otbm [--port N] [--password P] [--name N] [--autosave minutes]
+class LiveHost : public wxEvtHandler
+{
+public:
+	LiveHost();
+	~LiveHost();
+
+	bool start(const FileName& filename, int32_t port, const wxString& name, const wxString& password, int32_t autosaveMinutes);
+	void stop();
+
+	const wxString& getLastError() const { return error; }
+
+	void OnAutosaveTimer(wxTimerEvent& event);
+
+protected:
+	void save();
+
+	Editor* editor;
+	wxTimer autosave_timer;
+	wxString error;
+
+	DECLARE_EVENT_TABLE();
+};
+
+#endif
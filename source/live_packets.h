@@ -46,4 +46,10 @@ enum LivePacketType
 	PACKET_CHAT_MESSAGE = 0x94,
 };
 
+// Sent in both hellos, a capability is only used when both sides have it
+enum LiveCapability
+{
+	LIVE_CAPABILITY_COMPRESSION = 1 << 0,
+};
+
 #endif
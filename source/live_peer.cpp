@@ -25,7 +25,7 @@
 #include "editor.h"
 
 LivePeer::LivePeer(LiveServer* server, asio::ip::tcp::socket socket) : LiveSocket(),
-	readMessage(), server(server), socket(std::move(socket)), color(), id(0), clientId(0), connected(false)
+	readMessage(), server(server), socket(std::move(socket)), color(), id(0), clientId(0), capabilities(0), connected(false)
 {
 	ASSERT(server != nullptr);
 }
@@ -81,10 +81,13 @@ void LivePeer::receiveHeader()
 
 void LivePeer::receive(uint32_t packetSize)
 {
+	const bool compressed = (packetSize & NetworkMessage::CompressedFlag) != 0;
+	packetSize &= ~NetworkMessage::CompressedFlag;
+
 	readMessage.buffer.resize(readMessage.position + packetSize);
 	asio::async_read(socket,
 		asio::buffer(&readMessage.buffer[readMessage.position], packetSize),
-		[this](const std::error_code& error, size_t bytesReceived) -> void {
+		[this, compressed](const std::error_code& error, size_t bytesReceived) -> void {
 			if(error) {
 				if(!handleError(error)) {
 					logMessage(wxString() + getHostName() + ": " + error.message());
@@ -92,6 +95,13 @@ void LivePeer::receive(uint32_t packetSize)
 			} else if(bytesReceived < readMessage.buffer.size() - 4) {
 				logMessage(wxString() + getHostName() + ": Could not receive packet[size: " + std::to_string(bytesReceived) + "], disconnecting client.");
 			} else {
+				receivedBytes += readMessage.buffer.size();
+				if(compressed && !readMessage.decompress()) {
+					logMessage(wxString() + getHostName() + ": Could not decompress packet, disconnecting client.");
+					return;
+				}
+				receivedRawBytes += readMessage.buffer.size();
+
 				wxTheApp->CallAfter([this]() {
 					if(connected) {
 						parseEditorPacket(std::move(readMessage));
@@ -107,10 +117,19 @@ void LivePeer::receive(uint32_t packetSize)
 
 void LivePeer::send(NetworkMessage& message)
 {
-	memcpy(&message.buffer[0], &message.size, 4);
+	SharedMessage shared(message);
+	send(shared);
+}
+
+void LivePeer::send(SharedMessage& message)
+{
+	// The handler holds on to the buffer until the write is done
+	SharedMessageBuffer buffer = message.get(compression);
+	sentBytes += buffer->size();
+	sentRawBytes += message.getRawSize();
 	asio::async_write(socket,
-		asio::buffer(message.buffer, message.size + 4),
-		[this](const std::error_code& error, size_t bytesTransferred) -> void {
+		asio::buffer(*buffer),
+		[this, buffer](const std::error_code& error, size_t bytesTransferred) -> void {
 			if(error) {
 				logMessage(wxString() + getHostName() + ": " + error.message());
 			}
@@ -131,7 +150,7 @@ void LivePeer::parseLoginPacket(NetworkMessage message)
 				parseReady(message);
 				break;
 			default: {
-				log->Message("Invalid login packet receieved, connection severed.");
+				logMessage("Invalid login packet receieved, connection severed.");
 				close();
 				break;
 			}
@@ -167,7 +186,7 @@ void LivePeer::parseEditorPacket(NetworkMessage message)
 				parseChatMessage(message);
 				break;
 			default: {
-				log->Message("Invalid editor packet receieved, connection severed.");
+				logMessage("Invalid editor packet receieved, connection severed.");
 				close();
 				break;
 			}
@@ -207,15 +226,16 @@ void LivePeer::parseHello(NetworkMessage& message)
 	uint32_t clientVersion = message.read<uint32_t>();
 	std::string nickname = message.read<std::string>();
 	std::string password = message.read<std::string>();
+	capabilities = message.read<uint32_t>();
 
 	if(server->getPassword() != wxString(password.c_str(), wxConvUTF8)) {
-		log->Message("Client tried to connect, but used the wrong password, connection refused.");
+		logMessage("Client tried to connect, but used the wrong password, connection refused.");
 		close();
 		return;
 	}
 
 	name = wxString(nickname.c_str(), wxConvUTF8);
-	log->Message(name + " (" + getHostName() + ") connected.");
+	logMessage(name + " (" + getHostName() + ") connected.");
 
 	NetworkMessage outMessage;
 	if(static_cast<ClientVersionID>(clientVersion) != g_gui.GetCurrentVersionID()) {
@@ -259,7 +279,14 @@ void LivePeer::parseReady(NetworkMessage& message)
 	outMessage.write<uint16_t>(map.getWidth());
 	outMessage.write<uint16_t>(map.getHeight());
 
+	uint32_t agreed = 0;
+	if(g_settings.getBoolean(Config::LIVE_COMPRESSION)) {
+		agreed |= capabilities & LIVE_CAPABILITY_COMPRESSION;
+	}
+	outMessage.write<uint32_t>(agreed);
+
 	send(outMessage);
+	compression = (agreed & LIVE_CAPABILITY_COMPRESSION) != 0;
 }
 
 void LivePeer::parseNodeRequest(NetworkMessage& message)
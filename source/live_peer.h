@@ -44,6 +44,7 @@ class LivePeer : public LiveSocket
 		void receiveHeader();
 		void receive(uint32_t packetSize);
 		void send(NetworkMessage& message);
+		void send(SharedMessage& message);
 
 		//
 		void updateCursor(const Position& position) {}
@@ -75,6 +76,7 @@ class LivePeer : public LiveSocket
 
 		uint32_t id;
 		uint32_t clientId;
+		uint32_t capabilities; // Asked for by the client
 
 		bool connected;
 
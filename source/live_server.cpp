@@ -48,18 +48,24 @@ bool LiveServer::bind()
 	acceptor = std::make_shared<asio::ip::tcp::acceptor>(service);
 
 	asio::ip::tcp::endpoint endpoint(asio::ip::tcp::v4(), port);
-	acceptor->open(endpoint.protocol());
 
 	std::error_code error;
-	acceptor->set_option(asio::ip::tcp::no_delay(true), error);
+	acceptor->open(endpoint.protocol(), error);
+	if(!error) {
+		acceptor->set_option(asio::ip::tcp::no_delay(true), error);
+	}
+	if(!error) {
+		acceptor->bind(endpoint, error);
+	}
+	if(!error) {
+		acceptor->listen(asio::socket_base::max_connections, error);
+	}
+
 	if(error) {
 		setLastError("Error: " + error.message());
 		return false;
 	}
 
-	acceptor->bind(endpoint);
-	acceptor->listen();
-
 	acceptClient();
 	return true;
 }
@@ -124,8 +130,8 @@ void LiveServer::removeClient(uint32_t id)
 
 	const uint32_t clientId = it->second->getClientId();
 	if(clientId != 0) {
-		clientIds &= ~clientId;
-		editor->getMap().clearVisible(clientIds);
+		clientIds &= ~(static_cast<uint64_t>(1) << (clientId - 1));
+		editor->getMap().clearVisible(clientId);
 	}
 
 	clients.erase(it);
@@ -148,7 +154,9 @@ void LiveServer::updateCursor(const Position& position)
 
 void LiveServer::updateClientList() const
 {
-	log->UpdateClientList(clients);
+	if(log) {
+		log->UpdateClientList(clients);
+	}
 }
 
 uint16_t LiveServer::getPort() const
@@ -168,10 +176,11 @@ bool LiveServer::setPort(int32_t newPort)
 
 uint32_t LiveServer::getFreeClientId()
 {
-	for(int32_t bit = 1; bit < (1 << 16); bit <<= 1) {
-		if(!testFlags(clientIds, bit)) {
+	for(uint32_t id = 1; id <= static_cast<uint32_t>(rme::MaxLiveClients); ++id) {
+		const uint64_t bit = static_cast<uint64_t>(1) << (id - 1);
+		if((clientIds & bit) == 0) {
 			clientIds |= bit;
-			return bit;
+			return id;
 		}
 	}
 	return 0;
@@ -202,20 +211,33 @@ void LiveServer::broadcastNodes(DirtyList& dirtyList)
 			continue;
 		}
 
+		// Each half of the node is serialized once, the first time a client needs it
+		SharedMessage underground, aboveground;
+		auto sendHalf = [&](LivePeer* peer, SharedMessage& shared, uint32_t floorMask) {
+			if(shared.empty()) {
+				NetworkMessage message;
+				writeNode(message, node, ndx, ndy, floorMask);
+				shared = SharedMessage(message);
+			}
+			node->setVisible(peer->getClientId(), isUnderground(floorMask), true);
+			peer->send(shared);
+		};
+
 		for(auto& clientEntry : clients) {
 			LivePeer* peer = clientEntry.second;
 
+			// Peers get their id once the handshake is done, until then they have no nodes
 			const uint32_t clientId = peer->getClientId();
-			if(dirtyList.owner != 0 && dirtyList.owner == clientId) {
+			if(clientId == 0 || (dirtyList.owner != 0 && dirtyList.owner == clientId)) {
 				continue;
 			}
 
 			if(node->isVisible(clientId, true)) {
-				peer->sendNode(clientId, node, ndx, ndy, floors & 0xFF00);
+				sendHalf(peer, underground, floors & 0xFF00);
 			}
 
 			if(node->isVisible(clientId, false)) {
-				peer->sendNode(clientId, node, ndx, ndy, floors & 0x00FF);
+				sendHalf(peer, aboveground, floors & 0x00FF);
 			}
 		}
 	}
@@ -235,10 +257,11 @@ void LiveServer::broadcastCursor(const LiveCursor& cursor)
 	message.write<uint8_t>(PACKET_CURSOR_UPDATE);
 	writeCursor(message, cursor);
 
+	SharedMessage shared(message);
 	for(auto& clientEntry : clients) {
 		LivePeer* peer = clientEntry.second;
 		if(peer->getClientId() != cursor.id) {
-			peer->send(message);
+			peer->send(shared);
 		}
 	}
 }
@@ -254,11 +277,16 @@ void LiveServer::broadcastChat(const wxString& speaker, const wxString& chatMess
 	message.write<std::string>(nstr(speaker));
 	message.write<std::string>(nstr(chatMessage));
 
+	SharedMessage shared(message);
 	for(auto& clientEntry : clients) {
-		clientEntry.second->send(message);
+		clientEntry.second->send(shared);
 	}
 
-	log->Chat(name, chatMessage);
+	if(log) {
+		log->Chat(name, chatMessage);
+	} else {
+		logMessage(speaker + ": " + chatMessage);
+	}
 }
 
 void LiveServer::startOperation(const wxString& operationMessage)
@@ -271,8 +299,9 @@ void LiveServer::startOperation(const wxString& operationMessage)
 	message.write<uint8_t>(PACKET_START_OPERATION);
 	message.write<std::string>(nstr(operationMessage));
 
+	SharedMessage shared(message);
 	for(auto& clientEntry : clients) {
-		clientEntry.second->send(message);
+		clientEntry.second->send(shared);
 	}
 }
 
@@ -286,8 +315,9 @@ void LiveServer::updateOperation(int32_t percent)
 	message.write<uint8_t>(PACKET_UPDATE_OPERATION);
 	message.write<uint32_t>(percent);
 
+	SharedMessage shared(message);
 	for(auto& clientEntry : clients) {
-		clientEntry.second->send(message);
+		clientEntry.second->send(shared);
 	}
 }
 
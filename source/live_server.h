@@ -78,7 +78,7 @@ class LiveServer : public LiveSocket
 
 		Editor* editor;
 
-		uint32_t clientIds;
+		uint64_t clientIds; // Bit n - 1 taken by client n
 		uint16_t port;
 
 		bool stopped;
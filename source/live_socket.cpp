@@ -21,10 +21,13 @@
 #include "iomap_otbm.h"
 #include "live_tab.h"
 #include "editor.h"
+#include "gui.h"
 
 LiveSocket::LiveSocket() :
 	cursors(), mapReader(nullptr, 0), mapWriter(),
 	mapVersion(MapVersion(MAP_OTBM_4, CLIENT_VERSION_NONE)), log(nullptr),
+	sentBytes(0), receivedBytes(0), sentRawBytes(0), receivedRawBytes(0),
+	firstRenderTime(-1), compression(false),
 	name("User"), password("")
 {
 	//
@@ -97,6 +100,9 @@ void LiveSocket::logMessage(const wxString& message)
 	wxTheApp->CallAfter([this, message]() {
 		if(log) {
 			log->Message(message);
+		} else if(g_gui.GetHostedLiveServer()) {
+			// Serving headless, there is no log tab to show it in
+			std::cout << nstr(message) << std::endl;
 		}
 	});
 }
@@ -105,7 +111,7 @@ void LiveSocket::receiveNode(NetworkMessage& message, Editor& editor, Action* ac
 {
 	QTreeNode* node = editor.getMap().getLeaf(ndx * 4, ndy * 4);
 	if(!node) {
-		log->Message("Warning: Received update for unknown tile (" + std::to_string(ndx * 4) + "/" + std::to_string(ndy * 4) + "/" + (underground ? "true" : "false") + ")");
+		logMessage("Warning: Received update for unknown tile (" + std::to_string(ndx * 4) + "/" + std::to_string(ndy * 4) + "/" + (underground ? "true" : "false") + ")");
 		return;
 	}
 
@@ -126,21 +132,16 @@ void LiveSocket::receiveNode(NetworkMessage& message, Editor& editor, Action* ac
 
 void LiveSocket::sendNode(uint32_t clientId, QTreeNode* node, int32_t ndx, int32_t ndy, uint32_t floorMask)
 {
-	bool underground;
-	if(floorMask & 0xFF00) {
-		if(floorMask & 0x00FF) {
-			underground = false;
-		} else {
-			underground = true;
-		}
-	} else {
-		underground = false;
-	}
-
-	node->setVisible(clientId, underground, true);
+	node->setVisible(clientId, isUnderground(floorMask), true);
 
 	// Send message
 	NetworkMessage message;
+	writeNode(message, node, ndx, ndy, floorMask);
+	send(message);
+}
+
+void LiveSocket::writeNode(NetworkMessage& message, QTreeNode* node, int32_t ndx, int32_t ndy, uint32_t floorMask)
+{
 	message.write<uint8_t>(PACKET_NODE);
 	message.write<uint32_t>((ndx << 18) | (ndy << 4) | ((floorMask & 0xFF00) ? 1 : 0));
 
@@ -164,8 +165,11 @@ void LiveSocket::sendNode(uint32_t clientId, QTreeNode* node, int32_t ndx, int32
 			}
 		}
 	}
+}
 
-	send(message);
+bool LiveSocket::isUnderground(uint32_t floorMask)
+{
+	return (floorMask & 0xFF00) && !(floorMask & 0x00FF);
 }
 
 void LiveSocket::receiveFloor(NetworkMessage& message, Editor& editor, Action* action, int32_t ndx, int32_t ndy, int32_t z, QTreeNode* node, Floor* floor)
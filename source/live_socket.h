@@ -24,6 +24,7 @@
 #include "filehandle.h"
 #include "iomap.h"
 
+#include <atomic>
 #include <memory>
 #include <unordered_map>
 
@@ -71,6 +72,9 @@ class LiveSocket
 		// receive / send methods
 		void receiveNode(NetworkMessage& message, Editor& editor, Action* action, int32_t ndx, int32_t ndy, bool underground);
 		void sendNode(uint32_t clientId, QTreeNode* node, int32_t ndx, int32_t ndy, uint32_t floorMask);
+		// The node packet on its own, it is the same whoever it is sent to
+		void writeNode(NetworkMessage& message, QTreeNode* node, int32_t ndx, int32_t ndy, uint32_t floorMask);
+		static bool isUnderground(uint32_t floorMask);
 
 		void receiveFloor(NetworkMessage& message, Editor& editor, Action* action, int32_t ndx, int32_t ndy, int32_t z, QTreeNode* node, Floor* floor);
 		void sendFloor(NetworkMessage& message, Floor* floor);
@@ -93,6 +97,17 @@ class LiveSocket
 
 		LiveLogTab* log;
 
+		// Traffic so far, counted on the network thread
+		std::atomic<uint64_t> sentBytes; // As written, compressed or not
+		std::atomic<uint64_t> receivedBytes;
+		std::atomic<uint64_t> sentRawBytes; // As it would have been without compression
+		std::atomic<uint64_t> receivedRawBytes;
+		// Milliseconds from joining until the first node was drawn, -1 until
+		// then (clients only)
+		std::atomic<int64_t> firstRenderTime;
+		// Agreed on in the hellos, see LIVE_CAPABILITY_COMPRESSION
+		bool compression;
+
 		wxString name;
 		wxString password;
 		wxString lastError;
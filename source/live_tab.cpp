@@ -41,13 +41,15 @@ IMPLEMENT_CLASS(myGrid, wxGrid)
 
 BEGIN_EVENT_TABLE(LiveLogTab, wxPanel)
 	EVT_TEXT(LIVE_CHAT_TEXTBOX, LiveLogTab::OnChat)
+	EVT_TIMER(wxID_ANY, LiveLogTab::OnStatisticsTimer)
 END_EVENT_TABLE()
 
 LiveLogTab::LiveLogTab(MapTabbook* aui, LiveSocket* server) :
 	EditorTab(),
 	wxPanel(aui),
 	aui(aui),
-	socket(server)
+	socket(server),
+	statistics_timer(this)
 {
 	wxSizer* topsizer = newd wxBoxSizer(wxVERTICAL);
 
@@ -94,7 +96,10 @@ LiveLogTab::LiveLogTab(MapTabbook* aui, LiveSocket* server) :
 	left_pane->SetSizerAndFit(left_sizer);
 
 	// Setup right panel
-	user_list = newd myGrid(splitter, wxID_ANY, wxDefaultPosition, wxSize(280, 100));
+	wxPanel* right_pane = newd wxPanel(splitter);
+	wxSizer* right_sizer = newd wxBoxSizer(wxVERTICAL);
+
+	user_list = newd myGrid(right_pane, wxID_ANY, wxDefaultPosition, wxSize(280, 100));
 	user_list->CreateGrid(5, 3);
 	user_list->DisableDragRowSize();
 	user_list->DisableDragColSize();
@@ -110,16 +115,25 @@ LiveLogTab::LiveLogTab(MapTabbook* aui, LiveSocket* server) :
 
 	//user_list->GetGridWindow()->
 
+	right_sizer->Add(user_list, 1, wxEXPAND);
+
+	statistics = newd wxStaticText(right_pane, wxID_ANY, "\n\n");
+	right_sizer->Add(statistics, 0, wxEXPAND | wxALL, 4);
+
+	right_pane->SetSizerAndFit(right_sizer);
+
 	// Finalize
 	SetSizerAndFit(topsizer);
 
 	wxSizer* split_sizer = newd wxBoxSizer(wxHORIZONTAL);
 	split_sizer->Add(left_pane, wxSizerFlags(1).Expand());
-	split_sizer->Add(user_list, wxSizerFlags(0).Expand());
+	split_sizer->Add(right_pane, wxSizerFlags(0).Expand());
 	splitter->SetSizerAndFit(split_sizer);
 	//splitter->SplitVertically(left_pane, user_list, max(this->GetSize().GetWidth() - 200, 0));
 
 	aui->AddTab(this, true);
+
+	statistics_timer.Start(1000);
 }
 
 LiveLogTab::~LiveLogTab()
@@ -155,6 +169,7 @@ void LiveLogTab::Disconnect()
 	socket->log = nullptr;
 	input->SetWindowStyle(input->GetWindowStyle() | wxTE_READONLY);
 	socket = nullptr;
+	statistics_timer.Stop();
 	Refresh();
 }
 
@@ -212,6 +227,48 @@ void LiveLogTab::OnResizeClientList(wxSizeEvent& evt)
 {
 }
 
+namespace {
+	wxString formatBytes(uint64_t bytes)
+	{
+		if(bytes < 1024) {
+			return wxString::Format("%llu B", static_cast<unsigned long long>(bytes));
+		} else if(bytes < 1024 * 1024) {
+			return wxString::Format("%.1f KB", bytes / 1024.0);
+		}
+		return wxString::Format("%.1f MB", bytes / (1024.0 * 1024.0));
+	}
+}
+
+void LiveLogTab::OnStatisticsTimer(wxTimerEvent& evt)
+{
+	if(!socket) {
+		return;
+	}
+
+	// The server counts on each of its peers, a client on its own socket
+	uint64_t sent = socket->sentBytes, sentRaw = socket->sentRawBytes;
+	uint64_t received = socket->receivedBytes, receivedRaw = socket->receivedRawBytes;
+	for(auto& clientEntry : clients) {
+		LivePeer* peer = clientEntry.second;
+		sent += peer->sentBytes;
+		sentRaw += peer->sentRawBytes;
+		received += peer->receivedBytes;
+		receivedRaw += peer->receivedRawBytes;
+	}
+
+	wxString text;
+	text << "Sent: " << formatBytes(sent) << " (" << formatBytes(sentRaw) << " uncompressed)\n";
+	text << "Received: " << formatBytes(received) << " (" << formatBytes(receivedRaw) << " uncompressed)\n";
+	const int64_t firstRender = socket->firstRenderTime;
+	if(firstRender >= 0) {
+		text << wxString::Format("First render after %.2f s", firstRender / 1000.0);
+	}
+
+	if(statistics->GetLabel() != text) {
+		statistics->SetLabel(text);
+	}
+}
+
 void LiveLogTab::OnSelectChatbox(wxFocusEvent& evt)
 {
 	g_gui.DisableHotkeys();
@@ -236,7 +293,7 @@ void LiveLogTab::UpdateClientList(const std::unordered_map<uint32_t, LivePeer*>&
 	for(auto& clientEntry : clients) {
 		LivePeer* peer = clientEntry.second;
 		user_list->SetCellBackgroundColour(i, 0, peer->getUsedColor());
-		user_list->SetCellValue(i, 1, i2ws((peer->getClientId() >> 1) + 1));
+		user_list->SetCellValue(i, 1, i2ws(peer->getClientId()));
 		user_list->SetCellValue(i, 2, peer->getName());
 		++i;
 	}
@@ -56,6 +56,7 @@ public:
 	void OnChat(wxCommandEvent& evt);
 	void OnResizeChat(wxSizeEvent& evt);
 	void OnResizeClientList(wxSizeEvent& evt);
+	void OnStatisticsTimer(wxTimerEvent& evt);
 
 protected:
 	MapTabbook* aui;
@@ -63,6 +64,8 @@ protected:
 	wxGrid* log;
 	wxTextCtrl* input;
 	wxGrid* user_list;
+	wxStaticText* statistics;
+	wxTimer statistics_timer;
 
 	std::unordered_map<uint32_t, LivePeer*> clients;
 
@@ -32,6 +32,7 @@
 #include "gui.h"
 
 #include <wx/chartype.h>
+#include <wx/numdlg.h>
 
 #include "items.h"
 #include "editor.h"
@@ -242,14 +243,24 @@ namespace OnMapRemoveItems
 
 		uint16_t itemId;
 
-		bool operator()(Map& map, Item* item, int64_t removed, int64_t done) {
-			if(done % 0x8000 == 0)
-				g_gui.SetLoadDone((uint32_t)(100 * done / map.getTileCount()));
+		bool operator()(Map& map, Item* item) const {
 			return item->getID() == itemId && !item->isComplex();
 		}
 	};
 }
 
+namespace {
+	void SetLoadDone(int percent)
+	{
+		g_gui.SetLoadDone(percent);
+	}
+
+	int GetWorkerThreads()
+	{
+		return g_settings.getInteger(Config::WORKER_THREADS);
+	}
+}
+
 void MainMenuBar::EnableItem(MenuBar::ActionID id, bool enable)
 {
 	std::map<MenuBar::ActionID, std::list<wxMenuItem*> >::iterator fi = items.find(id);
@@ -876,18 +887,44 @@ namespace OnSearchForItem
 
 		bool limitReached() const { return result.size() >= (size_t)maxCount; }
 
-		void operator()(Map& map, Tile* tile, Item* item, long long done)
+		void operator()(Map& map, Tile* tile, Item* item)
 		{
 			if(result.size() >= (size_t)maxCount)
 				return;
 
-			if(done % 0x8000 == 0)
-				g_gui.SetLoadDone((unsigned int)(100 * done / map.getTileCount()));
-
 			if(item->getID() == itemId)
 				result.push_back(std::make_pair(tile, item));
 		}
+
+		// Regions are in map order, so this keeps the same results as a serial search
+		void merge(const std::vector<Finder>& finders)
+		{
+			for(const Finder& finder : finders) {
+				for(const auto& found : finder.result) {
+					if(limitReached())
+						return;
+					result.push_back(found);
+				}
+			}
+		}
 	};
+
+	void Search(Map& map, Finder& finder, bool selectedTiles)
+	{
+		ItemIndex* index = map.getItemIndex();
+		std::vector<Tile*> tiles;
+		if(!index || !index->findTiles(map, ItemIndex::ITEM_ID, finder.itemId, tiles)) {
+			finder.merge(foreach_ItemOnMapParallel(map, finder, selectedTiles, GetWorkerThreads(), SetLoadDone));
+			return;
+		}
+
+		for(Tile* tile : tiles) {
+			if(!selectedTiles || tile->isSelected()) {
+				auto visit = [&](Item* item) { finder(map, tile, item); };
+				foreach_ItemOnTile(tile, visit);
+			}
+		}
+	}
 }
 
 void MainMenuBar::OnSearchForItem(wxCommandEvent& WXUNUSED(event))
@@ -901,7 +938,7 @@ void MainMenuBar::OnSearchForItem(wxCommandEvent& WXUNUSED(event))
 		OnSearchForItem::Finder finder(dialog.getResultID(), (uint32_t)g_settings.getInteger(Config::REPLACE_SIZE));
 		g_gui.CreateLoadBar("Searching map...");
 
-		foreach_ItemOnMap(g_gui.GetCurrentMap(), finder, false);
+		OnSearchForItem::Search(g_gui.GetCurrentMap(), finder, false);
 		std::vector< std::pair<Tile*, Item*> >& result = finder.result;
 
 		g_gui.DestroyLoadBar();
@@ -953,15 +990,12 @@ namespace OnSearchForStuff
 		bool search_writeable;
 		std::vector<std::pair<Tile*, Item*> > found;
 
-		void operator()(Map& map, Tile* tile, Item* item, long long done)
+		void operator()(Map& map, Tile* tile, Item* item)
 		{
-			if(done % 0x8000 == 0) {
-				g_gui.SetLoadDone((unsigned int)(100 * done / map.getTileCount()));
-			}
 			Container* container;
 			if((search_unique && item->getUniqueID() > 0) ||
 				(search_action && item->getActionID() > 0) ||
-				(search_container && ((container = dynamic_cast<Container*>(item)) && container->getItemCount())) ||
+				(search_container && ((container = item->getContainer()) && container->getItemCount())) ||
 				(search_writeable && item->getText().length() > 0)) {
 				found.push_back(std::make_pair(tile, item));
 			}
@@ -978,7 +1012,7 @@ namespace OnSearchForStuff
 
 			label << wxstr(item->getName());
 
-			if(dynamic_cast<Container*>(item))
+			if(item->getContainer())
 				label << " (Container) ";
 
 			if(item->getText().length() > 0)
@@ -987,6 +1021,12 @@ namespace OnSearchForStuff
 			return label;
 		}
 
+		void merge(const std::vector<Searcher>& searchers)
+		{
+			for(const Searcher& searcher : searchers)
+				found.insert(found.end(), searcher.found.begin(), searcher.found.end());
+		}
+
 		void sort()
 		{
 			if(search_unique || search_action)
@@ -1074,7 +1114,7 @@ void MainMenuBar::OnSearchForItemOnSelection(wxCommandEvent& WXUNUSED(event))
 		OnSearchForItem::Finder finder(dialog.getResultID(), (uint32_t)g_settings.getInteger(Config::REPLACE_SIZE));
 		g_gui.CreateLoadBar("Searching on selected area...");
 
-		foreach_ItemOnMap(g_gui.GetCurrentMap(), finder, true);
+		OnSearchForItem::Search(g_gui.GetCurrentMap(), finder, true);
 		std::vector<std::pair<Tile*, Item*> >& result = finder.result;
 
 		g_gui.DestroyLoadBar();
@@ -1126,7 +1166,7 @@ void MainMenuBar::OnRemoveItemOnSelection(wxCommandEvent& WXUNUSED(event))
 		g_gui.GetCurrentEditor()->clearActions();
 		g_gui.CreateLoadBar("Searching item on selection to remove...");
 		OnMapRemoveItems::RemoveItemCondition condition(dialog.getResultID());
-		int64_t count = RemoveItemOnMap(g_gui.GetCurrentMap(), condition, true);
+		int64_t count = RemoveItemOnMap(g_gui.GetCurrentMap(), condition, true, GetWorkerThreads(), SetLoadDone);
 		g_gui.DestroyLoadBar();
 
 		wxString msg;
@@ -1210,9 +1250,11 @@ void MainMenuBar::OnRandomizeMap(wxCommandEvent& WXUNUSED(event))
 	if(!g_gui.IsEditorOpen())
 		return;
 
-	int ret = g_gui.PopupDialog("Randomize Map", "Are you sure you want to randomize the entire map (this action cannot be undone)?", wxYES | wxNO);
-	if(ret == wxID_YES)
-		g_gui.GetCurrentEditor()->randomizeMap(true);
+	long seed = wxGetNumberFromUser("Randomizes the ground of the entire map.\nThe same seed always gives the same result.", "Seed:", "Randomize Map", static_cast<long>(mt_randi() & 0x7FFFFFFF), 0, 0x7FFFFFFF, frame);
+	if(seed < 0)
+		return;
+
+	g_gui.GetCurrentEditor()->randomizeMap(static_cast<uint32_t>(seed), true);
 
 	g_gui.RefreshView();
 }
@@ -1286,7 +1328,7 @@ void MainMenuBar::OnMapRemoveItems(wxCommandEvent& WXUNUSED(event))
 		OnMapRemoveItems::RemoveItemCondition condition(itemid);
 		g_gui.CreateLoadBar("Searching map for items to remove...");
 
-		int64_t count = RemoveItemOnMap(g_gui.GetCurrentMap(), condition, false);
+		int64_t count = RemoveItemOnMap(g_gui.GetCurrentMap(), condition, false, GetWorkerThreads(), SetLoadDone);
 
 		g_gui.DestroyLoadBar();
 
@@ -1306,10 +1348,7 @@ namespace OnMapRemoveCorpses
 	{
 		condition() {}
 
-		bool operator()(Map& map, Item* item, long long removed, long long done){
-			if(done % 0x800 == 0)
-				g_gui.SetLoadDone((unsigned int)(100 * done / map.getTileCount()));
-
+		bool operator()(Map& map, Item* item) const {
 			return g_materials.isInTileset(item, "Corpses") & !item->isComplex();
 		}
 	};
@@ -1329,7 +1368,7 @@ void MainMenuBar::OnMapRemoveCorpses(wxCommandEvent& WXUNUSED(event))
 		OnMapRemoveCorpses::condition func;
 		g_gui.CreateLoadBar("Searching map for items to remove...");
 
-		int64_t count = RemoveItemOnMap(g_gui.GetCurrentMap(), func, false);
+		int64_t count = RemoveItemOnMap(g_gui.GetCurrentMap(), func, false, GetWorkerThreads(), SetLoadDone);
 
 		g_gui.DestroyLoadBar();
 
@@ -1346,7 +1385,7 @@ namespace OnMapRemoveUnreachable
 	{
 		condition() {}
 
-		bool isReachable(Tile* tile)
+		bool isReachable(Tile* tile) const
 		{
 			if(tile == nullptr)
 				return false;
@@ -1355,11 +1394,8 @@ namespace OnMapRemoveUnreachable
 			return false;
 		}
 
-		bool operator()(Map& map, Tile* tile, long long removed, long long done, long long total)
+		bool operator()(Map& map, Tile* tile) const
 		{
-			if(done % 0x1000 == 0)
-				g_gui.SetLoadDone((unsigned int)(100 * done / total));
-
 			const Position& pos = tile->getPosition();
 			int sx = std::max(pos.x - 10, 0);
 			int ex = std::min(pos.x + 10, 65535);
@@ -1403,7 +1439,7 @@ void MainMenuBar::OnMapRemoveUnreachable(wxCommandEvent& WXUNUSED(event))
 		OnMapRemoveUnreachable::condition func;
 		g_gui.CreateLoadBar("Searching map for tiles to remove...");
 
-		long long removed = remove_if_TileOnMap(g_gui.GetCurrentMap(), func);
+		long long removed = remove_if_TileOnMap(g_gui.GetCurrentMap(), func, GetWorkerThreads(), SetLoadDone);
 
 		g_gui.DestroyLoadBar();
 
@@ -1569,6 +1605,92 @@ void MainMenuBar::OnMapEditMonsters(wxCommandEvent& WXUNUSED(event))
 	;
 }
 
+namespace OnMapStatistics
+{
+	struct TileCounter
+	{
+		uint64_t tile_count = 0;
+		uint64_t detailed_tile_count = 0;
+		uint64_t blocking_tile_count = 0;
+		uint64_t walkable_tile_count = 0;
+		uint64_t spawn_count = 0;
+		uint64_t creature_count = 0;
+		uint64_t item_count = 0;
+		uint64_t loose_item_count = 0;
+		uint64_t depot_count = 0;
+		uint64_t action_item_count = 0;
+		uint64_t unique_item_count = 0;
+		uint64_t container_count = 0; // Only includes containers containing more than 1 item
+
+		// Returns whether the item counts as detail
+		bool analyze(Item* item)
+		{
+			item_count += 1;
+			if(item->isGroundTile() || item->isBorder())
+				return false;
+
+			const ItemType& it = g_items.getItemType(item->getID());
+			if(it.moveable)
+				loose_item_count += 1;
+			if(it.isDepot())
+				depot_count += 1;
+			if(item->getActionID() > 0)
+				action_item_count += 1;
+			if(item->getUniqueID() > 0)
+				unique_item_count += 1;
+			if(Container* c = item->getContainer()) {
+				if(c->getVector().size())
+					container_count += 1;
+			}
+			return true;
+		}
+
+		void operator()(Map& map, Tile* tile)
+		{
+			if(tile->empty())
+				return;
+
+			tile_count += 1;
+
+			bool is_detailed = false;
+			if(tile->ground)
+				is_detailed |= analyze(tile->ground);
+			for(Item* item : tile->items)
+				is_detailed |= analyze(item);
+
+			if(tile->spawn)
+				spawn_count += 1;
+
+			if(tile->creature)
+				creature_count += 1;
+
+			if(tile->isBlocking())
+				blocking_tile_count += 1;
+			else
+				walkable_tile_count += 1;
+
+			if(is_detailed)
+				detailed_tile_count += 1;
+		}
+
+		void merge(const TileCounter& other)
+		{
+			tile_count += other.tile_count;
+			detailed_tile_count += other.detailed_tile_count;
+			blocking_tile_count += other.blocking_tile_count;
+			walkable_tile_count += other.walkable_tile_count;
+			spawn_count += other.spawn_count;
+			creature_count += other.creature_count;
+			item_count += other.item_count;
+			loose_item_count += other.loose_item_count;
+			depot_count += other.depot_count;
+			action_item_count += other.action_item_count;
+			unique_item_count += other.unique_item_count;
+			container_count += other.container_count;
+		}
+	};
+}
+
 void MainMenuBar::OnMapStatistics(wxCommandEvent& WXUNUSED(event))
 {
 	if(!g_gui.IsEditorOpen())
@@ -1609,68 +1731,25 @@ void MainMenuBar::OnMapStatistics(wxCommandEvent& WXUNUSED(event))
 	double sqm_per_house = 0.0;
 	double sqm_per_town = 0.0;
 
-	for(MapIterator mit = map->begin(); mit != map->end(); ++mit) {
-		Tile* tile = (*mit)->get();
-		if(load_counter % 8192 == 0) {
-			g_gui.SetLoadDone((unsigned int)(int64_t(load_counter) * 95ll / int64_t(map->getTileCount())));
-		}
-
-		if(tile->empty())
-			continue;
-
-		tile_count += 1;
-
-		bool is_detailed = false;
-#define ANALYZE_ITEM(_item) {\
-	item_count += 1; \
-	if(!(_item)->isGroundTile() && !(_item)->isBorder()) { \
-		is_detailed = true; \
-		const ItemType& it = g_items.getItemType((_item)->getID()); \
-		if(it.moveable) { \
-			loose_item_count += 1; \
-		} \
-		if(it.isDepot()) { \
-			depot_count += 1; \
-		} \
-		if((_item)->getActionID() > 0) { \
-			action_item_count += 1; \
-		} \
-		if((_item)->getUniqueID() > 0) { \
-			unique_item_count += 1; \
-		} \
-		if(Container* c = dynamic_cast<Container*>((_item))) { \
-			if(c->getVector().size()) { \
-				container_count += 1; \
-			} \
-		} \
-	} \
-}
-		if(tile->ground) {
-			ANALYZE_ITEM(tile->ground);
-		}
-
-		for(Item* item : tile->items) {
-			ANALYZE_ITEM(item);
-		}
-#undef ANALYZE_ITEM
-
-		if(tile->spawn)
-			spawn_count += 1;
-
-		if(tile->creature)
-			creature_count += 1;
-
-		if(tile->isBlocking())
-			blocking_tile_count += 1;
-		else
-			walkable_tile_count += 1;
-
-		if(is_detailed)
-			detailed_tile_count += 1;
-
-		load_counter += 1;
+	OnMapStatistics::TileCounter counter;
+	for(const OnMapStatistics::TileCounter& region : foreach_TileOnMapParallel(*map, counter, false, GetWorkerThreads(),
+			[](int percent) { g_gui.SetLoadDone(percent * 95 / 100); })) {
+		counter.merge(region);
 	}
 
+	tile_count = counter.tile_count;
+	detailed_tile_count = counter.detailed_tile_count;
+	blocking_tile_count = counter.blocking_tile_count;
+	walkable_tile_count = counter.walkable_tile_count;
+	spawn_count = counter.spawn_count;
+	creature_count = counter.creature_count;
+	item_count = counter.item_count;
+	loose_item_count = counter.loose_item_count;
+	depot_count = counter.depot_count;
+	action_item_count = counter.action_item_count;
+	unique_item_count = counter.unique_item_count;
+	container_count = counter.container_count;
+
 	creatures_per_spawn = (spawn_count != 0 ? double(creature_count) / double(spawn_count) : -1.0);
 	percent_pathable = 100.0*(tile_count != 0 ? double(walkable_tile_count) / double(tile_count) : -1.0);
 	percent_detailed = 100.0*(tile_count != 0 ? double(detailed_tile_count) / double(tile_count) : -1.0);
@@ -1758,6 +1837,16 @@ void MainMenuBar::OnMapStatistics(wxCommandEvent& WXUNUSED(event))
 	if(largest_house)
 		os << "\t\tLargest House: \"" << largest_house->name << "\" (" << largest_house_size << " sqm)\n";
 
+	MapAllocator::MemoryUsage memory = MapAllocator::getMemoryUsage();
+	os << "\tMemory data (all open maps):\n";
+	os << "\t\tPooled objects: " << memory.objects << "\n";
+	os << "\t\tPool memory: " << (memory.reserved_bytes / 1024) << " KB (" << (memory.object_bytes / 1024) << " KB in use)\n";
+	os << "\t\tEstimated without pools: " << (memory.heap_estimate / 1024) << " KB\n";
+	if(tile_count > 0) {
+		os << "\t\tBytes per tile: " << double(memory.reserved_bytes) / tile_count
+			<< " (about " << double(memory.heap_estimate) / tile_count << " without pools)\n";
+	}
+
 	os << "\n";
 	os << "Generated by Remere's Map Editor version " + __RME_VERSION__ + "\n";
 
@@ -2158,7 +2247,34 @@ void MainMenuBar::SearchItems(bool unique, bool action, bool container, bool wri
 	searcher.search_container = container;
 	searcher.search_writeable = writable;
 
-	foreach_ItemOnMap(g_gui.GetCurrentMap(), searcher, onSelection);
+	Map& map = g_gui.GetCurrentMap();
+	// Only ids are searched for, the index knows every tile holding one
+	ItemIndex* index = map.getItemIndex();
+	bool indexed = index && !container && !writable;
+	std::vector<Tile*> tiles;
+	std::vector<Tile*> found_tiles;
+	if(indexed && unique) {
+		indexed = index->findTiles(map, ItemIndex::UNIQUE_ID, 0, found_tiles);
+		tiles.insert(tiles.end(), found_tiles.begin(), found_tiles.end());
+	}
+	if(indexed && action) {
+		indexed = index->findTiles(map, ItemIndex::ACTION_ID, 0, found_tiles);
+		tiles.insert(tiles.end(), found_tiles.begin(), found_tiles.end());
+	}
+
+	if(indexed) {
+		std::sort(tiles.begin(), tiles.end(), [](const Tile* a, const Tile* b) { return a->getPosition() < b->getPosition(); });
+		tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+
+		for(Tile* tile : tiles) {
+			if(!onSelection || tile->isSelected()) {
+				auto visit = [&](Item* item) { searcher(map, tile, item); };
+				foreach_ItemOnTile(tile, visit);
+			}
+		}
+	} else {
+		searcher.merge(foreach_ItemOnMapParallel(map, searcher, onSelection, GetWorkerThreads(), SetLoadDone));
+	}
 	searcher.sort();
 	std::vector<std::pair<Tile*, Item*> >& found = searcher.found;
 
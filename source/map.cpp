@@ -20,6 +20,7 @@
 #include "gui.h" // loadbar
 
 #include "map.h"
+#include "iomap_otbm.h"
 
 #include <sstream>
 
@@ -27,9 +28,13 @@ Map::Map() : BaseMap(),
 	width(512),
 	height(512),
 	houses(*this),
+	revision(0),
+	last_dirty_area(0xFFFFFFFF),
+	all_areas_dirty(false),
 	has_changed(false),
 	unnamed(false),
-	waypoints(*this)
+	waypoints(*this),
+	item_index_stale(false)
 {
 	// Earliest version possible
 	// Caller is responsible for converting us to proper version
@@ -63,6 +68,7 @@ bool Map::open(const std::string file)
 	}
 
 	has_changed = false;
+	clearDirtyAreas();
 
 	wxFileName fn = wxstr(file);
 	filename = fn.GetFullPath().mb_str(wxConvUTF8);
@@ -150,6 +156,7 @@ bool Map::convert(const ConversionMap& rm, bool showdialog)
 
 	uint64_t tiles_done = 0;
 	std::vector<uint16_t> id_list;
+	markAllAreasDirty();
 
 	//std::ofstream conversions("converted_items.txt");
 
@@ -290,6 +297,7 @@ void Map::cleanInvalidTiles(bool showdialog)
 			else {
 				delete *item_iter;
 				item_iter = tile->items.erase(item_iter);
+				markAreaDirty(tile->getPosition());
 			}
 		}
 
@@ -303,6 +311,38 @@ void Map::cleanInvalidTiles(bool showdialog)
 		g_gui.DestroyLoadBar();
 }
 
+void Map::markAreaDirty(int x, int y, int z)
+{
+	TileLocation* location = getTileL(x, y, z);
+	if(location) {
+		location->markChanged();
+	}
+	markAreaKeyDirty(getAreaKey(x, y, z));
+}
+
+void Map::markAreaKeyDirty(uint32_t key)
+{
+	if(key != last_dirty_area && !all_areas_dirty) {
+		dirty_areas.insert(key);
+		last_dirty_area = key;
+	}
+}
+
+void Map::markAllAreasDirty()
+{
+	item_index_stale = true;
+	markAllChanged();
+	all_areas_dirty = true;
+	dirty_areas.clear();
+}
+
+void Map::clearDirtyAreas()
+{
+	all_areas_dirty = false;
+	dirty_areas.clear();
+	last_dirty_area = 0xFFFFFFFF;
+}
+
 bool Map::doChange()
 {
 	bool doupdate = !has_changed;
@@ -369,6 +409,7 @@ bool Map::addSpawn(Tile* tile)
 				ctile_loc->increaseSpawnCount();
 			}
 		}
+		spawn_grid.add(tile->getPosition(), spawn->getSize());
 		spawns.addSpawn(tile);
 		return true;
 	}
@@ -393,6 +434,7 @@ void Map::removeSpawnInternal(Tile* tile)
 				ctile_loc->decreaseSpawnCount();
 		}
 	}
+	spawn_grid.remove(tile->getPosition(), spawn->getSize());
 }
 
 void Map::removeSpawn(Tile* tile)
@@ -412,49 +454,13 @@ SpawnList Map::getSpawnList(const Tile* tile) const
 	if(!location || location->getSpawnCount() == 0)
 		return list;
 
-	uint32_t found = 0;
-	if(tile->spawn) {
-		++found;
-		list.push_back(tile->spawn);
-	}
-
-	// Scans the border tiles in an expanding square around the original spawn
-	const Position& position = tile->getPosition();
-	int start_x = position.x - 1;
-	int end_x = position.x + 1;
-	int start_y = position.y - 1;
-	int end_y = position.y + 1;
-
-	while(found != location->getSpawnCount()) {
-		for(int x = start_x; x <= end_x; ++x) {
-			const Tile* start_tile = getTile(x, start_y, position.z);
-			if(start_tile && start_tile->spawn) {
-				list.push_back(start_tile->spawn);
-				++found;
-			}
-			const Tile* end_tile = getTile(x, end_y, position.z);
-			if(end_tile && end_tile->spawn) {
-				list.push_back(end_tile->spawn);
-				++found;
-			}
+	std::vector<Position> centers;
+	spawn_grid.find(tile->getPosition(), centers);
+	for(const Position& center : centers) {
+		const Tile* spawn_tile = getTile(center);
+		if(spawn_tile && spawn_tile->spawn) {
+			list.push_back(spawn_tile->spawn);
 		}
-
-		for(int y = start_y + 1; y < end_y; ++y) {
-			const Tile* start_tile = getTile(start_x, y, position.z);
-			if(start_tile && start_tile->spawn) {
-				list.push_back(start_tile->spawn);
-				++found;
-			}
-			const Tile* end_tile = getTile(end_x, y, position.z);
-			if(end_tile && end_tile->spawn) {
-				list.push_back(end_tile->spawn);
-				++found;
-			}
-		}
-		--start_x;
-		--start_y;
-		++end_x;
-		++end_y;
 	}
 	return list;
 }
@@ -471,156 +477,33 @@ SpawnList Map::getSpawnList(int x, int y, int z) const
 	return getSpawnList(tile);
 }
 
-bool Map::exportMinimap(FileName filename, int floor /*= rme::MapGroundLayer*/, bool displaydialog)
+void Map::setItemIndexEnabled(bool enabled)
 {
-	uint8_t* pic = nullptr;
-
-	try
-	{
-		int min_x = 0x10000, min_y = 0x10000;
-		int max_x = 0x00000, max_y = 0x00000;
-
-		if(size() == 0)
-			return true;
-
-		uint32_t minimap_colors[256];
-		for(int i = 0; i < 256; ++i)
-			minimap_colors[i] = colorFromEightBit(i).GetRGB();
-
-		for(MapIterator mit = begin(); mit != end(); ++mit) {
-			if((*mit)->get() == nullptr || (*mit)->empty())
-				continue;
-
-			Position pos = (*mit)->getPosition();
-
-			if(pos.x < min_x)
-				min_x = pos.x;
-
-			if(pos.y < min_y)
-				min_y = pos.y;
-
-			if(pos.x > max_x)
-				max_x = pos.x;
-
-			if(pos.y > max_y)
-				max_y = pos.y;
-
-		}
-
-		int minimap_width = max_x - min_x+1;
-		int minimap_height = max_y - min_y+1;
-
-		pic = newd uint8_t[minimap_width*minimap_height]; // 1 byte per pixel
-
-		memset(pic, 0, minimap_width*minimap_height);
-
-		int tiles_iterated = 0;
-		for(MapIterator mit = begin(); mit != end(); ++mit) {
-			Tile* tile = (*mit)->get();
-			++tiles_iterated;
-			if(tiles_iterated % 8192 == 0 && displaydialog)
-				g_gui.SetLoadDone(int(tiles_iterated / double(tilecount) * 90.0));
-
-			if(tile->empty() || tile->getZ() != floor)
-				continue;
-
-			//std::cout << "Pixel : " << (tile->getY() - min_y) * width + (tile->getX() - min_x) << std::endl;
-			uint32_t pixelpos = (tile->getY() - min_y) * minimap_width + (tile->getX() - min_x);
-			uint8_t& pixel = pic[pixelpos];
-
-			for(ItemVector::const_reverse_iterator item_iter = tile->items.rbegin(); item_iter != tile->items.rend(); ++item_iter) {
-				if((*item_iter)->getMiniMapColor()) {
-					pixel = (*item_iter)->getMiniMapColor();
-					break;
-				}
-			}
-			if(pixel == 0)
-				// check ground too
-				if(tile->hasGround())
-					pixel = tile->ground->getMiniMapColor();
-		}
-
-		// Create a file for writing
-		FileWriteHandle fh(nstr(filename.GetFullPath()));
-
-		if(!fh.isOpen()) {
-			delete[] pic;
-			return false;
-		}
-		// Store the magic number
-		fh.addRAW("BM");
-
-		// Store the file size
-		// We need to predict how large it will be
-		uint32_t file_size =
-					14 // header
-					+40 // image data header
-					+256*4 // color palette
-					+((minimap_width + 3) / 4 * 4) * height; // pixels
-		fh.addU32(file_size);
-
-		// Two values reserved, must always be 0.
-		fh.addU16(0);
-		fh.addU16(0);
-
-		// Bitmapdata offset
-		fh.addU32(14 + 40 + 256*4);
-
-		// Header size
-		fh.addU32(40);
-
-		// Header width/height
-		fh.addU32(minimap_width);
-		fh.addU32(minimap_height);
-
-		// Color planes
-		fh.addU16(1);
-
-		// bits per pixel, OT map format is 8
-		fh.addU16(8);
-
-		// compression type, 0 is no compression
-		fh.addU32(0);
-
-		// image size, 0 is valid if we use no compression
-		fh.addU32(0);
-
-		// horizontal/vertical resolution in pixels / meter
-		fh.addU32(4000);
-		fh.addU32(4000);
-
-		// Number of colors
-		fh.addU32(256);
-		// Important colors, 0 is all
-		fh.addU32(0);
-
-		// Write the color palette
-		for(int i = 0; i < 256; ++i)
-			fh.addU32(minimap_colors[i]);
-
-		// Bitmap width must be divisible by four, calculate how much padding we need
-		int padding = ((minimap_width & 3) != 0? 4-(minimap_width & 3) : 0);
-		// Bitmap rows are saved in reverse order
-		for(int y = minimap_height-1; y >= 0; --y) {
-			fh.addRAW(pic + y*minimap_width, minimap_width);
-			for(int i = 0; i < padding; ++i) {
-				fh.addU8(0);
-			}
-			if(y % 100 == 0 && displaydialog) {
-				g_gui.SetLoadDone(90 + int((minimap_height-y) / double(minimap_height) * 10.0));
-			}
-		}
-
-		delete[] pic;
-		//fclose(file);
-		fh.close();
+	if(!enabled) {
+		item_index.reset();
+	} else if(!item_index) {
+		// Built on the first search, loading a map does not pay for it
+		item_index.reset(newd ItemIndex);
+		item_index_stale = true;
 	}
-	catch(...)
-	{
-		delete[] pic;
+}
+
+ItemIndex* Map::getItemIndex()
+{
+	if(item_index && item_index_stale) {
+		item_index->build(*this);
+		item_index_stale = false;
 	}
+	return item_index.get();
+}
 
-	return true;
+void Map::updateIndexes(Tile* old_tile, Tile* new_tile)
+{
+	updateUniqueIds(old_tile, new_tile);
+	if(item_index && !item_index_stale) {
+		item_index->removeTile(old_tile);
+		item_index->addTile(new_tile);
+	}
 }
 
 void Map::updateUniqueIds(Tile* old_tile, Tile* new_tile)
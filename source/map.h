@@ -25,7 +25,14 @@
 #include "spawn.h"
 #include "complexitem.h"
 #include "waypoints.h"
+#include "item_index.h"
 #include "templates.h"
+#include "threads.h"
+
+#include <functional>
+#include <unordered_set>
+
+struct OTBMFileIndex;
 
 class Map : public BaseMap
 {
@@ -36,8 +43,6 @@ public:
 
 	// Operations on the entire map
 	void cleanInvalidTiles(bool showdialog = false);
-	// Save a bmp image of the minimap
-	bool exportMinimap(FileName filename, int floor = rme::MapGroundLayer, bool showdialog = false);
 	//
 	bool convert(MapVersion to, bool showdialog = false);
 	bool convert(const ConversionMap& cm, bool showdialog = false);
@@ -93,6 +98,27 @@ public:
 
 	bool hasUniqueId(uint16_t uid) const;
 
+	// Index of the item, action and unique ids on the map, only kept when
+	// enabled. Returns nullptr if it is not, searches have to walk the map then.
+	void setItemIndexEnabled(bool enabled);
+	ItemIndex* getItemIndex();
+
+	// Tile areas are the 256x256 blocks of a floor stored in one OTBM tile area node.
+	// The map keeps track of the areas changed since it was last loaded or saved.
+	static uint32_t getAreaKey(int x, int y, int z) noexcept {
+		return static_cast<uint32_t>((x >> 8) & 0xFF) | (static_cast<uint32_t>((y >> 8) & 0xFF) << 8) | (static_cast<uint32_t>(z) << 16);
+	}
+	void markAreaDirty(const Position& position) { markAreaDirty(position.x, position.y, position.z); }
+	void markAreaDirty(int x, int y, int z);
+	// For changes made without going through setTile/swapTile on many tiles
+	void markAllAreasDirty();
+	// For changes that alter how every tile is drawn but not what is saved
+	void markAllChanged() noexcept { revision = TileLocation::nextRevision(); }
+	// Revision (see TileLocation) of the last change made to all tiles at once
+	uint32_t getRevision() const noexcept { return revision; }
+	void clearDirtyAreas();
+	bool isAreaDirty(uint32_t key) const { return all_areas_dirty || dirty_areas.count(key) != 0; }
+
 protected:
 	// Loads a map
 	bool open(const std::string identifier);
@@ -100,6 +126,8 @@ protected:
 protected:
 	void removeSpawnInternal(Tile* tile);
 
+	SpawnGrid spawn_grid;
+
 	wxArrayString warnings;
 	wxString error;
 
@@ -121,10 +149,22 @@ public:
 	Spawns spawns;
 
 protected:
-	void updateUniqueIds(Tile* old_tile, Tile* new_tile) override;
+	void updateIndexes(Tile* old_tile, Tile* new_tile) override;
+	void updateUniqueIds(Tile* old_tile, Tile* new_tile);
 	void addUniqueId(uint16_t uid);
 	void removeUniqueId(uint16_t uid);
 
+	// The location itself was already marked as changed by setTile/swapTile
+	void tileChanged(int x, int y, int z) override { markAreaKeyDirty(getAreaKey(x, y, z)); }
+	void markAreaKeyDirty(uint32_t key);
+
+	uint32_t revision;
+	std::unordered_set<uint32_t> dirty_areas;
+	uint32_t last_dirty_area; // Skips the set lookup for consecutive tiles
+	bool all_areas_dirty;
+	// Layout of the file the map was last loaded from or saved to
+	std::unique_ptr<OTBMFileIndex> otbm_index;
+
 	bool has_changed; // If the map has changed
 	bool unnamed; // If the map has yet to receive a name
 
@@ -137,8 +177,37 @@ public:
 
 private:
 	std::vector<uint16_t> uniqueIds;
+	std::unique_ptr<ItemIndex> item_index;
+	bool item_index_stale; // Built on next use, until the first search and after changes made in place to every tile
 };
 
+// Calls foreach for the ground, every item and everything inside containers
+template <typename ForeachType>
+inline void foreach_ItemOnTile(Tile* tile, ForeachType& foreach)
+{
+	if(tile->ground) {
+		foreach(tile->ground);
+	}
+
+	std::queue<Container*> containers;
+	for(Item* item : tile->items) {
+		foreach(item);
+		if(Container* container = item->getContainer()) {
+			containers.push(container);
+		}
+
+		while(!containers.empty()) {
+			for(Item* inner : containers.front()->getVector()) {
+				foreach(inner);
+				if(Container* container = inner->getContainer()) {
+					containers.push(container);
+				}
+			}
+			containers.pop();
+		}
+	}
+}
+
 template <typename ForeachType>
 inline void foreach_ItemOnMap(Map& map, ForeachType& foreach, bool selectedTiles)
 {
@@ -149,37 +218,9 @@ inline void foreach_ItemOnMap(Map& map, ForeachType& foreach, bool selectedTiles
 	while(tileiter != end) {
 		++done;
 		Tile* tile = (*tileiter)->get();
-		if(selectedTiles && !tile->isSelected()) {
-			++tileiter;
-			continue;
-		}
-
-		if(tile->ground) {
-			foreach(map, tile, tile->ground, done);
-		}
-
-		std::queue<Container*> containers;
-		for(ItemVector::iterator itemiter = tile->items.begin(); itemiter != tile->items.end(); ++itemiter) {
-			Item* item = *itemiter;
-			Container* container = dynamic_cast<Container*>(item);
-			foreach(map, tile, item, done);
-			if(container) {
-				containers.push(container);
-
-				do {
-					container = containers.front();
-					ItemVector& v = container->getVector();
-					for(ItemVector::iterator containeriter = v.begin(); containeriter != v.end(); ++containeriter) {
-						Item* i = *containeriter;
-						Container* c = dynamic_cast<Container*>(i);
-						foreach(map, tile, i, done);
-						if(c) {
-							containers.push(c);
-						}
-					}
-					containers.pop();
-				} while(containers.size());
-			}
+		if(!selectedTiles || tile->isSelected()) {
+			auto visit = [&](Item* item) { foreach(map, tile, item, done); };
+			foreach_ItemOnTile(tile, visit);
 		}
 		++tileiter;
 	}
@@ -196,63 +237,126 @@ inline void foreach_TileOnMap(Map& map, ForeachType& foreach)
 		foreach(map, (*tileiter++)->get(), ++done);
 }
 
+// The walks below split the map into independent regions of the tree and go
+// through them on up to threadcount threads. Every region gets its own copy of
+// the visitor, which may only read the map. The copies come back in map order,
+// so merging them (or changing the map from them) on the calling thread gives
+// the same result as a serial walk. progress gets a percentage and is called
+// on the calling thread only.
+typedef std::function<void(int)> MapWalkProgress;
+
+template <typename VisitorType>
+inline std::vector<VisitorType> foreach_TileOnMapParallel(Map& map, const VisitorType& visitor, bool selectedTiles, int threadcount, const MapWalkProgress& progress = nullptr)
+{
+	threadcount = std::max(threadcount, 1);
+
+	// A few regions per thread, maps are rarely spread evenly
+	std::vector<QTreeNode*> regions;
+	map.getRegions(regions, static_cast<size_t>(threadcount) * 8);
+
+	std::vector<VisitorType> visitors(regions.size(), visitor);
+	std::function<void(size_t)> report;
+	if(progress) {
+		report = [&](size_t done) { progress(static_cast<int>(100 * done / regions.size())); };
+	}
+
+	RunJobs(regions.size(), threadcount, [&](size_t index) {
+		VisitorType& local = visitors[index];
+		MapIterator end = map.end();
+		for(MapIterator it = map.begin(regions[index]); it != end; ++it) {
+			Tile* tile = (*it)->get();
+			if(!selectedTiles || tile->isSelected()) {
+				local(map, tile);
+			}
+		}
+	}, report);
+	return visitors;
+}
+
+template <typename VisitorType>
+inline std::vector<VisitorType> foreach_ItemOnMapParallel(Map& map, const VisitorType& visitor, bool selectedTiles, int threadcount, const MapWalkProgress& progress = nullptr)
+{
+	struct TileVisitor {
+		VisitorType visitor;
+		void operator()(Map& map, Tile* tile) {
+			auto visit = [&](Item* item) { visitor(map, tile, item); };
+			foreach_ItemOnTile(tile, visit);
+		}
+	};
+
+	std::vector<TileVisitor> tile_visitors = foreach_TileOnMapParallel(map, TileVisitor{visitor}, selectedTiles, threadcount, progress);
+	std::vector<VisitorType> visitors;
+	visitors.reserve(tile_visitors.size());
+	for(TileVisitor& tile_visitor : tile_visitors) {
+		visitors.push_back(std::move(tile_visitor.visitor));
+	}
+	return visitors;
+}
+
+// Removes every tile remove_if(map, tile) holds for. The condition is checked
+// against the map as it was before anything got removed.
 template <typename RemoveIfType>
-inline long long remove_if_TileOnMap(Map& map, RemoveIfType& remove_if)
+inline long long remove_if_TileOnMap(Map& map, const RemoveIfType& remove_if, int threadcount, const MapWalkProgress& progress = nullptr)
 {
-	MapIterator tileiter = map.begin();
-	MapIterator end = map.end();
-	long long done = 0;
-	long long removed = 0;
-	long long total = map.getTileCount();
+	struct Finder {
+		const RemoveIfType* remove_if;
+		std::vector<Tile*> found;
+		void operator()(Map& map, Tile* tile) {
+			if((*remove_if)(map, tile)) {
+				found.push_back(tile);
+			}
+		}
+	};
 
-	while(tileiter != end) {
-		Tile* tile = (*tileiter)->get();
-		if(remove_if(map, tile, removed, done, total)) {
+	long long removed = 0;
+	for(const Finder& finder : foreach_TileOnMapParallel(map, Finder{&remove_if, {}}, false, threadcount, progress)) {
+		for(Tile* tile : finder.found) {
 			map.setTile(tile->getPosition(), nullptr, true);
 			++removed;
 		}
-		++tileiter;
-		++done;
 	}
-
 	return removed;
 }
 
+// Removes the ground and top items condition(map, item) holds for
 template <typename RemoveIfType>
-inline int64_t RemoveItemOnMap(Map& map, RemoveIfType& condition, bool selectedOnly) {
-	int64_t done = 0;
-	int64_t removed = 0;
-
-	MapIterator it = map.begin();
-	MapIterator end = map.end();
-
-	while(it != end) {
-		++done;
-		Tile* tile = (*it)->get();
-		if(selectedOnly && !tile->isSelected()) {
-			++it;
-			continue;
+inline int64_t RemoveItemOnMap(Map& map, const RemoveIfType& condition, bool selectedOnly, int threadcount, const MapWalkProgress& progress = nullptr)
+{
+	struct Finder {
+		const RemoveIfType* condition;
+		std::vector<Tile*> found;
+		void operator()(Map& map, Tile* tile) {
+			bool match = tile->ground && (*condition)(map, tile->ground);
+			for(auto it = tile->items.begin(); !match && it != tile->items.end(); ++it) {
+				match = (*condition)(map, *it);
+			}
+			if(match) {
+				found.push_back(tile);
+			}
 		}
+	};
 
-		if(tile->ground) {
-			if(condition(map, tile->ground, removed, done)) {
+	int64_t removed = 0;
+	for(const Finder& finder : foreach_TileOnMapParallel(map, Finder{&condition, {}}, selectedOnly, threadcount, progress)) {
+		for(Tile* tile : finder.found) {
+			if(tile->ground && condition(map, tile->ground)) {
 				delete tile->ground;
 				tile->ground = nullptr;
 				++removed;
 			}
-		}
 
-		for(auto iit = tile->items.begin(); iit != tile->items.end();) {
-			Item* item = *iit;
-			if(condition(map, item, removed, done)) {
-				iit = tile->items.erase(iit);
-				delete item;
-				++removed;
+			for(auto it = tile->items.begin(); it != tile->items.end();) {
+				Item* item = *it;
+				if(condition(map, item)) {
+					it = tile->items.erase(it);
+					delete item;
+					++removed;
+				} else {
+					++it;
+				}
 			}
-			else
-				++iit;
+			map.markAreaDirty(tile->getPosition());
 		}
-		++it;
 	}
 	return removed;
 }
@@ -20,6 +20,7 @@
 
 #include "tile.h"
 #include "map_region.h"
+#include "memory_pool.h"
 
 class BaseMap;
 
@@ -62,6 +63,29 @@ public:
 	void freeNode(QTreeNode* qt) {
 		delete qt;
 	}
+
+	// Tiles, floors, nodes and items of all maps share the same pools,
+	// so this covers every open map (and the copy buffer).
+	struct MemoryUsage {
+		size_t objects = 0;
+		size_t object_bytes = 0; // Bytes handed out to objects
+		size_t reserved_bytes = 0; // Bytes taken from the system for the pools
+		size_t heap_estimate = 0; // What the same objects would take allocated one by one
+	};
+
+	static MemoryUsage getMemoryUsage() {
+		// Typical per allocation overhead (header and rounding) of a 64-bit heap
+		const size_t heap_overhead = 16;
+
+		MemoryUsage usage;
+		for(const MemoryPool::Statistics& pool : PooledMemory::getStatistics()) {
+			usage.objects += pool.live_blocks;
+			usage.object_bytes += pool.live_blocks * pool.block_size;
+			usage.reserved_bytes += pool.slabs * MemoryPool::SlabSize;
+			usage.heap_estimate += pool.live_blocks * (pool.block_size + heap_overhead);
+		}
+		return usage;
+	}
 };
 
 #endif
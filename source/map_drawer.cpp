@@ -30,6 +30,7 @@
 #include "map_display.h"
 #include "copybuffer.h"
 #include "live_socket.h"
+#include "live_client.h"
 #include "graphics.h"
 
 #include "doodad_brush.h"
@@ -43,6 +44,7 @@
 #include "table_brush.h"
 #include "waypoint_brush.h"
 #include "light_drawer.h"
+#include "texture_atlas.h"
 
 DrawingOptions::DrawingOptions()
 {
@@ -133,7 +135,9 @@ bool DrawingOptions::isDrawLight() const noexcept
 	return show_ingame_box && show_lights;
 }
 
-MapDrawer::MapDrawer(MapCanvas* canvas) : canvas(canvas), editor(canvas->editor)
+MapDrawer::MapDrawer(MapCanvas* canvas) : canvas(canvas), editor(canvas->editor),
+	node_cache_options(0),
+	frame(0)
 {
 	light_drawer = std::make_shared<LightDrawer>();
 }
@@ -291,6 +295,7 @@ void MapDrawer::DrawMap()
 	int box_end_map_y = center_y + rme::ClientMapHeight + offset_y;
 
 	bool live_client = editor.IsLiveClient();
+	bool drew_live_node = false;
 
 	Brush* brush = g_gui.GetCurrentBrush();
 
@@ -306,6 +311,20 @@ void MapDrawer::DrawMap()
 	bool only_colors = options.isOnlyColors();
 	bool tile_indicators = options.isTileIndicators();
 
+	// Tooltips are written while walking the tiles and animated items change
+	// every frame, so neither can be replayed from the cache
+	bool cache_nodes = !only_colors && !options.isTooltips() && !(options.show_preview && zoom <= 2.0);
+	if(cache_nodes) {
+		uint64_t cache_options = getNodeCacheOptions();
+		if(cache_options != node_cache_options) {
+			node_cache.clear();
+			node_cache_options = cache_options;
+		}
+		++frame;
+	}
+
+	TextureAtlas& atlas = g_gui.gfx.getAtlas();
+
 	for(int map_z = start_z; map_z >= superend_z; map_z--) {
 		if(options.show_shade) {
 			DrawShade(map_z);
@@ -315,11 +334,18 @@ void MapDrawer::DrawMap()
 			if(!only_colors)
 				glEnable(GL_TEXTURE_2D);
 
+			// Everything on this floor is queued and drawn in as few calls as possible
+			sprite_batch.begin();
+
 			int nd_start_x = start_x & ~3;
 			int nd_start_y = start_y & ~3;
 			int nd_end_x = (end_x & ~3) + 4;
 			int nd_end_y = (end_y & ~3) + 4;
 
+			// Cached quads are stored relative to the map origin of this floor
+			int origin_x, origin_y;
+			getDrawPosition(Position(0, 0, map_z), origin_x, origin_y);
+
 			for(int nd_map_x = nd_start_x; nd_map_x <= nd_end_x; nd_map_x += 4) {
 				for(int nd_map_y = nd_start_y; nd_map_y <= nd_end_y; nd_map_y += 4) {
 					QTreeNode* nd = editor.getMap().getLeaf(nd_map_x, nd_map_y);
@@ -331,14 +357,43 @@ void MapDrawer::DrawMap()
 					}
 
 					if(!live_client || nd->isVisible(map_z > rme::MapGroundLayer)) {
-						for(int map_x = 0; map_x < 4; ++map_x) {
-							for(int map_y = 0; map_y < 4; ++map_y) {
-								TileLocation* location = nd->getTile(map_x, map_y, map_z);
-								DrawTile(location);
-								if(location && options.isDrawLight()) {
-									auto& position = location->getPosition();
-									if(position.x >= box_start_map_x && position.x <= box_end_map_x && position.y >= box_start_map_y && position.y <= box_end_map_y) {
-										AddLight(location);
+						drew_live_node = live_client;
+						CachedNode* cached = nullptr;
+						uint32_t revision = 0;
+						if(cache_nodes) {
+							uint64_t key = (uint64_t(nd_map_x >> 2) << 32) | (uint64_t(nd_map_y >> 2) << 8) | uint64_t(map_z);
+							cached = &node_cache[key];
+							cached->last_frame = frame;
+							revision = getNodeRevision(nd, map_z);
+						}
+
+						if(cached && cached->valid && cached->revision == revision && cached->atlas_generation == atlas.getGeneration()) {
+							sprite_batch.replay(cached->recording, origin_x, origin_y, atlas);
+						} else {
+							SpriteBatch::Mark mark = sprite_batch.mark();
+							uint32_t atlas_generation = atlas.getGeneration();
+							for(int map_x = 0; map_x < 4; ++map_x) {
+								for(int map_y = 0; map_y < 4; ++map_y) {
+									DrawTile(nd->getTile(map_x, map_y, map_z));
+								}
+							}
+							if(cached) {
+								// Nodes with untextured quads flush the batch and are never cached
+								cached->valid = sprite_batch.record(mark, origin_x, origin_y, cached->recording);
+								cached->revision = revision;
+								cached->atlas_generation = atlas_generation;
+							}
+						}
+
+						if(options.isDrawLight()) {
+							for(int map_x = 0; map_x < 4; ++map_x) {
+								for(int map_y = 0; map_y < 4; ++map_y) {
+									TileLocation* location = nd->getTile(map_x, map_y, map_z);
+									if(location) {
+										auto& position = location->getPosition();
+										if(position.x >= box_start_map_x && position.x <= box_end_map_x && position.y >= box_start_map_y && position.y <= box_end_map_y) {
+											AddLight(location);
+										}
 									}
 								}
 							}
@@ -359,6 +414,7 @@ void MapDrawer::DrawMap()
 						int cy = (nd_map_y) * rme::TileSize - view_scroll_y - getFloorAdjustment(floor);
 						int cx = (nd_map_x) * rme::TileSize - view_scroll_x - getFloorAdjustment(floor);
 
+						sprite_batch.flush();
 						glColor4ub(255, 0, 255, 128);
 						glBegin(GL_QUADS);
 							glVertex2f(cx, cy + rme::TileSize * 4);
@@ -370,6 +426,8 @@ void MapDrawer::DrawMap()
 				}
 			}
 
+			sprite_batch.end();
+
 			if(!only_colors)
 				glDisable(GL_TEXTURE_2D);
 
@@ -385,10 +443,75 @@ void MapDrawer::DrawMap()
 		++end_y;
 	}
 
+	if(live_client) {
+		editor.SetNodeRequestView(start_x, start_y, end_x, end_y, floor > rme::MapGroundLayer);
+		if(drew_live_node) {
+			editor.GetLiveClient()->noteNodeDrawn();
+		}
+	}
+
+	if(cache_nodes) {
+		trimNodeCache();
+	}
+
 	if(!only_colors)
 		glEnable(GL_TEXTURE_2D);
 }
 
+uint64_t MapDrawer::getNodeCacheOptions() const
+{
+	uint64_t flags = 0;
+	auto add = [&flags](bool flag) { flags = (flags << 1) | (flag ? 1 : 0); };
+	add(options.ingame);
+	add(options.transparent_items);
+	add(options.show_creatures);
+	add(options.show_spawns);
+	add(options.show_houses);
+	add(options.show_special_tiles);
+	add(options.show_items);
+	add(options.highlight_items);
+	add(options.show_blocking);
+	add(options.show_only_colors);
+	add(options.show_only_modified);
+	add(options.show_hooks);
+	add(options.show_pickupables);
+	add(options.show_moveables);
+	add(options.hide_items_when_zoomed && zoom > 10.f);
+	return (uint64_t(current_house_id) << 32) | flags;
+}
+
+uint32_t MapDrawer::getNodeRevision(QTreeNode* node, int z) const
+{
+	// Revisions only go up, so the newest one tells whether anything changed
+	uint32_t revision = editor.getMap().getRevision();
+	for(int x = 0; x < 4; ++x) {
+		for(int y = 0; y < 4; ++y) {
+			const TileLocation* location = node->getTile(x, y, z);
+			if(location) {
+				revision = std::max(revision, location->getRevision());
+			}
+		}
+	}
+	return revision;
+}
+
+void MapDrawer::trimNodeCache()
+{
+	// Forget nodes that have been off screen for a while
+	const uint32_t max_age = 256;
+	if(frame % max_age != 0) {
+		return;
+	}
+
+	for(auto it = node_cache.begin(); it != node_cache.end();) {
+		if(frame - it->second.last_frame > max_age) {
+			it = node_cache.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
 void MapDrawer::DrawSecondaryMap(int map_z)
 {
 	if(options.ingame)
@@ -410,6 +533,7 @@ void MapDrawer::DrawSecondaryMap(int map_z)
 	}
 
 	glEnable(GL_TEXTURE_2D);
+	sprite_batch.begin();
 
 	for(int map_x = start_x; map_x <= end_x; map_x++) {
 		for(int map_y = start_y; map_y <= end_y; map_y++) {
@@ -476,6 +600,7 @@ void MapDrawer::DrawSecondaryMap(int map_z)
 		}
 	}
 
+	sprite_batch.end();
 	glDisable(GL_TEXTURE_2D);
 }
 
@@ -1076,6 +1201,7 @@ void MapDrawer::BlitItem(int& draw_x, int& draw_y, const Tile* tile, const Item*
 {
 	const ItemType& type = g_items.getItemType(item->getID());
 	if(type.id == 0) {
+		sprite_batch.flush();
 		glDisable(GL_TEXTURE_2D);
 		glBlitSquare(draw_x, draw_y, *wxRED);
 		glEnable(GL_TEXTURE_2D);
@@ -1090,11 +1216,13 @@ void MapDrawer::BlitItem(int& draw_x, int& draw_y, const Tile* tile, const Item*
 
 	// Ugly hacks. :)
 	if(type.id == 459 && !options.ingame) {
+		sprite_batch.flush();
 		glDisable(GL_TEXTURE_2D);
 		glBlitSquare(draw_x, draw_y, red, green, 0, alpha/3*2);
 		glEnable(GL_TEXTURE_2D);
 		return;
 	} else if(type.id == 460 && !options.ingame) {
+		sprite_batch.flush();
 		glDisable(GL_TEXTURE_2D);
 		glBlitSquare(draw_x, draw_y, red, 0, 0, alpha/3*2);
 		glEnable(GL_TEXTURE_2D);
@@ -1172,14 +1300,14 @@ void MapDrawer::BlitItem(int& draw_x, int& draw_y, const Tile* tile, const Item*
 	for(int cx = 0; cx != sprite->width; cx++) {
 		for(int cy = 0; cy != sprite->height; cy++) {
 			for(int cf = 0; cf != sprite->layers; cf++) {
-				int texnum = sprite->getHardwareID(cx,cy,cf,
+				const AtlasRegion* texture = sprite->getAtlasRegion(cx,cy,cf,
 					subtype,
 					pattern_x,
 					pattern_y,
 					pattern_z,
 					frame
 				);
-				glBlitTexture(screenx - cx * rme::TileSize, screeny - cy * rme::TileSize, texnum, red, green, blue, alpha);
+				glBlitTexture(screenx - cx * rme::TileSize, screeny - cy * rme::TileSize, texture, red, green, blue, alpha);
 			}
 		}
 	}
@@ -1201,11 +1329,13 @@ void MapDrawer::BlitItem(int& draw_x, int& draw_y, const Position& pos, const It
 	}
 
 	if(type.id == 459 && !options.ingame) { // Ugly hack yes?
+		sprite_batch.flush();
 		glDisable(GL_TEXTURE_2D);
 		glBlitSquare(draw_x, draw_y, red, green, 0, alpha/3*2);
 		glEnable(GL_TEXTURE_2D);
 		return;
 	} else if(type.id == 460 && !options.ingame) { // Ugly hack yes?
+		sprite_batch.flush();
 		glDisable(GL_TEXTURE_2D);
 		glBlitSquare(draw_x, draw_y, red, 0, 0, alpha/3*2);
 		glEnable(GL_TEXTURE_2D);
@@ -1275,14 +1405,14 @@ void MapDrawer::BlitItem(int& draw_x, int& draw_y, const Position& pos, const It
 	for(int cx = 0; cx != sprite->width; ++cx) {
 		for(int cy = 0; cy != sprite->height; ++cy) {
 			for(int cf = 0; cf != sprite->layers; ++cf) {
-				int texnum = sprite->getHardwareID(cx,cy,cf,
+				const AtlasRegion* texture = sprite->getAtlasRegion(cx,cy,cf,
 					subtype,
 					pattern_x,
 					pattern_y,
 					pattern_z,
 					frame
 				);
-				glBlitTexture(screenx - cx * rme::TileSize, screeny - cy * rme::TileSize, texnum, red, green, blue, alpha);
+				glBlitTexture(screenx - cx * rme::TileSize, screeny - cy * rme::TileSize, texture, red, green, blue, alpha);
 			}
 		}
 	}
@@ -1308,8 +1438,8 @@ void MapDrawer::BlitSpriteType(int screenx, int screeny, uint32_t spriteid, int
 	for(int cx = 0; cx != sprite->width; ++cx) {
 		for(int cy = 0; cy != sprite->height; ++cy) {
 			for(int cf = 0; cf != sprite->layers; ++cf) {
-				int texnum = sprite->getHardwareID(cx,cy,cf,-1,0,0,0, frame);
-				glBlitTexture(screenx - cx * rme::TileSize, screeny - cy * rme::TileSize, texnum, red, green, blue, alpha);
+				const AtlasRegion* texture = sprite->getAtlasRegion(cx,cy,cf,-1,0,0,0, frame);
+				glBlitTexture(screenx - cx * rme::TileSize, screeny - cy * rme::TileSize, texture, red, green, blue, alpha);
 			}
 		}
 	}
@@ -1326,8 +1456,8 @@ void MapDrawer::BlitSpriteType(int screenx, int screeny, GameSprite* sprite, int
 	for(int cx = 0; cx != sprite->width; ++cx) {
 		for(int cy = 0; cy != sprite->height; ++cy) {
 			for(int cf = 0; cf != sprite->layers; ++cf) {
-				int texnum = sprite->getHardwareID(cx,cy,cf,-1,0,0,0, frame);
-				glBlitTexture(screenx - cx * rme::TileSize, screeny - cy * rme::TileSize, texnum, red, green, blue, alpha);
+				const AtlasRegion* texture = sprite->getAtlasRegion(cx,cy,cf,-1,0,0,0, frame);
+				glBlitTexture(screenx - cx * rme::TileSize, screeny - cy * rme::TileSize, texture, red, green, blue, alpha);
 			}
 		}
 	}
@@ -1350,8 +1480,8 @@ void MapDrawer::BlitCreature(int screenx, int screeny, const Outfit& outfit, Dir
 			if(GameSprite* mountSpr = g_gui.gfx.getCreatureSprite(outfit.lookMount)) {
 				for(int cx = 0; cx != mountSpr->width; ++cx) {
 					for(int cy = 0; cy != mountSpr->height; ++cy) {
-						int texnum = mountSpr->getHardwareID(cx, cy, 0, 0, (int)dir, 0, 0, 0);
-						glBlitTexture(screenx - cx * rme::TileSize, screeny - cy * rme::TileSize, texnum, red, green, blue, alpha);
+						const AtlasRegion* texture = mountSpr->getAtlasRegion(cx, cy, 0, 0, (int)dir, 0, 0, 0);
+						glBlitTexture(screenx - cx * rme::TileSize, screeny - cy * rme::TileSize, texture, red, green, blue, alpha);
 					}
 				}
 				pattern_z = std::min<int>(1, sprite->pattern_z - 1);
@@ -1369,8 +1499,8 @@ void MapDrawer::BlitCreature(int screenx, int screeny, const Outfit& outfit, Dir
 
 			for(int cx = 0; cx != sprite->width; ++cx) {
 				for(int cy = 0; cy != sprite->height; ++cy) {
-					int texnum = sprite->getHardwareID(cx, cy, (int)dir, pattern_y, pattern_z, outfit, frame);
-					glBlitTexture(screenx - cx * rme::TileSize, screeny - cy * rme::TileSize, texnum, red, green, blue, alpha);
+					const AtlasRegion* texture = sprite->getAtlasRegion(cx, cy, (int)dir, pattern_y, pattern_z, outfit, frame);
+					glBlitTexture(screenx - cx * rme::TileSize, screeny - cy * rme::TileSize, texture, red, green, blue, alpha);
 				}
 			}
 		}
@@ -1501,6 +1631,7 @@ void MapDrawer::DrawTile(TileLocation* location)
 		}
 
 		if(only_colors) {
+			sprite_batch.flush();
 			glDisable(GL_TEXTURE_2D);
 			if(options.show_as_minimap) {
 				wxColor color = colorFromEightBit(tile->getMiniMapColor());
@@ -1603,6 +1734,7 @@ void MapDrawer::DrawBrushIndicator(int x, int y, Brush* brush, uint8_t r, uint8_
 
 void MapDrawer::DrawHookIndicator(int x, int y, const ItemType& type)
 {
+	sprite_batch.flush();
 	glDisable(GL_TEXTURE_2D);
 	glColor4ub(uint8_t(0), uint8_t(0), uint8_t(255), uint8_t(200));
 	glBegin(GL_QUADS);
@@ -1679,8 +1811,8 @@ void MapDrawer::DrawIndicator(int x, int y, int indicator, uint8_t r, uint8_t g,
 	if(sprite == nullptr)
 		return;
 
-	int textureId = sprite->getHardwareID(0,0,0,-1,0,0,0,0);
-	glBlitTexture(x, y, textureId, r, g, b, a, true);
+	const AtlasRegion* texture = sprite->getAtlasRegion(0,0,0,-1,0,0,0,0);
+	glBlitTexture(x, y, texture, r, g, b, a, true);
 }
 
 void MapDrawer::DrawPositionIndicator(int z)
@@ -1888,17 +2020,13 @@ void MapDrawer::ShowPositionIndicator(const Position& position)
 	pos_indicator_timer.Start();
 }
 
-void MapDrawer::glBlitTexture(int x, int y, int textureId, int red, int green, int blue, int alpha, bool adjustZoom)
+void MapDrawer::glBlitTexture(int x, int y, const AtlasRegion* texture, int red, int green, int blue, int alpha, bool adjustZoom)
 {
-	if(textureId <= 0)
+	if(!texture)
 		return;
 
-	glBindTexture(GL_TEXTURE_2D, textureId);
-	glColor4ub(uint8_t(red), uint8_t(green), uint8_t(blue), uint8_t(alpha));
-	glBegin(GL_QUADS);
-
+	float size = rme::TileSize;
 	if(adjustZoom) {
-		float size = rme::TileSize;
 		if(zoom < 1.0f) {
 			float offset = 10 / (10 * zoom);
 			size = std::max<float>(16, rme::TileSize * zoom);
@@ -1910,18 +2038,9 @@ void MapDrawer::glBlitTexture(int x, int y, int textureId, int red, int green, i
 			x -= offset;
 			y -= offset;
 		}
-		glTexCoord2f(0.f, 0.f); glVertex2f(x, y);
-		glTexCoord2f(1.f, 0.f); glVertex2f(x + size, y);
-		glTexCoord2f(1.f, 1.f); glVertex2f(x + size, y + size);
-		glTexCoord2f(0.f, 1.f); glVertex2f(x, y + size);
-	} else {
-		glTexCoord2f(0.f, 0.f); glVertex2f(x, y);
-		glTexCoord2f(1.f, 0.f); glVertex2f(x + rme::TileSize, y);
-		glTexCoord2f(1.f, 1.f); glVertex2f(x + rme::TileSize, y + rme::TileSize);
-		glTexCoord2f(0.f, 1.f); glVertex2f(x, y + rme::TileSize);
 	}
 
-	glEnd();
+	sprite_batch.add(*texture, x, y, size, uint8_t(red), uint8_t(green), uint8_t(blue), uint8_t(alpha));
 }
 
 void MapDrawer::glBlitSquare(int x, int y, int red, int green, int blue, int alpha)
@@ -18,7 +18,12 @@
 #ifndef RME_MAP_DRAWER_H_
 #define RME_MAP_DRAWER_H_
 
+#include "sprite_batch.h"
+
+#include <unordered_map>
+
 class GameSprite;
+struct AtlasRegion;
 
 struct MapTooltip
 {
@@ -88,6 +93,7 @@ public:
 
 class MapCanvas;
 class LightDrawer;
+class QTreeNode;
 
 class MapDrawer
 {
@@ -95,6 +101,7 @@ class MapDrawer
 	Editor& editor;
 	DrawingOptions options;
 	std::shared_ptr<LightDrawer> light_drawer;
+	SpriteBatch sprite_batch;
 
 	float zoom;
 
@@ -108,6 +115,21 @@ class MapDrawer
 	int tile_size;
 	int floor;
 
+	// The quads of every 4x4 node drawn lately, in map coordinates. A node
+	// that did not change since is queued again instead of walking its tiles.
+	struct CachedNode {
+		CachedNode() : revision(0), atlas_generation(0), last_frame(0), valid(false) { }
+
+		SpriteBatch::Recording recording;
+		uint32_t revision;
+		uint32_t atlas_generation;
+		uint32_t last_frame;
+		bool valid;
+	};
+	std::unordered_map<uint64_t, CachedNode> node_cache;
+	uint64_t node_cache_options;
+	uint32_t frame;
+
 protected:
 	std::vector<MapTooltip*> tooltips;
 	std::ostringstream tooltip;
@@ -183,7 +205,7 @@ protected:
 	};
 
 	void getColor(Brush* brush, const Position& position, uint8_t &r, uint8_t &g, uint8_t &b);
-	void glBlitTexture(int x, int y, int textureId, int red, int green, int blue, int alpha, bool adjustZoom = false);
+	void glBlitTexture(int x, int y, const AtlasRegion* texture, int red, int green, int blue, int alpha, bool adjustZoom = false);
 	void glBlitSquare(int x, int y, int red, int green, int blue, int alpha);
 	void glBlitSquare(int x, int y, const wxColor& color);
 	void glColor(const wxColor& color);
@@ -194,6 +216,11 @@ protected:
 
 private:
 	void getDrawPosition(const Position& position, int &x, int &y);
+
+	// Every option DrawTile looks at, cached nodes are dropped when it changes
+	uint64_t getNodeCacheOptions() const;
+	uint32_t getNodeRevision(QTreeNode* node, int z) const;
+	void trimNodeCache();
 };
 
 #endif
@@ -22,11 +22,14 @@
 #include "position.h"
 #include "tile.h"
 
+#include <atomic>
+
 //**************** Tile Location **********************
 
 TileLocation::TileLocation() :
 	tile(nullptr),
 	position(0, 0, 0),
+	revision(nextRevision()),
 	spawn_count(0),
 	waypoint_count(0),
 	house_exits(nullptr)
@@ -34,6 +37,20 @@ TileLocation::TileLocation() :
 	////
 }
 
+namespace {
+	std::atomic<uint32_t> revision_counter(0);
+}
+
+uint32_t TileLocation::nextRevision() noexcept
+{
+	return ++revision_counter;
+}
+
+uint32_t TileLocation::lastRevision() noexcept
+{
+	return revision_counter;
+}
+
 TileLocation::~TileLocation()
 {
 	delete tile;
@@ -78,6 +95,7 @@ Floor::Floor(int sx, int sy, int z)
 QTreeNode::QTreeNode(BaseMap& map) :
 	map(map),
 	visible(0),
+	clientVisible(),
 	isLeaf(false)
 {
 	// Doesn't matter if we're leaf or node
@@ -171,23 +189,25 @@ bool QTreeNode::isRequested(bool underground)
 	}
 }
 
-void QTreeNode::clearVisible(uint32_t u)
+void QTreeNode::clearVisible(uint32_t client)
 {
-	if(isLeaf)
-		visible &= u;
-	else
+	if(isLeaf) {
+		setVisible(client, false, false);
+		setVisible(client, true, false);
+	} else {
 		for(int i = 0; i < rme::MapLayers; ++i)
 			if(child[i])
-				child[i]->clearVisible(u);
+				child[i]->clearVisible(client);
+	}
 }
 
 bool QTreeNode::isVisible(uint32_t client, bool underground)
 {
-	if(underground) {
-		return testFlags(visible >> rme::MapLayers, static_cast<uint64_t>(1) << client);
-	} else {
-		return testFlags(visible, static_cast<uint64_t>(1) << client);
+	// 0 is a peer that hasn't finished its handshake
+	if(client == 0 || client > static_cast<uint32_t>(rme::MaxLiveClients)) {
+		return false;
 	}
+	return (clientVisible[underground] & (static_cast<uint64_t>(1) << (client - 1))) != 0;
 }
 
 void QTreeNode::setVisible(bool underground, bool value)
@@ -215,10 +235,14 @@ void QTreeNode::setRequested(bool underground, bool r)
 
 void QTreeNode::setVisible(uint32_t client, bool underground, bool value)
 {
+	if(client == 0 || client > static_cast<uint32_t>(rme::MaxLiveClients)) {
+		return;
+	}
+	const uint64_t bit = static_cast<uint64_t>(1) << (client - 1);
 	if(value)
-		visible |= (1 << client << (underground ? rme::MapLayers : 0));
+		clientVisible[underground] |= bit;
 	else
-		visible &= ~(1 << client << (underground ? rme::MapLayers : 0));
+		clientVisible[underground] &= ~bit;
 }
 
 TileLocation* QTreeNode::getTile(int x, int y, int z)
@@ -248,6 +272,7 @@ Tile* QTreeNode::setTile(int x, int y, int z, Tile* newtile)
 	TileLocation* tmp = &f->locs[offset_x*4+offset_y];
 	Tile* oldtile = tmp->tile;
 	tmp->tile = newtile;
+	tmp->markChanged();
 
 	if(newtile && !oldtile)
 		++map.tilecount;
@@ -268,4 +293,5 @@ void QTreeNode::clearTile(int x, int y, int z)
 	TileLocation* tmp = &f->locs[offset_x*4+offset_y];
 	delete tmp->tile;
 	tmp->tile = map.allocator(tmp);
+	tmp->markChanged();
 }
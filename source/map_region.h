@@ -20,6 +20,7 @@
 
 #include "const.h"
 #include "position.h"
+#include "memory_pool.h"
 
 class Tile;
 class Floor;
@@ -37,6 +38,7 @@ public:
 protected:
 	Tile* tile;
 	Position position;
+	uint32_t revision;
 	size_t spawn_count;
 	size_t waypoint_count;
 	HouseExitList* house_exits; // Any house exits pointing here
@@ -56,9 +58,17 @@ public:
 	int getY() const noexcept { return position.y; }
 	int getZ() const noexcept { return position.z; }
 
+	// Changes whenever anything drawn from this location changes. Revisions
+	// come from one counter shared by all maps, so they only ever go up.
+	uint32_t getRevision() const noexcept { return revision; }
+	void markChanged() noexcept { revision = nextRevision(); }
+	static uint32_t nextRevision() noexcept;
+	// The newest revision handed out, nothing changed as long as it stays the same
+	static uint32_t lastRevision() noexcept;
+
 	size_t getSpawnCount() const noexcept { return spawn_count; }
-	void increaseSpawnCount() noexcept { spawn_count++; }
-	void decreaseSpawnCount() noexcept { spawn_count--; }
+	void increaseSpawnCount() noexcept { spawn_count++; markChanged(); }
+	void decreaseSpawnCount() noexcept { spawn_count--; markChanged(); }
 	size_t getWaypointCount() const noexcept { return waypoint_count; }
 	void increaseWaypointCount() noexcept { waypoint_count++; }
 	void decreaseWaypointCount() noexcept { waypoint_count--; }
@@ -73,6 +83,8 @@ public:
 class Floor
 {
 public:
+	POOLED_ALLOCATION
+
 	Floor(int x, int y, int z);
 	TileLocation locs[rme::MapLayers];
 };
@@ -81,6 +93,8 @@ public:
 class QTreeNode
 {
 public:
+	POOLED_ALLOCATION
+
 	QTreeNode(BaseMap& map);
 	virtual ~QTreeNode();
 
@@ -108,7 +122,7 @@ public:
 	void setVisible(bool overground, bool underground);
 	void setVisible(uint32_t client, bool underground, bool value);
 	bool isVisible(uint32_t client, bool underground);
-	void clearVisible(uint32_t client);
+	void clearVisible(uint32_t client); // On every node below this one
 
 	void setRequested(bool underground, bool r);
 	bool isVisible(bool underground);
@@ -117,6 +131,7 @@ public:
 protected:
 	BaseMap& map;
 	uint32_t visible;
+	uint64_t clientVisible[2]; // Live server only, bit n - 1 for client n, overground and underground
 
 	bool isLeaf;
 
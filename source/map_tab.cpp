@@ -58,6 +58,8 @@ MapTab::~MapTab()
 	if(iref->owner_count <= 0) {
 		delete iref->editor;
 		delete iref;
+		// The map's tiles and items are gone, hand their slabs back to the system
+		PooledMemory::releaseAll();
 	}
 }
 
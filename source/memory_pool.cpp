@@ -0,0 +1,389 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "memory_pool.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#ifdef __WINDOWS__
+#	include <malloc.h>
+#endif
+
+struct MemoryPool::Slab
+{
+	MemoryPool* pool;
+	Slab* prev;
+	Slab* next;
+	void* free_list; // Blocks that were handed out and given back
+	size_t used; // Blocks currently handed out
+	size_t carved; // Blocks ever handed out, the rest of the slab is untouched
+};
+
+namespace {
+	// Blocks start after the slab header, aligned for anything a class might hold
+	const size_t SlabHeaderSize = 64;
+
+	void* allocateAligned(size_t size)
+	{
+#ifdef __WINDOWS__
+		return _aligned_malloc(size, size);
+#else
+		void* ptr = nullptr;
+		if(posix_memalign(&ptr, size, size) != 0)
+			return nullptr;
+		return ptr;
+#endif
+	}
+
+	void freeAligned(void* ptr)
+	{
+#ifdef __WINDOWS__
+		_aligned_free(ptr);
+#else
+		free(ptr);
+#endif
+	}
+}
+
+MemoryPool::MemoryPool(size_t block_size) :
+	block_size(block_size),
+	blocks_per_slab((SlabSize - SlabHeaderSize) / block_size),
+	batch_size(std::max<size_t>(4, std::min<size_t>(64, 8192 / block_size))),
+	partial(nullptr),
+	spare(nullptr),
+	live_blocks(0),
+	slab_count(0)
+{
+	static_assert(sizeof(Slab) <= SlabHeaderSize, "slab header does not fit");
+	ASSERT(block_size >= sizeof(void*));
+	ASSERT(blocks_per_slab > 0);
+}
+
+MemoryPool::~MemoryPool()
+{
+	// Blocks still in use keep their slabs, they are never touched again
+	if(spare) {
+		destroySlab(spare);
+	}
+}
+
+MemoryPool::Slab* MemoryPool::createSlab()
+{
+	Slab* slab = reinterpret_cast<Slab*>(allocateAligned(SlabSize));
+	if(!slab) {
+		return nullptr;
+	}
+
+	slab->pool = this;
+	slab->prev = nullptr;
+	slab->next = nullptr;
+	slab->free_list = nullptr;
+	slab->used = 0;
+	slab->carved = 0;
+	++slab_count;
+	return slab;
+}
+
+void MemoryPool::destroySlab(Slab* slab)
+{
+	freeAligned(slab);
+	--slab_count;
+}
+
+void MemoryPool::link(Slab* slab)
+{
+	slab->prev = nullptr;
+	slab->next = partial;
+	if(partial) {
+		partial->prev = slab;
+	}
+	partial = slab;
+}
+
+void MemoryPool::unlink(Slab* slab)
+{
+	if(slab->prev) {
+		slab->prev->next = slab->next;
+	} else {
+		partial = slab->next;
+	}
+	if(slab->next) {
+		slab->next->prev = slab->prev;
+	}
+	slab->prev = slab->next = nullptr;
+}
+
+MemoryPool::Slab* MemoryPool::getSlab(void* block)
+{
+	return reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(block) & ~static_cast<uintptr_t>(SlabSize - 1));
+}
+
+void* MemoryPool::take()
+{
+	Slab* slab = partial;
+	if(!slab) {
+		if(spare) {
+			slab = spare;
+			spare = nullptr;
+		} else {
+			slab = createSlab();
+			if(!slab) {
+				throw std::bad_alloc();
+			}
+		}
+		link(slab);
+	}
+
+	void* block;
+	if(slab->free_list) {
+		block = slab->free_list;
+		slab->free_list = *reinterpret_cast<void**>(block);
+	} else {
+		block = reinterpret_cast<uint8_t*>(slab) + SlabHeaderSize + slab->carved * block_size;
+		++slab->carved;
+	}
+
+	++slab->used;
+	++live_blocks;
+	if(slab->used == blocks_per_slab) {
+		unlink(slab);
+	}
+	return block;
+}
+
+void MemoryPool::give(Slab* slab, void* block)
+{
+	if(slab->used == blocks_per_slab) {
+		// Was full, so it wasn't in the list
+		link(slab);
+	}
+
+	*reinterpret_cast<void**>(block) = slab->free_list;
+	slab->free_list = block;
+	--slab->used;
+	--live_blocks;
+
+	if(slab->used == 0) {
+		unlink(slab);
+		if(spare) {
+			destroySlab(slab);
+		} else {
+			slab->free_list = nullptr;
+			slab->carved = 0;
+			spare = slab;
+		}
+	}
+}
+
+void* MemoryPool::allocate()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return take();
+}
+
+void MemoryPool::deallocate(void* ptr)
+{
+	if(!ptr) {
+		return;
+	}
+
+	Slab* slab = getSlab(ptr);
+	MemoryPool* pool = slab->pool;
+
+	std::lock_guard<std::mutex> guard(pool->lock);
+	pool->give(slab, ptr);
+}
+
+void* MemoryPool::allocateBatch(size_t count)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	void* chain = nullptr;
+	while(count-- > 0) {
+		void* block = take();
+		*reinterpret_cast<void**>(block) = chain;
+		chain = block;
+	}
+	return chain;
+}
+
+void MemoryPool::deallocateBatch(void* chain)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	while(chain) {
+		void* block = chain;
+		chain = *reinterpret_cast<void**>(block);
+		Slab* slab = getSlab(block);
+		ASSERT(slab->pool == this);
+		give(slab, block);
+	}
+}
+
+void MemoryPool::releaseSpare()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	if(spare) {
+		destroySlab(spare);
+		spare = nullptr;
+	}
+}
+
+MemoryPool::Statistics MemoryPool::getStatistics() const
+{
+	std::lock_guard<std::mutex> guard(lock);
+	Statistics statistics;
+	statistics.block_size = block_size;
+	statistics.live_blocks = live_blocks;
+	statistics.slabs = slab_count;
+	return statistics;
+}
+
+namespace {
+	const size_t SizeClassCount = PooledMemory::MaxSize / PooledMemory::Granularity;
+
+	// Never destroyed, objects may still be freed while static objects are torn down
+	MemoryPool** getPools()
+	{
+		static MemoryPool** pools = []() {
+			MemoryPool** pools = newd MemoryPool*[SizeClassCount];
+			for(size_t i = 0; i < SizeClassCount; ++i) {
+				pools[i] = newd MemoryPool((i + 1) * PooledMemory::Granularity);
+			}
+			return pools;
+		}();
+		return pools;
+	}
+
+	// The free blocks a thread holds on to, per size class. Plain data, so
+	// it stays usable while the rest of the thread's locals are destroyed.
+	struct ThreadCache {
+		void* blocks;
+		size_t count;
+	};
+	thread_local ThreadCache thread_caches[SizeClassCount];
+	thread_local bool thread_exiting = false;
+
+	void flushThreadCaches()
+	{
+		MemoryPool** pools = getPools();
+		for(size_t i = 0; i < SizeClassCount; ++i) {
+			ThreadCache& cache = thread_caches[i];
+			if(cache.blocks) {
+				pools[i]->deallocateBatch(cache.blocks);
+				cache.blocks = nullptr;
+				cache.count = 0;
+			}
+		}
+	}
+
+	// Gives the cached blocks back to the pools when the thread ends, any
+	// block freed after that goes straight to its pool
+	struct ThreadCacheOwner {
+		~ThreadCacheOwner() {
+			flushThreadCaches();
+			thread_exiting = true;
+		}
+	};
+	thread_local ThreadCacheOwner thread_cache_owner;
+}
+
+void* PooledMemory::allocate(size_t size)
+{
+	if(size == 0 || size > MaxSize) {
+		return ::operator new(size);
+	}
+
+	const size_t index = (size - 1) / Granularity;
+	MemoryPool* pool = getPools()[index];
+	if(thread_exiting) {
+		return pool->allocate();
+	}
+
+	ThreadCache& cache = thread_caches[index];
+	if(!cache.blocks) {
+		(void)&thread_cache_owner; // Constructs it, so the cache is flushed on exit
+		cache.blocks = pool->allocateBatch(pool->getBatchSize());
+		cache.count = pool->getBatchSize();
+	}
+
+	void* block = cache.blocks;
+	cache.blocks = *reinterpret_cast<void**>(block);
+	--cache.count;
+	return block;
+}
+
+void PooledMemory::deallocate(void* ptr, size_t size)
+{
+	if(size == 0 || size > MaxSize) {
+		::operator delete(ptr);
+		return;
+	}
+
+	if(!ptr) {
+		return;
+	}
+
+	if(thread_exiting) {
+		MemoryPool::deallocate(ptr);
+		return;
+	}
+
+	const size_t index = (size - 1) / Granularity;
+	ThreadCache& cache = thread_caches[index];
+	(void)&thread_cache_owner;
+	*reinterpret_cast<void**>(ptr) = cache.blocks;
+	cache.blocks = ptr;
+
+	// Keep the batch freed last, it is the most likely to be in the CPU cache
+	MemoryPool* pool = getPools()[index];
+	const size_t batch_size = pool->getBatchSize();
+	if(++cache.count >= batch_size * 2) {
+		void* last = cache.blocks;
+		for(size_t i = 1; i < batch_size; ++i) {
+			last = *reinterpret_cast<void**>(last);
+		}
+		void* rest = *reinterpret_cast<void**>(last);
+		*reinterpret_cast<void**>(last) = nullptr;
+		cache.count = batch_size;
+		pool->deallocateBatch(rest);
+	}
+}
+
+void PooledMemory::releaseAll()
+{
+	flushThreadCaches();
+	MemoryPool** pools = getPools();
+	for(size_t i = 0; i < SizeClassCount; ++i) {
+		pools[i]->releaseSpare();
+	}
+}
+
+std::vector<MemoryPool::Statistics> PooledMemory::getStatistics()
+{
+	std::vector<MemoryPool::Statistics> statistics;
+	MemoryPool** pools = getPools();
+	for(size_t i = 0; i < SizeClassCount; ++i) {
+		MemoryPool::Statistics pool_statistics = pools[i]->getStatistics();
+		if(pool_statistics.slabs > 0 || pool_statistics.live_blocks > 0) {
+			statistics.push_back(pool_statistics);
+		}
+	}
+	return statistics;
+}
@@ -0,0 +1,120 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_MEMORY_POOL_H_
+#define RME_MEMORY_POOL_H_
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Hands out fixed size blocks carved from large aligned slabs, without any
+// per block header. Every slab knows which pool it belongs to, so a block can
+// be freed from its address alone. A slab goes back to the system as soon as
+// its last block is freed (one spare is kept), so closing a map returns its
+// memory in whole slabs instead of leaving a fragmented heap behind.
+// Blocks move in and out of the pool in batches, chained through their first
+// word, so the threads in front of it only take the lock once per batch.
+class MemoryPool
+{
+public:
+	static const size_t SlabSize = 64 * 1024;
+
+	explicit MemoryPool(size_t block_size);
+	~MemoryPool();
+
+	MemoryPool(const MemoryPool&) = delete;
+	MemoryPool& operator=(const MemoryPool&) = delete;
+
+	void* allocate();
+	static void deallocate(void* ptr);
+
+	// Returns a chain of count blocks
+	void* allocateBatch(size_t count);
+	// Gives back a chain of blocks, all from this pool
+	void deallocateBatch(void* chain);
+	// How many blocks a thread should take or give back at once
+	size_t getBatchSize() const { return batch_size; }
+	// Frees the spare slab
+	void releaseSpare();
+
+	struct Statistics {
+		size_t block_size;
+		size_t live_blocks; // Including the ones waiting in thread caches
+		size_t slabs;
+	};
+	Statistics getStatistics() const;
+
+private:
+	struct Slab;
+
+	static Slab* getSlab(void* block);
+	void* take(); // The lock must be held
+	void give(Slab* slab, void* block); // Likewise
+	Slab* createSlab();
+	void destroySlab(Slab* slab);
+	void link(Slab* slab);
+	void unlink(Slab* slab);
+
+	mutable std::mutex lock;
+	size_t block_size;
+	size_t blocks_per_slab;
+	size_t batch_size;
+	Slab* partial; // Slabs with at least one free block
+	Slab* spare; // An empty slab kept to avoid thrashing
+	size_t live_blocks;
+	size_t slab_count;
+};
+
+// Size classed pools shared by all the objects a map is built from
+// (tiles, floors, tree nodes and items), see POOLED_ALLOCATION.
+// Every thread keeps a small cache of free blocks per size class in front of
+// them, so the loader and the other map workers don't queue up on the pools.
+namespace PooledMemory
+{
+	const size_t Granularity = 16;
+	const size_t MaxSize = 1024; // Anything larger goes to the regular heap
+
+	void* allocate(size_t size);
+	void deallocate(void* ptr, size_t size);
+
+	// Hands the blocks cached by this thread back to the pools, and frees
+	// every slab that is left empty. Threads flush their caches on exit, so
+	// call it on the main thread once a map has been closed.
+	void releaseAll();
+
+	// One entry per size class that has ever been used
+	std::vector<MemoryPool::Statistics> getStatistics();
+}
+
+// Put in a class declaration to allocate it (and anything derived from it)
+// from the pools. Classes with subclasses must have a virtual destructor so
+// the size passed to delete is the one of the real object.
+#ifdef DEBUG_MEM
+// Leave everything to the debug heap, so leaks are still reported per object
+#	define POOLED_ALLOCATION \
+	static void* operator new(size_t size) { return ::operator new(size); } \
+	static void* operator new(size_t size, const char* file, int line) { return ::operator new(size, file, line); } \
+	static void operator delete(void* ptr) { ::operator delete(ptr); } \
+	static void operator delete(void* ptr, const char*, int) { ::operator delete(ptr); }
+#else
+#	define POOLED_ALLOCATION \
+	static void* operator new(size_t size) { return PooledMemory::allocate(size); } \
+	static void operator delete(void* ptr, size_t size) { PooledMemory::deallocate(ptr, size); }
+#endif
+
+#endif
@@ -37,18 +37,21 @@ END_EVENT_TABLE()
 
 MinimapWindow::MinimapWindow(wxWindow* parent) :
 	wxPanel(parent, wxID_ANY, wxDefaultPosition, wxSize(205, 130)),
+	cached_map(nullptr),
+	paint_count(0),
 	update_timer(this)
 {
 	for(int i = 0; i < 256; ++i) {
-		pens[i] = new wxPen(colorFromEightBit(i));
+		wxColor color = colorFromEightBit(i);
+		palette[i][0] = color.Red();
+		palette[i][1] = color.Green();
+		palette[i][2] = color.Blue();
 	}
 }
 
 MinimapWindow::~MinimapWindow()
 {
-	for(int i = 0; i < 256; ++i) {
-		delete pens[i];
-	}
+	////
 }
 
 void MinimapWindow::OnSize(wxSizeEvent& event)
@@ -82,7 +85,7 @@ void MinimapWindow::OnPaint(wxPaintEvent& event)
 
 	if(!g_gui.IsEditorOpen()) return;
 	Editor& editor = *g_gui.GetCurrentEditor();
-	const Map& map = editor.getMap();
+	Map& map = editor.getMap();
 
 	int window_width = GetSize().GetWidth();
 	int window_height = GetSize().GetHeight();
@@ -125,24 +128,23 @@ void MinimapWindow::OnPaint(wxPaintEvent& event)
 
 	int floor = g_gui.GetCurrentFloor();
 
+	if(&map != cached_map) {
+		blocks.clear();
+		cached_map = &map;
+	}
+
 	//printf("Draw from %d:%d to %d:%d\n", start_x, start_y, end_x, end_y);
-	uint8_t last = 0;
 	if(g_gui.IsRenderingEnabled()) {
-		for(int y = start_y, window_y = 0; y <= end_y; ++y, ++window_y) {
-			for(int x = start_x, window_x = 0; x <= end_x; ++x, ++window_x) {
-				const Tile* tile = map.getTile(x, y, floor);
-				if(tile) {
-					uint8_t color = tile->getMiniMapColor();
-					if(color) {
-						if(last != color) {
-							pdc.SetPen(*pens[color]);
-							last = color;
-						}
-						pdc.DrawPoint(window_x, window_y);
-					}
+		++paint_count;
+		for(int block_y = start_y / BlockSize; block_y <= end_y / BlockSize; ++block_y) {
+			for(int block_x = start_x / BlockSize; block_x <= end_x / BlockSize; ++block_x) {
+				const CachedBlock& block = getBlock(map, block_x, block_y, floor);
+				if(block.bitmap.IsOk()) {
+					pdc.DrawBitmap(block.bitmap, block_x * BlockSize - start_x, block_y * BlockSize - start_y);
 				}
 			}
 		}
+		trimBlocks();
 
 		if(g_settings.getInteger(Config::MINIMAP_VIEW_BOX)) {
 			pdc.SetPen(*wxWHITE_PEN);
@@ -180,6 +182,96 @@ void MinimapWindow::OnPaint(wxPaintEvent& event)
 	}
 }
 
+const MinimapWindow::CachedBlock& MinimapWindow::getBlock(Map& map, int block_x, int block_y, int floor)
+{
+	uint64_t key = (uint64_t(block_x) << 32) | (uint64_t(block_y) << 8) | uint64_t(floor);
+	CachedBlock& block = blocks[key];
+	block.last_paint = paint_count;
+
+	// Nothing on any map changed since the block was last checked
+	const uint32_t last_revision = TileLocation::lastRevision();
+	if(block.checked == last_revision) {
+		return block;
+	}
+	block.checked = last_revision;
+
+	const uint32_t revision = getBlockRevision(map, block_x, block_y, floor);
+	if(revision != block.revision || block.revision == 0) {
+		drawBlock(map, block, block_x, block_y, floor);
+		block.revision = revision;
+	}
+	return block;
+}
+
+uint32_t MinimapWindow::getBlockRevision(Map& map, int block_x, int block_y, int floor) const
+{
+	// Revisions only go up, so the newest one tells whether anything changed
+	uint32_t revision = map.getRevision();
+	for(int y = block_y * BlockSize; y < (block_y + 1) * BlockSize; y += 4) {
+		for(int x = block_x * BlockSize; x < (block_x + 1) * BlockSize; x += 4) {
+			QTreeNode* node = map.getLeaf(x, y);
+			Floor* nodeFloor = node ? node->getFloor(floor) : nullptr;
+			if(!nodeFloor) {
+				continue;
+			}
+			for(int i = 0; i < 16; ++i) {
+				revision = std::max(revision, nodeFloor->locs[i].getRevision());
+			}
+		}
+	}
+	return revision;
+}
+
+void MinimapWindow::drawBlock(Map& map, CachedBlock& block, int block_x, int block_y, int floor)
+{
+	wxImage image(BlockSize, BlockSize); // Starts out black
+	unsigned char* data = image.GetData();
+	bool empty = true;
+
+	for(int y = block_y * BlockSize; y < (block_y + 1) * BlockSize; y += 4) {
+		for(int x = block_x * BlockSize; x < (block_x + 1) * BlockSize; x += 4) {
+			QTreeNode* node = map.getLeaf(x, y);
+			Floor* nodeFloor = node ? node->getFloor(floor) : nullptr;
+			if(!nodeFloor) {
+				continue;
+			}
+			for(int i = 0; i < 16; ++i) {
+				const Tile* tile = nodeFloor->locs[i].get();
+				uint8_t color = tile ? tile->getMiniMapColor() : 0;
+				if(color) {
+					// Locations of a leaf are stored column by column
+					const int image_x = (x & (BlockSize - 1)) + i / 4;
+					const int image_y = (y & (BlockSize - 1)) + i % 4;
+					unsigned char* pixel = data + (image_y * BlockSize + image_x) * 3;
+					pixel[0] = palette[color][0];
+					pixel[1] = palette[color][1];
+					pixel[2] = palette[color][2];
+					empty = false;
+				}
+			}
+		}
+	}
+
+	block.bitmap = empty ? wxBitmap() : wxBitmap(image);
+}
+
+void MinimapWindow::trimBlocks()
+{
+	// Forget blocks that have been off screen for a while
+	const uint32_t max_age = 256;
+	if(paint_count % max_age != 0) {
+		return;
+	}
+
+	for(auto it = blocks.begin(); it != blocks.end();) {
+		if(paint_count - it->second.last_paint > max_age) {
+			it = blocks.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
 void MinimapWindow::OnMouseClick(wxMouseEvent& event)
 {
 	if(!g_gui.IsEditorOpen()) return;
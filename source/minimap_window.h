@@ -18,6 +18,10 @@
 #ifndef RME_MINIMAP_WINDOW_H_
 #define RME_MINIMAP_WINDOW_H_
 
+#include <unordered_map>
+
+class Map;
+
 class MinimapWindow : public wxPanel {
 public:
 	MinimapWindow(wxWindow* parent);
@@ -33,7 +37,26 @@ public:
 	void OnDelayedUpdate(wxTimerEvent& event);
 	void OnKey(wxKeyEvent& event);
 protected:
-	wxPen* pens[256];
+	// The minimap is drawn in blocks of BlockSize x BlockSize tiles. A block
+	// is only drawn again when one of its tiles got a newer revision (see
+	// TileLocation), otherwise its bitmap is just blitted.
+	static const int BlockSize = 64;
+	struct CachedBlock {
+		uint32_t revision = 0; // Newest revision of the tiles it was drawn from
+		uint32_t checked = 0; // TileLocation::lastRevision() when that was last checked
+		uint32_t last_paint = 0;
+		wxBitmap bitmap; // Not ok if there was nothing to draw
+	};
+	const CachedBlock& getBlock(Map& map, int block_x, int block_y, int floor);
+	uint32_t getBlockRevision(Map& map, int block_x, int block_y, int floor) const;
+	void drawBlock(Map& map, CachedBlock& block, int block_x, int block_y, int floor);
+	void trimBlocks();
+
+	uint8_t palette[256][3];
+	std::unordered_map<uint64_t, CachedBlock> blocks;
+	const Map* cached_map;
+	uint32_t paint_count;
+
 	wxTimer	update_timer;
 	int last_start_x;
 	int last_start_y;
@@ -21,7 +21,7 @@ static inline unsigned long int mt_get (void *vstate);
 static double mt_get_double (void *vstate);
 static void mt_set (void *state, unsigned long int s);
 
-#define N 624   /* Period parameters */
+static const int N = mt_state_t::N;
 #define M 397
 
 /* most significant w-r bits */
@@ -30,13 +30,6 @@ static const unsigned long UPPER_MASK = 0x80000000UL;
 /* least significant r bits */
 static const unsigned long LOWER_MASK = 0x7fffffffUL;
 
-typedef struct
-  {
-    unsigned long mt[N];
-    int mti;
-  }
-mt_state_t;
-
 static inline unsigned long
 mt_get (void *vstate)
 {
@@ -127,3 +120,15 @@ unsigned long mt_randi() {
 double mt_randd() {
 	return mt_get_double(&mt_state);
 }
+
+MTRandom::MTRandom(unsigned long s) {
+	mt_set(&state, s);
+}
+
+unsigned long MTRandom::randi() {
+	return mt_get(&state);
+}
+
+double MTRandom::randd() {
+	return mt_get_double(&state);
+}
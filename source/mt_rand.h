@@ -22,4 +22,25 @@ void mt_seed(unsigned long s);
 unsigned long mt_randi();
 double mt_randd();
 
+struct mt_state_t
+{
+	static const int N = 624; // Period parameters
+	unsigned long mt[N];
+	int mti;
+};
+
+// A generator with a state of its own, for work that has to give the same
+// numbers every time (one per job, so threads never share one)
+class MTRandom
+{
+public:
+	explicit MTRandom(unsigned long s);
+
+	unsigned long randi();
+	double randd();
+
+private:
+	mt_state_t state;
+};
+
 #endif
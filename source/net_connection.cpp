@@ -18,6 +18,8 @@
 #include "main.h"
 #include "net_connection.h"
 
+#include <zlib.h>
+
 NetworkMessage::NetworkMessage()
 {
 	clear();
@@ -38,6 +40,69 @@ void NetworkMessage::expand(const size_t length)
 	size += length;
 }
 
+SharedMessageBuffer NetworkMessage::share()
+{
+	memcpy(&buffer[0], &size, 4);
+	buffer.resize(size + 4);
+	SharedMessageBuffer shared = std::make_shared<const std::vector<uint8_t>>(std::move(buffer));
+	buffer = std::vector<uint8_t>();
+	clear();
+	return shared;
+}
+
+bool NetworkMessage::decompress()
+{
+	// Anything claiming to be larger is broken, not a real packet
+	const uint32_t maxLength = 64 * 1024 * 1024;
+
+	if(buffer.size() < 8) {
+		return false;
+	}
+
+	uint32_t length;
+	memcpy(&length, &buffer[4], 4);
+	if(length == 0 || length > maxLength) {
+		return false;
+	}
+
+	std::vector<uint8_t> inflated(length + 4);
+	uLongf inflatedLength = length;
+	if(uncompress(&inflated[4], &inflatedLength, &buffer[8], buffer.size() - 8) != Z_OK || inflatedLength != length) {
+		return false;
+	}
+
+	buffer.swap(inflated);
+	position = 4;
+	return true;
+}
+
+const SharedMessageBuffer& SharedMessage::get(bool allowCompression)
+{
+	// Fast rather than small, packets are compressed while the user waits
+	const int compressionLevel = 3;
+
+	const size_t length = raw->size() - 4;
+	if(!allowCompression || length < NetworkMessage::CompressionThreshold) {
+		return raw;
+	}
+
+	if(!compressionTried) {
+		compressionTried = true;
+
+		uLongf compressedLength = compressBound(length);
+		std::vector<uint8_t> buffer(compressedLength + 8);
+		if(compress2(&buffer[8], &compressedLength, raw->data() + 4, length, compressionLevel) == Z_OK && compressedLength + 4 < length) {
+			const uint32_t header = static_cast<uint32_t>(compressedLength + 4) | NetworkMessage::CompressedFlag;
+			const uint32_t inflatedLength = static_cast<uint32_t>(length);
+			memcpy(&buffer[0], &header, 4);
+			memcpy(&buffer[4], &inflatedLength, 4);
+			buffer.resize(compressedLength + 8);
+			compressed = std::make_shared<const std::vector<uint8_t>>(std::move(buffer));
+		}
+	}
+	return compressed ? compressed : raw;
+}
+
 template<> std::string NetworkMessage::read<std::string>()
 {
 	const uint16_t length = read<uint16_t>();
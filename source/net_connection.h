@@ -22,16 +22,31 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 #include <cstdint>
 #include <thread>
 #include <mutex>
 
+// A message ready to be written, size header included. It is never changed
+// again, so any number of asynchronous writes can share it.
+typedef std::shared_ptr<const std::vector<uint8_t>> SharedMessageBuffer;
+
 struct NetworkMessage
 {
 	NetworkMessage();
 
 	void clear();
 	void expand(const size_t length);
+	// Moves the contents out, the message is empty afterwards
+	SharedMessageBuffer share();
+	// Inflates the compressed payload read after the header, in place
+	bool decompress();
+
+	// Packets with this bit set in the size header carry a zlib compressed
+	// payload, preceded by its size once inflated
+	static const uint32_t CompressedFlag = 0x80000000;
+	// Smaller packets are not worth compressing
+	static const size_t CompressionThreshold = 256;
 
 	//
 	template<typename T> T read()
@@ -54,6 +69,25 @@ struct NetworkMessage
 	size_t size;
 };
 
+// A finished message that may go out to several peers, compressed at most once
+class SharedMessage
+{
+	public:
+		SharedMessage() = default;
+		explicit SharedMessage(NetworkMessage& message) : raw(message.share()) {}
+
+		bool empty() const { return !raw; }
+		// Size of the message as it was written, header included
+		size_t getRawSize() const { return raw->size(); }
+		// The message to write, compressed if allowed and worth it
+		const SharedMessageBuffer& get(bool allowCompression);
+
+	private:
+		SharedMessageBuffer raw;
+		SharedMessageBuffer compressed;
+		bool compressionTried = false;
+};
+
 template<> std::string NetworkMessage::read<std::string>();
 template<> Position NetworkMessage::read<Position>();
 template<> void NetworkMessage::write<std::string>(const std::string& value);
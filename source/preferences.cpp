@@ -91,6 +91,21 @@ wxNotebookPage* PreferencesWindow::CreateGeneralPage()
 	only_one_instance_chkbox->SetToolTip("When checked, maps opened using the shell will all be opened in the same instance.");
 	sizer->Add(only_one_instance_chkbox, 0, wxLEFT | wxTOP, 5);
 
+	undo_journal_chkbox = newd wxCheckBox(general_page, wxID_ANY, "Keep old undo history on disk");
+	undo_journal_chkbox->SetValue(g_settings.getBoolean(Config::UNDO_JOURNAL));
+	undo_journal_chkbox->SetToolTip("When the undo queue goes over its memory size, the oldest actions are written to a temporary file instead of being lost.");
+	sizer->Add(undo_journal_chkbox, 0, wxLEFT | wxTOP, 5);
+
+	item_index_chkbox = newd wxCheckBox(general_page, wxID_ANY, "Index items for fast searches");
+	item_index_chkbox->SetValue(g_settings.getBoolean(Config::ITEM_INDEX));
+	item_index_chkbox->SetToolTip("Keeps track of where every item, action id and unique id is, so searching for them does not go through the whole map. Uses more memory on large maps, applies to maps opened afterwards.");
+	sizer->Add(item_index_chkbox, 0, wxLEFT | wxTOP, 5);
+
+	live_compression_chkbox = newd wxCheckBox(general_page, wxID_ANY, "Compress live mapping traffic");
+	live_compression_chkbox->SetValue(g_settings.getBoolean(Config::LIVE_COMPRESSION));
+	live_compression_chkbox->SetToolTip("Large live mapping packets are compressed when both sides allow it. Helps a lot on slow connections, costs a little processor time.");
+	sizer->Add(live_compression_chkbox, 0, wxLEFT | wxTOP, 5);
+
 	sizer->AddSpacer(10);
 
     auto * grid_sizer = newd wxFlexGridSizer(2, 10, 10);
@@ -590,6 +605,9 @@ void PreferencesWindow::Apply()
 	g_settings.setInteger(Config::ONLY_ONE_INSTANCE, only_one_instance_chkbox->GetValue());
 	g_settings.setInteger(Config::UNDO_SIZE, undo_size_spin->GetValue());
 	g_settings.setInteger(Config::UNDO_MEM_SIZE, undo_mem_size_spin->GetValue());
+	g_settings.setInteger(Config::UNDO_JOURNAL, undo_journal_chkbox->GetValue());
+	g_settings.setInteger(Config::ITEM_INDEX, item_index_chkbox->GetValue());
+	g_settings.setInteger(Config::LIVE_COMPRESSION, live_compression_chkbox->GetValue());
 	g_settings.setInteger(Config::WORKER_THREADS, worker_threads_spin->GetValue());
 	g_settings.setInteger(Config::REPLACE_SIZE, replace_size_spin->GetValue());
 	g_settings.setInteger(Config::COPY_POSITION_FORMAT, position_format->GetSelection());
@@ -50,6 +50,9 @@ protected:
 	wxCheckBox* update_check_on_startup_chkbox;
 	wxCheckBox* only_one_instance_chkbox;
 	wxCheckBox* show_welcome_dialog_chkbox;
+	wxCheckBox* undo_journal_chkbox;
+	wxCheckBox* item_index_chkbox;
+	wxCheckBox* live_compression_chkbox;
 	wxSpinCtrl* undo_size_spin;
 	wxSpinCtrl* undo_mem_size_spin;
 	wxSpinCtrl* worker_threads_spin;
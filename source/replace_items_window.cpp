@@ -22,6 +22,7 @@
 #include "gui.h"
 #include "artprovider.h"
 #include "items.h"
+#include "item_replacer.h"
 
 // ============================================================================
 // ReplaceItemsButton
@@ -338,38 +339,23 @@ void ReplaceItemsDialog::OnExecuteButtonClicked(wxCommandEvent& WXUNUSED(event))
 
 	Editor* editor = tab->GetEditor();
 
-	int done = 0;
+	ItemReplacer replacer((uint32_t)g_settings.getInteger(Config::REPLACE_SIZE));
 	for(const ReplacingItem& info : items) {
-		ItemFinder finder(info.replaceId, (uint32_t)g_settings.getInteger(Config::REPLACE_SIZE));
-
-		// search on map
-		foreach_ItemOnMap(editor->getMap(), finder, selectionOnly);
-
-		uint32_t total = 0;
-		const auto& result = finder.result;
-
-		if(!result.empty()) {
-			BatchAction* batch = editor->createBatch(ACTION_REPLACE_ITEMS);
-			Action* action = editor->createAction(batch);
-			for(const auto& pair : result) {
-				Tile* new_tile = pair.first->deepCopy(editor->getMap());
-				int index = pair.first->getIndexOf(pair.second);
-				ASSERT(index != wxNOT_FOUND);
-				Item* item = new_tile->getItemAt(index);
-				ASSERT(item && item->getID() == pair.second->getID());
-				transformItem(item, info.withId, new_tile);
-				action->addChange(new Change(new_tile));
-				total++;
-			}
-			batch->addAndCommitAction(action);
-			editor->addBatch(batch);
-			editor->updateActions();
-		}
+		replacer.addRule(info.replaceId, info.withId);
+	}
+
+	Action* action = replacer.execute(*editor, selectionOnly, g_settings.getInteger(Config::WORKER_THREADS));
+	if(action) {
+		BatchAction* batch = editor->createBatch(ACTION_REPLACE_ITEMS);
+		batch->addAndCommitAction(action);
+		editor->addBatch(batch);
+		editor->updateActions();
+	}
+
+	progress->SetValue(100);
 
-		done++;
-		const int value = static_cast<int>((done / items.size()) * 100);
-		progress->SetValue(std::clamp<int>(value, 0, 100));
-		list->MarkAsComplete(info, total);
+	for(size_t index = 0; index < items.size(); ++index) {
+		list->MarkAsComplete(items[index], replacer.getReplacedCount(index));
 	}
 
 	tab->Refresh();
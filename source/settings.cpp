@@ -230,6 +230,9 @@ void Settings::IO(IOMode mode)
 	Int(MERGE_PASTE, 0);
 	Int(UNDO_SIZE, 400);
 	Int(UNDO_MEM_SIZE, 40);
+	Int(UNDO_JOURNAL, 1);
+	Int(ITEM_INDEX, 1);
+	Int(LIVE_COMPRESSION, 1);
 	Int(GROUP_ACTIONS, 1);
 	Int(SELECTION_TYPE, SELECT_CURRENT_FLOOR);
 	Int(COMPENSATED_SELECT, 1);
@@ -260,6 +263,8 @@ void Settings::IO(IOMode mode)
 	Int(USE_OTBM_4_FOR_ALL_MAPS, 0);
 	Int(USE_OTGZ, 1);
 	Int(SAVE_WITH_OTB_MAGIC_NUMBER, 0);
+	Int(LOAD_WITH_MEMORY_MAPPING, 1);
+	Int(SAVE_INCREMENTALLY, 1);
 	Int(REPLACE_SIZE, 500);
 	Int(COPY_POSITION_FORMAT, 0);
 
@@ -268,6 +273,7 @@ void Settings::IO(IOMode mode)
 	Int(TEXTURE_CLEAN_PULSE, 15);
 	Int(TEXTURE_LONGEVITY, 20);
 	Int(TEXTURE_CLEAN_THRESHOLD, 2500);
+	Int(TEXTURE_ATLAS_BUDGET, 256);
 	Int(SOFTWARE_CLEAN_THRESHOLD, 1800);
 	Int(SOFTWARE_CLEAN_SIZE, 500);
 	Int(ICON_BACKGROUND, 0);
@@ -34,6 +34,7 @@ namespace Config {
 		TEXTURE_CLEAN_PULSE,
 		TEXTURE_CLEAN_THRESHOLD,
 		TEXTURE_LONGEVITY,
+		TEXTURE_ATLAS_BUDGET,
 		HARD_REFRESH_RATE,
 		USE_MEMCACHED_SPRITES,
 		USE_MEMCACHED_SPRITES_TO_SAVE,
@@ -68,6 +69,9 @@ namespace Config {
 		ZOOM_SPEED,
 		UNDO_SIZE,
 		UNDO_MEM_SIZE,
+		UNDO_JOURNAL,
+		ITEM_INDEX,
+		LIVE_COMPRESSION,
 		MERGE_PASTE,
 		SELECTION_TYPE,
 		COMPENSATED_SELECT,
@@ -88,6 +92,8 @@ namespace Config {
 		USE_OTBM_4_FOR_ALL_MAPS,
 		USE_OTGZ,
 		SAVE_WITH_OTB_MAGIC_NUMBER,
+		LOAD_WITH_MEMORY_MAPPING,
+		SAVE_INCREMENTALLY,
 		REPLACE_SIZE,
 
 		USE_LARGE_CONTAINER_ICONS,
@@ -58,6 +58,80 @@ void Spawns::removeSpawn(Tile* tile) {
 #endif
 }
 
+uint32_t SpawnGrid::getCell(int x, int y, int z) noexcept
+{
+	return static_cast<uint32_t>(x / CellSize) | (static_cast<uint32_t>(y / CellSize) << 11) | (static_cast<uint32_t>(z) << 22);
+}
+
+template <typename Function>
+void SpawnGrid::foreachCell(const Position& center, int radius, Function function)
+{
+	const int start_x = std::max(center.x - radius, 0) / CellSize;
+	const int start_y = std::max(center.y - radius, 0) / CellSize;
+	const int end_x = std::min(center.x + radius, 0xFFFF) / CellSize;
+	const int end_y = std::min(center.y + radius, 0xFFFF) / CellSize;
+	for(int y = start_y; y <= end_y; ++y) {
+		for(int x = start_x; x <= end_x; ++x) {
+			function(getCell(x * CellSize, y * CellSize, center.z));
+		}
+	}
+}
+
+void SpawnGrid::add(const Position& center, int radius)
+{
+	foreachCell(center, radius, [&](uint32_t cell) {
+		cells[cell].push_back(Area { center, radius });
+	});
+}
+
+void SpawnGrid::remove(const Position& center, int radius)
+{
+	foreachCell(center, radius, [&](uint32_t cell) {
+		auto it = cells.find(cell);
+		if(it == cells.end()) {
+			return;
+		}
+
+		std::vector<Area>& areas = it->second;
+		for(auto area = areas.begin(); area != areas.end(); ++area) {
+			if(area->center == center && area->radius == radius) {
+				*area = areas.back();
+				areas.pop_back();
+				break;
+			}
+		}
+		if(areas.empty()) {
+			cells.erase(it);
+		}
+	});
+}
+
+void SpawnGrid::find(const Position& position, std::vector<Position>& centers) const
+{
+	centers.clear();
+	if(position.x < 0 || position.y < 0) {
+		return;
+	}
+
+	auto it = cells.find(getCell(position.x, position.y, position.z));
+	if(it == cells.end()) {
+		return;
+	}
+
+	for(const Area& area : it->second) {
+		if(std::abs(area.center.x - position.x) <= area.radius && std::abs(area.center.y - position.y) <= area.radius) {
+			centers.push_back(area.center);
+		}
+	}
+
+	auto distance = [&](const Position& center) {
+		return std::max(std::abs(center.x - position.x), std::abs(center.y - position.y));
+	};
+	std::sort(centers.begin(), centers.end(), [&](const Position& a, const Position& b) {
+		return distance(a) < distance(b);
+	});
+}
+
 std::ostream& operator<<(std::ostream& os, const Spawn& spawn) {
 	os << &spawn << ":: -> " << spawn.getSize() << std::endl;
 	return os;
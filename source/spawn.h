@@ -18,6 +18,8 @@
 #ifndef RME_SPAWN_H_
 #define RME_SPAWN_H_
 
+#include <unordered_map>
+
 class Tile;
 
 class Spawn
@@ -66,4 +68,32 @@ private:
 	SpawnPositionList spawns;
 };
 
+// Finds the spawns covering a position without going through the tiles
+// around it. Every spawn area is kept in each 32x32 cell of its floor it
+// overlaps, so a lookup only goes through the spawns of a single cell.
+class SpawnGrid
+{
+public:
+	void add(const Position& center, int radius);
+	void remove(const Position& center, int radius);
+	void clear() { cells.clear(); }
+
+	// Centers of the spawns covering the position, closest first
+	void find(const Position& position, std::vector<Position>& centers) const;
+
+private:
+	static const int CellSize = 32;
+
+	struct Area {
+		Position center;
+		int radius;
+	};
+
+	static uint32_t getCell(int x, int y, int z) noexcept;
+	template <typename Function>
+	static void foreachCell(const Position& center, int radius, Function function);
+
+	std::unordered_map<uint32_t, std::vector<Area>> cells;
+};
+
 #endif
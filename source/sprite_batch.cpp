@@ -0,0 +1,149 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "sprite_batch.h"
+#include "texture_atlas.h"
+
+SpriteBatch::SpriteBatch() :
+	open(false),
+	flushes(0),
+	draw_calls(0),
+	quads(0)
+{
+	vertices.reserve(4096 * 4);
+}
+
+void SpriteBatch::begin()
+{
+	ASSERT(!open);
+	open = true;
+}
+
+void SpriteBatch::end()
+{
+	flush();
+	open = false;
+}
+
+void SpriteBatch::add(const AtlasRegion& region, float x, float y, float size, uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha)
+{
+	if(runs.empty() || runs.back().texture != region.texture) {
+		runs.push_back(Run { region.texture, region.page, static_cast<GLint>(vertices.size()), 0 });
+	}
+
+	vertices.push_back(Vertex { x, y, region.u0, region.v0, red, green, blue, alpha });
+	vertices.push_back(Vertex { x + size, y, region.u1, region.v0, red, green, blue, alpha });
+	vertices.push_back(Vertex { x + size, y + size, region.u1, region.v1, red, green, blue, alpha });
+	vertices.push_back(Vertex { x, y + size, region.u0, region.v1, red, green, blue, alpha });
+	runs.back().count += 4;
+	++quads;
+
+	if(!open) {
+		flush();
+	}
+}
+
+void SpriteBatch::flush()
+{
+	if(runs.empty()) {
+		return;
+	}
+
+	const Vertex* data = vertices.data();
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &data->x);
+	glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &data->u);
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), &data->red);
+
+	for(const Run& run : runs) {
+		glBindTexture(GL_TEXTURE_2D, run.texture);
+		glDrawArrays(GL_QUADS, run.first, run.count);
+	}
+	draw_calls += runs.size();
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	// The color array leaves the current color undefined
+	glColor4ub(255, 255, 255, 255);
+
+	vertices.clear();
+	runs.clear();
+	++flushes;
+}
+
+bool SpriteBatch::record(const Mark& mark, float x, float y, Recording& recording) const
+{
+	recording.clear();
+	if(mark.flushes != flushes) {
+		return false;
+	}
+
+	recording.vertices.reserve(vertices.size() - mark.vertex);
+	for(size_t i = mark.vertex; i < vertices.size(); ++i) {
+		Vertex vertex = vertices[i];
+		vertex.x -= x;
+		vertex.y -= y;
+		recording.vertices.push_back(vertex);
+	}
+
+	// The run that was open at the mark may have started before it
+	const GLint start = static_cast<GLint>(mark.vertex);
+	for(const Run& run : runs) {
+		const GLint end = run.first + run.count;
+		if(end <= start) {
+			continue;
+		}
+		const GLint first = std::max(run.first, start);
+		recording.runs.push_back(Run { run.texture, run.page, first - start, end - first });
+	}
+	return true;
+}
+
+void SpriteBatch::replay(const Recording& recording, float x, float y, TextureAtlas& atlas)
+{
+	if(recording.vertices.empty()) {
+		return;
+	}
+
+	const GLint offset = static_cast<GLint>(vertices.size());
+	for(const Run& run : recording.runs) {
+		atlas.touchPage(run.page);
+		if(!runs.empty() && runs.back().texture == run.texture) {
+			runs.back().count += run.count;
+		} else {
+			runs.push_back(Run { run.texture, run.page, offset + run.first, run.count });
+		}
+	}
+
+	// Copied in one go and moved in place, pushing vertex by vertex cost more than adding the quads anew
+	vertices.insert(vertices.end(), recording.vertices.begin(), recording.vertices.end());
+	for(size_t i = offset; i < vertices.size(); ++i) {
+		vertices[i].x += x;
+		vertices[i].y += y;
+	}
+	quads += recording.vertices.size() / 4;
+
+	if(!open) {
+		flush();
+	}
+}
@@ -0,0 +1,98 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_SPRITE_BATCH_H_
+#define RME_SPRITE_BATCH_H_
+
+#include <vector>
+
+struct AtlasRegion;
+class TextureAtlas;
+
+// Collects textured quads and draws them with vertex arrays. Quads are kept
+// in the order they were added (the map is drawn back to front), consecutive
+// quads from the same atlas page end up in a single draw call.
+class SpriteBatch
+{
+public:
+	SpriteBatch();
+
+	// While a batch is open quads are queued until flush() or end(),
+	// otherwise every quad is drawn right away
+	void begin();
+	void end();
+	bool isOpen() const noexcept { return open; }
+
+	void add(const AtlasRegion& region, float x, float y, float size, uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha);
+
+	// Draws everything queued so far, must be called before drawing
+	// anything else on top of the queued quads
+	void flush();
+
+	size_t getDrawCalls() const noexcept { return draw_calls; }
+	size_t getQuads() const noexcept { return quads; }
+	void resetStatistics() noexcept { draw_calls = quads = 0; }
+
+	struct Vertex {
+		GLfloat x, y;
+		GLfloat u, v;
+		GLubyte red, green, blue, alpha;
+	};
+
+	struct Run {
+		GLuint texture;
+		uint16_t page;
+		GLint first;
+		GLsizei count;
+	};
+
+	// A copy of some queued quads that can be queued again later, moved
+	struct Recording {
+		std::vector<Vertex> vertices;
+		std::vector<Run> runs;
+
+		void clear() { vertices.clear(); runs.clear(); }
+		size_t getMemoryUsage() const noexcept {
+			return vertices.capacity() * sizeof(Vertex) + runs.capacity() * sizeof(Run);
+		}
+	};
+
+	struct Mark {
+		size_t vertex;
+		size_t flushes;
+	};
+
+	// Remembers where the queue is, so what is added after it can be recorded
+	Mark mark() const noexcept { return Mark { vertices.size(), flushes }; }
+	// Copies everything added since mark into recording, moved by -x, -y.
+	// Fails if the queue was flushed in between.
+	bool record(const Mark& mark, float x, float y, Recording& recording) const;
+	// Queues recorded quads again moved by x, y. Every atlas page they use
+	// is touched, the regions they came from must still be valid.
+	void replay(const Recording& recording, float x, float y, TextureAtlas& atlas);
+
+private:
+	std::vector<Vertex> vertices;
+	std::vector<Run> runs;
+	bool open;
+	size_t flushes;
+
+	size_t draw_calls;
+	size_t quads;
+};
+
+#endif
@@ -0,0 +1,248 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "texture_atlas.h"
+#include "graphics.h"
+#include "gui.h"
+
+namespace {
+	const int AtlasPageSize = 2048;
+	const int AtlasGutter = 1;
+	const int AtlasCellSize = rme::SpritePixels + AtlasGutter * 2;
+}
+
+TextureAtlas::TextureAtlas() :
+	page_size(0),
+	slots_per_row(0),
+	used_slots(0),
+	allocated_pages(0),
+	budget(static_cast<size_t>(-1)),
+	now(0),
+	generation(0),
+	hits(0),
+	misses(0),
+	evictions(0)
+{
+	////
+}
+
+TextureAtlas::~TextureAtlas()
+{
+	clear();
+}
+
+size_t TextureAtlas::createPage()
+{
+	if(page_size == 0) {
+		GLint max_size = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+		page_size = std::min<int>(AtlasPageSize, std::max<int>(max_size, AtlasCellSize));
+		slots_per_row = page_size / AtlasCellSize;
+	}
+
+	// Take the place of a page that was released before, if there is one
+	size_t index = 0;
+	while(index < pages.size() && pages[index].texture != 0) {
+		++index;
+	}
+	if(index == pages.size()) {
+		pages.emplace_back();
+		Page& page = pages.back();
+		page.texture = 0;
+		page.used = 0;
+		page.owners.resize(slots_per_row * slots_per_row, nullptr);
+	}
+
+	Page& page = pages[index];
+	page.texture = g_gui.gfx.getFreeTextureID();
+	page.last_used = now;
+
+	// Drop errors left behind by someone else, so the check below is ours
+	for(int i = 0; i < 16 && glGetError() != GL_NO_ERROR; ++i) { }
+
+	glBindTexture(GL_TEXTURE_2D, page.texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // Linear Filtering
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // Linear Filtering
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, 0x812F); // GL_CLAMP_TO_EDGE
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, 0x812F); // GL_CLAMP_TO_EDGE
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, page_size, page_size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	if(glGetError() != GL_NO_ERROR) {
+		glDeleteTextures(1, &page.texture);
+		page.texture = 0;
+		return pages.size();
+	}
+
+	evictPage(page); // Fills the free list
+	++allocated_pages;
+	return index;
+}
+
+void TextureAtlas::releasePage(Page& page)
+{
+	evictPage(page);
+	page.free_slots.clear();
+	glDeleteTextures(1, &page.texture);
+	page.texture = 0;
+	--allocated_pages;
+}
+
+void TextureAtlas::evictPage(Page& page)
+{
+	if(page.used > 0) {
+		for(AtlasRegion*& owner : page.owners) {
+			if(owner) {
+				*owner = AtlasRegion();
+				owner = nullptr;
+			}
+		}
+		used_slots -= page.used;
+		page.used = 0;
+		++evictions;
+		++generation;
+	}
+
+	// Reversed, so slots are handed out from the top left corner
+	page.free_slots.clear();
+	for(size_t slot = page.owners.size(); slot > 0; --slot) {
+		page.free_slots.push_back(static_cast<uint16_t>(slot - 1));
+	}
+}
+
+bool TextureAtlas::add(const uint8_t* rgba, AtlasRegion& region)
+{
+	ASSERT(!region.isValid());
+	++misses;
+
+	size_t page_index = 0;
+	while(page_index < pages.size() && pages[page_index].free_slots.empty()) {
+		++page_index;
+	}
+
+	if(page_index == pages.size() && allocated_pages > 0 && (allocated_pages + 1) * getPageBytes() > budget) {
+		// Out of budget, reuse the page that has been idle the longest
+		size_t oldest = pages.size();
+		for(size_t i = 0; i < pages.size(); ++i) {
+			if(pages[i].texture != 0 && pages[i].last_used < now &&
+				(oldest == pages.size() || pages[i].last_used < pages[oldest].last_used)) {
+				oldest = i;
+			}
+		}
+		// If every page is in use by this frame we go over budget instead
+		if(oldest != pages.size()) {
+			evictPage(pages[oldest]);
+			page_index = oldest;
+		}
+	}
+
+	if(page_index == pages.size()) {
+		page_index = createPage();
+		if(page_index == pages.size()) {
+			return false;
+		}
+	}
+
+	Page& page = pages[page_index];
+	uint16_t slot = page.free_slots.back();
+	page.free_slots.pop_back();
+	page.owners[slot] = &region;
+	page.last_used = now;
+	++page.used;
+	++used_slots;
+
+	// Copy the sprite into the middle of the cell and repeat its outer pixels
+	// into the gutter
+	uint8_t cell[AtlasCellSize * AtlasCellSize * 4];
+	for(int y = 0; y < AtlasCellSize; ++y) {
+		int sy = std::min(std::max(y - AtlasGutter, 0), rme::SpritePixels - 1);
+		for(int x = 0; x < AtlasCellSize; ++x) {
+			int sx = std::min(std::max(x - AtlasGutter, 0), rme::SpritePixels - 1);
+			memcpy(&cell[(y * AtlasCellSize + x) * 4], &rgba[(sy * rme::SpritePixels + sx) * 4], 4);
+		}
+	}
+
+	const int cell_x = (slot % slots_per_row) * AtlasCellSize;
+	const int cell_y = (slot / slots_per_row) * AtlasCellSize;
+
+	glBindTexture(GL_TEXTURE_2D, page.texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, cell_x, cell_y, AtlasCellSize, AtlasCellSize, GL_RGBA, GL_UNSIGNED_BYTE, cell);
+
+	const float scale = 1.f / page_size;
+	region.texture = page.texture;
+	region.u0 = (cell_x + AtlasGutter) * scale;
+	region.v0 = (cell_y + AtlasGutter) * scale;
+	region.u1 = (cell_x + AtlasGutter + rme::SpritePixels) * scale;
+	region.v1 = (cell_y + AtlasGutter + rme::SpritePixels) * scale;
+	region.page = static_cast<uint16_t>(page_index);
+	region.slot = slot;
+	return true;
+}
+
+void TextureAtlas::remove(AtlasRegion& region)
+{
+	if(!region.isValid()) {
+		return;
+	}
+
+	if(region.page < pages.size() && pages[region.page].owners[region.slot] == &region) {
+		Page& page = pages[region.page];
+		page.owners[region.slot] = nullptr;
+		page.free_slots.push_back(region.slot);
+		--page.used;
+		--used_slots;
+		++generation;
+	}
+	region = AtlasRegion();
+}
+
+size_t TextureAtlas::collect(long idle_since)
+{
+	size_t count = 0;
+	for(Page& page : pages) {
+		if(page.texture != 0 && page.last_used < idle_since && page.last_used < now) {
+			releasePage(page);
+			++count;
+		}
+	}
+	return count;
+}
+
+void TextureAtlas::clear()
+{
+	for(Page& page : pages) {
+		if(page.texture != 0) {
+			releasePage(page);
+		}
+	}
+	pages.clear();
+}
+
+TextureAtlas::Statistics TextureAtlas::getStatistics() const noexcept
+{
+	Statistics statistics;
+	statistics.pages = allocated_pages;
+	statistics.page_bytes = getPageBytes();
+	statistics.budget = budget;
+	statistics.used_slots = used_slots;
+	statistics.slots_per_page = slots_per_row * slots_per_row;
+	statistics.hits = hits;
+	statistics.misses = misses;
+	statistics.evictions = evictions;
+	return statistics;
+}
@@ -0,0 +1,131 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_TEXTURE_ATLAS_H_
+#define RME_TEXTURE_ATLAS_H_
+
+#include <vector>
+
+// Where a sprite lives inside the atlas, texture coordinates are those of the
+// 32x32 sprite itself (without the gutter around it).
+struct AtlasRegion
+{
+	GLuint texture = 0;
+	float u0 = 0.f;
+	float v0 = 0.f;
+	float u1 = 0.f;
+	float v1 = 0.f;
+	uint16_t page = 0;
+	uint16_t slot = 0;
+
+	bool isValid() const noexcept { return texture != 0; }
+};
+
+// Packs the 32x32 sprite textures into a few large pages, so that a frame can
+// be drawn with one texture bind per page instead of one per sprite.
+// Every sprite gets a fixed size cell with a one pixel border copied from its
+// edges, which keeps linear filtering from bleeding in from the neighbours.
+//
+// The atlas remembers which region owns every cell. Memory is given back a
+// whole page at a time: the least recently used page is reused once the page
+// budget is reached, and idle pages are dropped by collect(). The owners of
+// an evicted page are reset, so they upload themselves again on next use.
+class TextureAtlas
+{
+public:
+	TextureAtlas();
+	~TextureAtlas();
+
+	TextureAtlas(const TextureAtlas&) = delete;
+	TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+	// Uploads a 32x32 RGBA image, requires a current GL context.
+	// region must stay at the same address until it is removed.
+	bool add(const uint8_t* rgba, AtlasRegion& region);
+	void remove(AtlasRegion& region);
+
+	// Marks the page of region as used at the current time
+	void touch(const AtlasRegion& region) noexcept {
+		pages[region.page].last_used = now;
+		++hits;
+	}
+	// Same, for quads drawn again without looking their regions up
+	void touchPage(uint16_t page) noexcept {
+		pages[page].last_used = now;
+	}
+
+	// Changes every time a region stops being valid, anything that kept
+	// copies of regions must look them up again when it does
+	uint32_t getGeneration() const noexcept { return generation; }
+
+	// Pages used at the current time are never evicted, so quads that are
+	// still waiting to be drawn can't lose their texture. Advance it once
+	// per frame.
+	void setTime(long time) noexcept { now = time; }
+	void setBudget(size_t bytes) noexcept { budget = bytes; }
+
+	// Releases every page that has not been used since idle_since,
+	// returns the number of pages released
+	size_t collect(long idle_since);
+
+	// Deletes every page, all regions handed out become invalid
+	void clear();
+
+	struct Statistics {
+		size_t pages;
+		size_t page_bytes;
+		size_t budget;
+		size_t used_slots;
+		size_t slots_per_page;
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t evictions;
+	};
+	Statistics getStatistics() const noexcept;
+
+	size_t getUsedSlots() const noexcept { return used_slots; }
+
+private:
+	struct Page {
+		GLuint texture; // 0 while released
+		std::vector<uint16_t> free_slots;
+		std::vector<AtlasRegion*> owners;
+		size_t used;
+		long last_used;
+	};
+
+	// Returns the index of the new page, or pages.size() on failure
+	size_t createPage();
+	void releasePage(Page& page);
+	void evictPage(Page& page);
+	size_t getPageBytes() const noexcept { return size_t(page_size) * page_size * 4; }
+
+	std::vector<Page> pages;
+	int page_size;
+	int slots_per_row;
+	size_t used_slots;
+	size_t allocated_pages;
+	size_t budget;
+	long now;
+	uint32_t generation;
+
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+};
+
+#endif
@@ -20,6 +20,11 @@
 
 #include "main.h"
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
 class Thread : public wxThread {
 public:
 	Thread(wxThreadKind);
@@ -37,6 +42,26 @@ public:
 	DetachedThread() : Thread(wxTHREAD_DETACHED) {}
 };
 
+// Runs jobs off a shared counter until there are none left
+class WorkerThread : public JoinableThread {
+public:
+	WorkerThread(const std::function<void(size_t)>& work, std::atomic<size_t>& next_job, size_t job_count) :
+		work(work), next_job(next_job), job_count(job_count) {}
+
+protected:
+	virtual ExitCode Entry() {
+		size_t index;
+		while((index = next_job++) < job_count) {
+			work(index);
+		}
+		return nullptr;
+	}
+
+	const std::function<void(size_t)>& work;
+	std::atomic<size_t>& next_job;
+	size_t job_count;
+};
+
 inline Thread::Thread(wxThreadKind kind) : wxThread(kind) {}
 
 inline void Thread::Execute() {
@@ -44,4 +69,47 @@ inline void Thread::Execute() {
 	Run();
 }
 
+// Calls work for every job on up to threadcount threads and returns once all are done.
+// progress is only ever called on the calling thread, with the number of jobs finished.
+inline void RunJobs(size_t job_count, int threadcount, const std::function<void(size_t)>& work, const std::function<void(size_t)>& progress = nullptr) {
+	if(threadcount <= 1 || job_count <= 1) {
+		for(size_t index = 0; index < job_count; ++index) {
+			work(index);
+			if(progress) {
+				progress(index + 1);
+			}
+		}
+		return;
+	}
+
+	std::atomic<size_t> jobs_done(0);
+	std::function<void(size_t)> counted_work = [&](size_t index) {
+		work(index);
+		++jobs_done;
+	};
+
+	std::atomic<size_t> next_job(0);
+	std::vector<std::unique_ptr<WorkerThread>> threads;
+	for(int i = 0; i < threadcount && size_t(i) < job_count; ++i) {
+		threads.emplace_back(newd WorkerThread(counted_work, next_job, job_count));
+		threads.back()->Execute();
+	}
+
+	if(progress) {
+		size_t reported = 0;
+		while(reported < job_count) {
+			wxMilliSleep(50);
+			const size_t done = jobs_done;
+			if(done != reported) {
+				reported = done;
+				progress(done);
+			}
+		}
+	}
+
+	for(auto& thread : threads) {
+		thread->Wait();
+	}
+}
+
 #endif
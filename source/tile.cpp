@@ -279,6 +279,7 @@ void Tile::select()
 	}
 
 	statflags |= TILESTATE_SELECTED;
+	if(location) location->markChanged();
 }
 
 void Tile::deselect()
@@ -292,6 +293,7 @@ void Tile::deselect()
 	}
 
 	statflags &= ~TILESTATE_SELECTED;
+	if(location) location->markChanged();
 }
 
 Item* Tile::getTopSelectedItem()
@@ -578,6 +580,7 @@ void Tile::selectGround()
 	}
 
 	if(selected) statflags |= TILESTATE_SELECTED;
+	if(location) location->markChanged();
 }
 
 
@@ -591,6 +594,7 @@ void Tile::deselectGround()
 			break;
 		item->deselect();
 	}
+	if(location) location->markChanged();
 }
 
 void Tile::setHouse(House* house)
@@ -604,6 +608,7 @@ void Tile::addHouseExit(House* house)
 
 	HouseExitList* exits = location->createHouseExits();
 	exits->push_back(house->id);
+	location->markChanged();
 }
 
 void Tile::removeHouseExit(House* house)
@@ -614,8 +619,10 @@ void Tile::removeHouseExit(House* house)
 	if(!exits || exits->empty()) return;
 
 	auto it = std::find(exits->begin(), exits->end(), house->id);
-	if(it != exits->end())
+	if(it != exits->end()) {
 		exits->erase(it);
+		location->markChanged();
+	}
 }
 
 bool Tile::hasHouseExit(uint32_t houseId) const
@@ -56,6 +56,8 @@ public: // Members
 	uint32_t house_id; // House id for this tile (pointer not safe)
 
 public:
+	POOLED_ALLOCATION
+
 	// ALWAYS use this constructor if the Tile is EVER going to be placed on a map
 	Tile(TileLocation& location);
 	// Use this when the tile is only used internally by the editor (like in certain brushes)
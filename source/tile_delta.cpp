@@ -0,0 +1,216 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "tile_delta.h"
+#include "basemap.h"
+#include "tile.h"
+#include "item.h"
+#include "creature.h"
+#include "spawn.h"
+
+#include <typeinfo>
+
+namespace {
+	// Only plain items are compared, anything with attributes or contents
+	// is always stored
+	bool isSameItem(const Item* a, const Item* b)
+	{
+		if(!a || !b) {
+			return a == b;
+		}
+		return typeid(*a) == typeid(Item) && typeid(*b) == typeid(Item) &&
+			a->getID() == b->getID() && a->getSubtype() == b->getSubtype() &&
+			!a->isComplex() && !b->isComplex();
+	}
+
+	Item* createSharedItem(uint16_t id, uint16_t subtype, bool selected)
+	{
+		Item* item = Item::Create(id, subtype);
+		if(item && selected) {
+			item->select();
+		}
+		return item;
+	}
+}
+
+TileDelta::TileDelta() :
+	house_id(0),
+	mapflags(0),
+	statflags(0),
+	prefix(0),
+	suffix(0),
+	selection(0),
+	shared_ground(false),
+	ground(nullptr),
+	creature(nullptr),
+	spawn(nullptr)
+{
+	////
+}
+
+TileDelta::~TileDelta()
+{
+	for(Item* item : items) {
+		delete item;
+	}
+	delete ground;
+	delete creature;
+	delete spawn;
+}
+
+TileDelta* TileDelta::Create(Tile* old_tile, const Tile* tile)
+{
+	if(!old_tile || !tile || !old_tile->getLocation()) {
+		return nullptr;
+	}
+
+	const ItemVector& old_items = old_tile->items;
+	const ItemVector& new_items = tile->items;
+
+	const bool shared_ground = old_tile->ground && isSameItem(old_tile->ground, tile->ground);
+
+	size_t prefix = 0;
+	while(prefix < old_items.size() && prefix < new_items.size() && isSameItem(old_items[prefix], new_items[prefix])) {
+		++prefix;
+	}
+	size_t suffix = 0;
+	while(suffix < old_items.size() - prefix && suffix < new_items.size() - prefix &&
+		isSameItem(old_items[old_items.size() - 1 - suffix], new_items[new_items.size() - 1 - suffix])) {
+		++suffix;
+	}
+
+	// The ground has the first selection bit whether it is shared or not
+	const size_t shared = (shared_ground ? 1 : 0) + prefix + suffix;
+	if(shared == 0 || 1 + prefix + suffix > MaxSharedItems) {
+		return nullptr;
+	}
+
+	// A tile with just a ground or so is smaller than the delta would be
+	uint32_t saved = sizeof(Tile);
+	if(shared_ground) saved += old_tile->ground->memsize();
+	for(size_t i = 0; i < prefix; ++i) {
+		saved += old_items[i]->memsize();
+	}
+	for(size_t i = old_items.size() - suffix; i < old_items.size(); ++i) {
+		saved += old_items[i]->memsize();
+	}
+	if(saved <= sizeof(TileDelta) + shared * sizeof(SharedItem)) {
+		return nullptr;
+	}
+
+	TileDelta* delta = newd TileDelta();
+	delta->position = old_tile->getPosition();
+	delta->house_id = old_tile->getHouseID();
+	delta->mapflags = old_tile->getMapFlags();
+	delta->statflags = old_tile->getStatFlags();
+	delta->prefix = static_cast<uint16_t>(prefix);
+	delta->suffix = static_cast<uint16_t>(suffix);
+	delta->shared_ground = shared_ground;
+
+	int bit = 0;
+	delta->shared.reserve(shared);
+	if(shared_ground) {
+		delta->shared.push_back(SharedItem { old_tile->ground->getID(), old_tile->ground->getSubtype() });
+		if(old_tile->ground->isSelected()) {
+			delta->selection |= uint64_t(1) << bit;
+		}
+	}
+	++bit;
+	for(size_t i = 0; i < prefix; ++i, ++bit) {
+		delta->shared.push_back(SharedItem { old_items[i]->getID(), old_items[i]->getSubtype() });
+		if(old_items[i]->isSelected()) {
+			delta->selection |= uint64_t(1) << bit;
+		}
+	}
+	for(size_t i = old_items.size() - suffix; i < old_items.size(); ++i, ++bit) {
+		delta->shared.push_back(SharedItem { old_items[i]->getID(), old_items[i]->getSubtype() });
+		if(old_items[i]->isSelected()) {
+			delta->selection |= uint64_t(1) << bit;
+		}
+	}
+
+	// Take over everything that is not shared, the rest goes with old_tile
+	if(!shared_ground) {
+		delta->ground = old_tile->ground;
+		old_tile->ground = nullptr;
+	}
+	auto first = old_tile->items.begin() + prefix;
+	auto last = old_tile->items.end() - suffix;
+	delta->items.assign(first, last);
+	old_tile->items.erase(first, last);
+
+	delta->creature = old_tile->creature;
+	old_tile->creature = nullptr;
+	delta->spawn = old_tile->spawn;
+	old_tile->spawn = nullptr;
+	return delta;
+}
+
+Tile* TileDelta::rebuild(BaseMap& map)
+{
+	Tile* rebuilt = map.allocator.allocateTile(map.createTileL(position));
+	rebuilt->house_id = house_id;
+	rebuilt->setMapFlags(mapflags);
+	rebuilt->setStatFlags(statflags);
+
+	auto next_shared = shared.begin();
+	int bit = 0;
+	if(shared_ground) {
+		rebuilt->ground = createSharedItem(next_shared->id, next_shared->subtype, selection & 1);
+		++next_shared;
+	} else {
+		rebuilt->ground = ground;
+		ground = nullptr;
+	}
+	++bit;
+
+	for(size_t i = 0; i < prefix; ++i, ++bit, ++next_shared) {
+		if(Item* item = createSharedItem(next_shared->id, next_shared->subtype, (selection >> bit) & 1)) {
+			rebuilt->items.push_back(item);
+		}
+	}
+	rebuilt->items.insert(rebuilt->items.end(), items.begin(), items.end());
+	items.clear();
+	for(size_t i = 0; i < suffix; ++i, ++bit, ++next_shared) {
+		if(Item* item = createSharedItem(next_shared->id, next_shared->subtype, (selection >> bit) & 1)) {
+			rebuilt->items.push_back(item);
+		}
+	}
+
+	rebuilt->creature = creature;
+	creature = nullptr;
+	rebuilt->spawn = spawn;
+	spawn = nullptr;
+	return rebuilt;
+}
+
+uint32_t TileDelta::memsize() const
+{
+	uint32_t mem = sizeof(*this);
+	if(ground) mem += ground->memsize();
+
+	for(const Item* item : items) {
+		mem += item->memsize();
+	}
+
+	mem += sizeof(Item*) * items.capacity();
+	mem += sizeof(SharedItem) * shared.capacity();
+
+	return mem;
+}
@@ -0,0 +1,86 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_TILE_DELTA_H_
+#define RME_TILE_DELTA_H_
+
+#include "position.h"
+#include "memory_pool.h"
+
+class BaseMap;
+class Tile;
+class Item;
+class Creature;
+class Spawn;
+
+// Undo history keeps the tile an action replaced. Most actions only change
+// a few items of every tile, so instead of the whole tile this keeps what
+// it does not have in common with the tile that replaced it: of the items
+// equal at the bottom and at the top of both stacks only the id and subtype
+// are kept, the items in between are stored whole. The tile can be rebuilt
+// from the delta alone, whatever happened to the map since.
+class TileDelta
+{
+public:
+	POOLED_ALLOCATION
+
+	// Takes over what old_tile does not share with tile, the tile that is on
+	// the map now. Returns nullptr, leaving old_tile alone, if they share
+	// nothing worth leaving out.
+	static TileDelta* Create(Tile* old_tile, const Tile* tile);
+	~TileDelta();
+
+	TileDelta(const TileDelta&) = delete;
+	TileDelta& operator=(const TileDelta&) = delete;
+
+	// Builds the old tile again. Can only be done once.
+	Tile* rebuild(BaseMap& map);
+
+	const Position& getPosition() const noexcept { return position; }
+	uint32_t memsize() const;
+
+private:
+	TileDelta();
+
+	// Selection is not part of the comparison, it is kept here instead.
+	// Bit 0 is always the ground's, so at most 63 items can be shared.
+	static const int MaxSharedItems = 64;
+
+	// Shared items are plain items, so this is all there is to them
+	struct SharedItem {
+		uint16_t id;
+		uint16_t subtype;
+	};
+
+	Position position;
+	uint32_t house_id;
+	uint16_t mapflags;
+	uint16_t statflags;
+	uint16_t prefix; // Items shared at the bottom of the stack
+	uint16_t suffix; // Items shared at the top of the stack
+	uint64_t selection; // Ground first, then the prefix, then the suffix
+	bool shared_ground;
+	Item* ground; // Only if not shared
+	Creature* creature;
+	Spawn* spawn;
+	std::vector<SharedItem> shared; // Ground first, then the prefix, then the suffix
+	std::vector<Item*> items; // The items in between
+
+	friend class UndoJournal;
+};
+
+#endif
@@ -0,0 +1,601 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "undo_journal.h"
+#include "action.h"
+#include "editor.h"
+#include "map.h"
+#include "tile.h"
+#include "tile_delta.h"
+#include "item.h"
+#include "creature.h"
+#include "spawn.h"
+#include "iomap_otbm.h"
+
+#include <wx/filename.h>
+
+namespace {
+	enum JournalNode : uint8_t {
+		JOURNAL_BATCH = 1,
+		JOURNAL_ACTION,
+		JOURNAL_TILE,
+		JOURNAL_TILE_DELTA,
+		JOURNAL_HOUSE_EXIT,
+		JOURNAL_WAYPOINT,
+	};
+
+	enum JournalFlags : uint8_t {
+		JOURNAL_GROUND = 1 << 0,
+		JOURNAL_GROUND_SELECTED = 1 << 1,
+		JOURNAL_CREATURE = 1 << 2,
+		JOURNAL_SPAWN = 1 << 3,
+	};
+
+	void writePosition(NodeFileWriteHandle& writer, const Position& position)
+	{
+		writer.addU16(position.x);
+		writer.addU16(position.y);
+		writer.addU8(position.z);
+	}
+
+	bool readPosition(BinaryNode* node, Position& position)
+	{
+		uint16_t x, y;
+		uint8_t z;
+		if(!node->getU16(x) || !node->getU16(y) || !node->getU8(z)) {
+			return false;
+		}
+		position = Position(x, y, z);
+		return true;
+	}
+
+	// Neither is part of the OTBM item nodes, so they go in the tile node
+	void writeCreature(NodeFileWriteHandle& writer, const Creature* creature, const Spawn* spawn)
+	{
+		writer.addU8((creature ? JOURNAL_CREATURE : 0) | (spawn ? JOURNAL_SPAWN : 0));
+		if(creature) {
+			writer.addString(creature->getTypeName());
+			writer.addU8(creature->getDirection());
+			writer.addU32(creature->getSpawnTime());
+			writer.addU8(creature->isSelected());
+		}
+		if(spawn) {
+			writer.addU16(spawn->getSize());
+			writer.addU8(spawn->isSelected());
+		}
+	}
+
+	bool readCreature(BinaryNode* node, Creature*& creature, Spawn*& spawn)
+	{
+		uint8_t flags;
+		if(!node->getU8(flags)) {
+			return false;
+		}
+
+		if(flags & JOURNAL_CREATURE) {
+			std::string name;
+			uint8_t direction, selected;
+			uint32_t spawntime;
+			if(!node->getString(name) || !node->getU8(direction) || !node->getU32(spawntime) || !node->getU8(selected)) {
+				return false;
+			}
+			creature = newd Creature(name);
+			creature->setDirection(static_cast<Direction>(direction));
+			creature->setSpawnTime(spawntime);
+			if(selected) {
+				creature->select();
+			}
+		}
+
+		if(flags & JOURNAL_SPAWN) {
+			uint16_t size;
+			uint8_t selected;
+			if(!node->getU16(size) || !node->getU8(selected)) {
+				return false;
+			}
+			spawn = newd Spawn(size);
+			if(selected) {
+				spawn->select();
+			}
+		}
+		return true;
+	}
+
+	void setSelected(Item* item, bool selected)
+	{
+		if(selected) {
+			item->select();
+		} else {
+			item->deselect();
+		}
+	}
+}
+
+UndoJournal::UndoJournal() :
+	write_offset(0),
+	live_records(0),
+	map_version(MapVersion(MAP_OTBM_4, CLIENT_VERSION_NONE))
+{
+	////
+}
+
+UndoJournal::~UndoJournal()
+{
+	close();
+}
+
+bool UndoJournal::open()
+{
+	if(file.IsOpened()) {
+		return true;
+	}
+
+	filename = wxFileName::CreateTempFileName("rme_undo");
+	if(filename.IsEmpty() || !file.Open(filename, wxFile::read_write)) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void UndoJournal::close()
+{
+	if(file.IsOpened()) {
+		file.Close();
+	}
+	if(!filename.IsEmpty()) {
+		wxRemoveFile(filename);
+		filename.Clear();
+	}
+	write_offset = 0;
+	live_records = 0;
+	free_extents.clear();
+}
+
+void UndoJournal::clear()
+{
+	close();
+}
+
+uint64_t UndoJournal::allocateSpace(uint64_t size)
+{
+	for(auto iter = free_extents.begin(); iter != free_extents.end(); ++iter) {
+		if(iter->second < size) {
+			continue;
+		}
+
+		const uint64_t offset = iter->first;
+		const uint64_t left = iter->second - size;
+		free_extents.erase(iter);
+		if(left > 0) {
+			free_extents[offset + size] = left;
+		}
+		return offset;
+	}
+
+	const uint64_t offset = write_offset;
+	write_offset += size;
+	return offset;
+}
+
+void UndoJournal::releaseSpace(uint64_t offset, uint64_t size)
+{
+	auto next = free_extents.lower_bound(offset);
+	if(next != free_extents.end() && offset + size == next->first) {
+		size += next->second;
+		next = free_extents.erase(next);
+	}
+	if(next != free_extents.begin()) {
+		auto previous = std::prev(next);
+		if(previous->first + previous->second == offset) {
+			offset = previous->first;
+			size += previous->second;
+			free_extents.erase(previous);
+		}
+	}
+
+	if(offset + size == write_offset) {
+		write_offset = offset;
+	} else {
+		free_extents[offset] = size;
+	}
+}
+
+void UndoJournal::releaseRecord(const BatchAction& batch)
+{
+	ASSERT(live_records > 0);
+	if(--live_records == 0) {
+		// Nothing left that is still needed, start over
+		write_offset = 0;
+		free_extents.clear();
+	} else {
+		releaseSpace(batch.journal_offset, batch.journal_size);
+	}
+}
+
+bool UndoJournal::spill(BatchAction& batch)
+{
+	if(batch.spilled || batch.batch.empty() || !open()) {
+		return false;
+	}
+
+	// Batches can be big, don't hold on to the buffer
+	MemoryNodeFileWriteHandle writer;
+	writer.addNode(JOURNAL_BATCH);
+	writer.addU32(batch.batch.size());
+	for(const Action* action : batch.batch) {
+		if(!writeAction(writer, *action)) {
+			return false;
+		}
+	}
+	writer.endNode();
+
+	const size_t size = writer.getSize();
+	const uint64_t offset = allocateSpace(size);
+	if(file.Seek(static_cast<wxFileOffset>(offset)) == wxInvalidOffset || file.Write(writer.getMemory(), size) != size) {
+		releaseSpace(offset, size);
+		return false;
+	}
+
+	batch.journal_offset = offset;
+	batch.journal_size = static_cast<uint32_t>(size);
+	batch.journal_count = static_cast<uint32_t>(batch.batch.size());
+	++live_records;
+
+	for(Action* action : batch.batch) {
+		delete action;
+	}
+	ActionVector().swap(batch.batch);
+	batch.spilled = true;
+	batch.memory_size = 0;
+	return true;
+}
+
+bool UndoJournal::load(const ActionQueue& queue, BatchAction& batch)
+{
+	if(!batch.spilled || !file.IsOpened()) {
+		return false;
+	}
+
+	std::vector<uint8_t> data(batch.journal_size);
+	if(file.Seek(static_cast<wxFileOffset>(batch.journal_offset)) == wxInvalidOffset ||
+		file.Read(data.data(), data.size()) != static_cast<ssize_t>(data.size())) {
+		return false;
+	}
+
+	MemoryNodeFileReadHandle reader(data.data(), data.size());
+	BinaryNode* root = reader.getRootNode();
+
+	uint8_t type;
+	uint32_t count;
+	if(!root || !root->getU8(type) || type != JOURNAL_BATCH || !root->getU32(count)) {
+		return false;
+	}
+
+	ActionVector actions;
+	actions.reserve(count);
+
+	bool success = true;
+	BinaryNode* node = root->getChild();
+	if(node) do {
+		Action* action = readAction(queue, batch, node);
+		if(!action) {
+			success = false;
+			break;
+		}
+		actions.push_back(action);
+	} while(node->advance());
+
+	if(!success || actions.size() != count) {
+		for(Action* action : actions) {
+			delete action;
+		}
+		return false;
+	}
+
+	batch.batch.swap(actions);
+	batch.spilled = false;
+	batch.journal_count = 0;
+	batch.memory_size = 0;
+	releaseRecord(batch);
+	return true;
+}
+
+void UndoJournal::discard(BatchAction& batch)
+{
+	if(batch.spilled) {
+		batch.spilled = false;
+		batch.journal_count = 0;
+		releaseRecord(batch);
+	}
+}
+
+bool UndoJournal::writeAction(NodeFileWriteHandle& writer, const Action& action)
+{
+	writer.addNode(JOURNAL_ACTION);
+	writer.addU8(action.commited);
+	for(const Change* change : action.changes) {
+		if(!writeChange(writer, *change)) {
+			return false;
+		}
+	}
+	return writer.endNode();
+}
+
+bool UndoJournal::writeChange(NodeFileWriteHandle& writer, const Change& change)
+{
+	switch(change.type) {
+		case CHANGE_TILE:
+			return writeTile(writer, *reinterpret_cast<const Tile*>(change.data));
+		case CHANGE_TILE_DELTA:
+			return writeDelta(writer, *reinterpret_cast<const TileDelta*>(change.data));
+		case CHANGE_MOVE_HOUSE_EXIT: {
+			const HouseData* data = reinterpret_cast<const HouseData*>(change.data);
+			writer.addNode(JOURNAL_HOUSE_EXIT);
+			writer.addU32(data->id);
+			writePosition(writer, data->position);
+			return writer.endNode();
+		}
+		case CHANGE_MOVE_WAYPOINT: {
+			const WaypointData* data = reinterpret_cast<const WaypointData*>(change.data);
+			writer.addNode(JOURNAL_WAYPOINT);
+			writer.addString(data->id);
+			writePosition(writer, data->position);
+			return writer.endNode();
+		}
+		default:
+			// Cleared changes have nothing to put back
+			return true;
+	}
+}
+
+bool UndoJournal::writeTile(NodeFileWriteHandle& writer, const Tile& tile)
+{
+	writer.addNode(JOURNAL_TILE);
+	writePosition(writer, tile.getPosition());
+	writer.addU32(tile.house_id);
+	writer.addU16(tile.getMapFlags());
+	writer.addU16(tile.getStatFlags());
+	writeCreature(writer, tile.creature, tile.spawn);
+	if(!writeItems(writer, tile.ground, tile.items)) {
+		return false;
+	}
+	return writer.endNode();
+}
+
+bool UndoJournal::writeDelta(NodeFileWriteHandle& writer, const TileDelta& delta)
+{
+	writer.addNode(JOURNAL_TILE_DELTA);
+	writePosition(writer, delta.position);
+	writer.addU32(delta.house_id);
+	writer.addU16(delta.mapflags);
+	writer.addU16(delta.statflags);
+	writer.addU16(delta.prefix);
+	writer.addU16(delta.suffix);
+	writer.addU64(delta.selection);
+	writer.addU8(delta.shared_ground);
+	for(const TileDelta::SharedItem& item : delta.shared) {
+		writer.addU16(item.id);
+		writer.addU16(item.subtype);
+	}
+	writeCreature(writer, delta.creature, delta.spawn);
+	if(!writeItems(writer, delta.ground, delta.items)) {
+		return false;
+	}
+	return writer.endNode();
+}
+
+bool UndoJournal::writeItems(NodeFileWriteHandle& writer, const Item* ground, const std::vector<Item*>& items)
+{
+	// Selection is not part of the item nodes, it comes first
+	uint8_t flags = 0;
+	if(ground) {
+		flags |= JOURNAL_GROUND;
+		if(ground->isSelected()) {
+			flags |= JOURNAL_GROUND_SELECTED;
+		}
+	}
+	writer.addU8(flags);
+	writer.addU32(items.size());
+	for(const Item* item : items) {
+		writer.addU8(item->isSelected());
+	}
+
+	if(ground && !ground->serializeItemNode_OTBM(map_version, writer)) {
+		return false;
+	}
+	for(const Item* item : items) {
+		if(!item->serializeItemNode_OTBM(map_version, writer)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+Action* UndoJournal::readAction(const ActionQueue& queue, BatchAction& batch, BinaryNode* node)
+{
+	uint8_t type, commited;
+	if(!node->getU8(type) || type != JOURNAL_ACTION || !node->getU8(commited)) {
+		return nullptr;
+	}
+
+	Map& map = batch.editor.getMap();
+	Action* action = queue.createAction(batch.getType());
+	action->commited = commited != 0;
+
+	BinaryNode* child = node->getChild();
+	if(child) do {
+		Change* change = readChange(map, child);
+		if(!change) {
+			delete action;
+			return nullptr;
+		}
+		action->addChange(change);
+	} while(child->advance());
+
+	return action;
+}
+
+Change* UndoJournal::readChange(BaseMap& map, BinaryNode* node)
+{
+	uint8_t type;
+	if(!node->getU8(type)) {
+		return nullptr;
+	}
+
+	switch(type) {
+		case JOURNAL_TILE: {
+			Tile* tile = readTile(map, node);
+			return tile ? newd Change(tile) : nullptr;
+		}
+		case JOURNAL_TILE_DELTA: {
+			TileDelta* delta = readDelta(node);
+			if(!delta) {
+				return nullptr;
+			}
+			Change* change = newd Change();
+			change->type = CHANGE_TILE_DELTA;
+			change->data = delta;
+			return change;
+		}
+		case JOURNAL_HOUSE_EXIT: {
+			uint32_t id;
+			Position position;
+			if(!node->getU32(id) || !readPosition(node, position)) {
+				return nullptr;
+			}
+			Change* change = newd Change();
+			change->type = CHANGE_MOVE_HOUSE_EXIT;
+			change->data = newd HouseData { id, position };
+			return change;
+		}
+		case JOURNAL_WAYPOINT: {
+			std::string id;
+			Position position;
+			if(!node->getString(id) || !readPosition(node, position)) {
+				return nullptr;
+			}
+			Change* change = newd Change();
+			change->type = CHANGE_MOVE_WAYPOINT;
+			change->data = newd WaypointData { id, position };
+			return change;
+		}
+		default:
+			return nullptr;
+	}
+}
+
+Tile* UndoJournal::readTile(BaseMap& map, BinaryNode* node)
+{
+	Position position;
+	uint32_t house_id;
+	uint16_t mapflags, statflags;
+	if(!readPosition(node, position) || !node->getU32(house_id) || !node->getU16(mapflags) || !node->getU16(statflags)) {
+		return nullptr;
+	}
+
+	Tile* tile = map.allocator(map.createTileL(position));
+	tile->house_id = house_id;
+	tile->setMapFlags(mapflags);
+	tile->setStatFlags(statflags);
+	if(!readCreature(node, tile->creature, tile->spawn) || !readItems(node, tile->ground, tile->items)) {
+		delete tile;
+		return nullptr;
+	}
+	return tile;
+}
+
+TileDelta* UndoJournal::readDelta(BinaryNode* node)
+{
+	TileDelta* delta = newd TileDelta();
+	uint8_t shared_ground;
+	if(!readPosition(node, delta->position) ||
+		!node->getU32(delta->house_id) ||
+		!node->getU16(delta->mapflags) ||
+		!node->getU16(delta->statflags) ||
+		!node->getU16(delta->prefix) ||
+		!node->getU16(delta->suffix) ||
+		!node->getU64(delta->selection) ||
+		!node->getU8(shared_ground)) {
+		delete delta;
+		return nullptr;
+	}
+	delta->shared_ground = shared_ground != 0;
+
+	delta->shared.resize((delta->shared_ground ? 1 : 0) + delta->prefix + delta->suffix);
+	for(TileDelta::SharedItem& item : delta->shared) {
+		if(!node->getU16(item.id) || !node->getU16(item.subtype)) {
+			delete delta;
+			return nullptr;
+		}
+	}
+
+	if(!readCreature(node, delta->creature, delta->spawn) || !readItems(node, delta->ground, delta->items)) {
+		delete delta;
+		return nullptr;
+	}
+	return delta;
+}
+
+bool UndoJournal::readItems(BinaryNode* node, Item*& ground, std::vector<Item*>& items)
+{
+	uint8_t flags;
+	uint32_t count;
+	if(!node->getU8(flags) || !node->getU32(count)) {
+		return false;
+	}
+
+	std::vector<uint8_t> selected(count);
+	for(uint8_t& value : selected) {
+		if(!node->getU8(value)) {
+			return false;
+		}
+	}
+	items.reserve(count);
+
+	BinaryNode* child = node->getChild();
+	if(child) do {
+		uint8_t type;
+		if(!child->getU8(type) || type != OTBM_ITEM) {
+			return false;
+		}
+
+		Item* item = Item::Create_OTBM(map_version, child);
+		if(!item) {
+			return false;
+		}
+		if(!item->unserializeItemNode_OTBM(map_version, child)) {
+			delete item;
+			return false;
+		}
+
+		if((flags & JOURNAL_GROUND) && !ground) {
+			setSelected(item, flags & JOURNAL_GROUND_SELECTED);
+			ground = item;
+		} else if(items.size() < count) {
+			setSelected(item, selected[items.size()] != 0);
+			items.push_back(item);
+		} else {
+			delete item;
+			return false;
+		}
+	} while(child->advance());
+
+	return ((flags & JOURNAL_GROUND) == 0 || ground) && items.size() == count;
+}
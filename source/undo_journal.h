@@ -0,0 +1,94 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_UNDO_JOURNAL_H_
+#define RME_UNDO_JOURNAL_H_
+
+#include "filehandle.h"
+#include "iomap.h"
+
+#include <wx/file.h>
+
+#include <map>
+
+class ActionQueue;
+class BatchAction;
+class Action;
+class Change;
+class Tile;
+class TileDelta;
+class Item;
+class Creature;
+class Spawn;
+class BaseMap;
+
+// Old undo history written out to a temporary file instead of being thrown
+// away. Every spilled batch is one OTBM node tree written to the file, it is
+// read back when the batch is undone or redone again. The space of records
+// that were read back or discarded is reused for the next ones, so the file
+// stays about as big as the history it holds.
+class UndoJournal
+{
+public:
+	UndoJournal();
+	~UndoJournal();
+
+	UndoJournal(const UndoJournal&) = delete;
+	UndoJournal& operator=(const UndoJournal&) = delete;
+
+	// Writes the actions of the batch to the file and frees them.
+	// Leaves the batch as it was if it could not be written.
+	bool spill(BatchAction& batch);
+	// Reads the actions of a spilled batch back, creating them through queue
+	bool load(const ActionQueue& queue, BatchAction& batch);
+	// Called for spilled batches that are deleted without being loaded
+	void discard(BatchAction& batch);
+	void clear();
+
+	size_t getRecordCount() const noexcept { return live_records; }
+	uint64_t getFileSize() const noexcept { return write_offset; }
+
+private:
+	bool open();
+	void close();
+	// Finds room for a record, in a free extent if one is big enough
+	uint64_t allocateSpace(uint64_t size);
+	void releaseSpace(uint64_t offset, uint64_t size);
+	void releaseRecord(const BatchAction& batch);
+
+	bool writeAction(NodeFileWriteHandle& writer, const Action& action);
+	bool writeChange(NodeFileWriteHandle& writer, const Change& change);
+	bool writeTile(NodeFileWriteHandle& writer, const Tile& tile);
+	bool writeDelta(NodeFileWriteHandle& writer, const TileDelta& delta);
+	bool writeItems(NodeFileWriteHandle& writer, const Item* ground, const std::vector<Item*>& items);
+
+	Action* readAction(const ActionQueue& queue, BatchAction& batch, BinaryNode* node);
+	Change* readChange(BaseMap& map, BinaryNode* node);
+	Tile* readTile(BaseMap& map, BinaryNode* node);
+	TileDelta* readDelta(BinaryNode* node);
+	bool readItems(BinaryNode* node, Item*& ground, std::vector<Item*>& items);
+
+	wxFile file;
+	wxString filename;
+	uint64_t write_offset; // End of the used part of the file
+	size_t live_records;
+	// Unused space below write_offset, by offset. Adjacent ones are merged.
+	std::map<uint64_t, uint64_t> free_extents;
+	VirtualIOMap map_version;
+};
+
+#endif
@@ -0,0 +1,101 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "test.h"
+#include "map.h"
+#include "tile.h"
+#include "item.h"
+#include "iomap_otbm.h"
+#include "filehandle.h"
+#include "settings.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+namespace {
+	class TestIOMapOTBM : public IOMapOTBM
+	{
+	public:
+		TestIOMapOTBM() : IOMapOTBM(MapVersion()) {}
+		using IOMapOTBM::saveMap;
+	};
+
+	// Grounds and a few items on every tile, some with counts and action
+	// ids, over many tile areas on two floors
+	void fillMap(Map& map, int size)
+	{
+		std::mt19937 random(7);
+		auto fill = [&](int width, int height, int z) {
+			for(int y = 0; y < height; ++y) {
+				for(int x = 0; x < width; ++x) {
+					Tile* tile = map.allocator(map.createTileL(x, y, z));
+					tile->ground = Item::Create(static_cast<uint16_t>(100 + random() % 40));
+					for(int count = random() % 4; count > 0; --count) {
+						Item* item = Item::Create(static_cast<uint16_t>(1000 + random() % 4000), static_cast<uint16_t>(1 + random() % 100));
+						if(random() % 100 == 0) {
+							item->setActionID(static_cast<uint16_t>(1000 + random() % 500));
+						}
+						tile->items.push_back(item);
+					}
+					map.setTile(tile);
+				}
+			}
+		};
+		fill(size, size, rme::MapGroundLayer);
+		fill(size / 2, size / 2, rme::MapGroundLayer - 1);
+	}
+
+	double save(Map& map, int threads, MemoryNodeFileWriteHandle& handle)
+	{
+		g_settings.setInteger(Config::WORKER_THREADS, threads);
+		TestIOMapOTBM io;
+		const auto start = std::chrono::steady_clock::now();
+		io.saveMap(map, handle);
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+// The threaded writer must not change a single byte of the file
+TEST_CASE(otbmThreadedSaveMatchesSerialSave)
+{
+	Map map;
+	map.setWidth(2048);
+	map.setHeight(2048);
+	fillMap(map, 1024);
+
+	const int threads = g_settings.getInteger(Config::WORKER_THREADS);
+
+	MemoryNodeFileWriteHandle serial;
+	const double serial_time = save(map, 1, serial);
+
+	for(int count : { 2, 4, 8 }) {
+		MemoryNodeFileWriteHandle threaded;
+		const double threaded_time = save(map, count, threaded);
+		CHECK(threaded.getSize() == serial.getSize());
+		CHECK(memcmp(threaded.getMemory(), serial.getMemory(), std::min(threaded.getSize(), serial.getSize())) == 0);
+
+		std::cout << "  " << map.getTileCount() << " tiles, " << serial.getSize() << " bytes: serial " << serial_time << " ms, "
+			<< count << " threads " << threaded_time << " ms" << std::endl;
+	}
+
+	g_settings.setInteger(Config::WORKER_THREADS, threads);
+}
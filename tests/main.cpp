@@ -0,0 +1,67 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "test.h"
+
+#include <wx/init.h>
+
+#include <iostream>
+#include <vector>
+
+namespace {
+	struct TestCase {
+		const char* name;
+		test::Function function;
+	};
+
+	std::vector<TestCase>& getTests()
+	{
+		static std::vector<TestCase> tests;
+		return tests;
+	}
+
+	int failures = 0;
+}
+
+test::Registration::Registration(const char* name, Function function)
+{
+	getTests().push_back(TestCase { name, function });
+}
+
+void test::fail(const char* file, int line, const char* expression)
+{
+	std::cout << file << ":" << line << ": CHECK(" << expression << ") failed" << std::endl;
+	++failures;
+}
+
+int main(int argc, char** argv)
+{
+	wxInitializer initializer(argc, argv);
+	if(!initializer) {
+		std::cout << "Could not initialize wxWidgets." << std::endl;
+		return 1;
+	}
+
+	for(const TestCase& test : getTests()) {
+		const int before = failures;
+		test.function();
+		std::cout << (failures == before ? "passed " : "FAILED ") << test.name << std::endl;
+	}
+	return failures == 0 ? 0 : 1;
+}
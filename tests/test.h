@@ -0,0 +1,45 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef RME_TESTS_TEST_H_
+#define RME_TESTS_TEST_H_
+
+// Just enough to run checks without pulling in a test framework. Every
+// TEST_CASE registers itself, main() runs them all in order.
+namespace test {
+	typedef void (*Function)();
+
+	struct Registration {
+		Registration(const char* name, Function function);
+	};
+
+	void fail(const char* file, int line, const char* expression);
+}
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static test::Registration name##_registration(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { \
+		if(!(expression)) { \
+			test::fail(__FILE__, __LINE__, #expression); \
+		} \
+	} while(false)
+
+#endif
@@ -0,0 +1,116 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+#include "main.h"
+
+#include "test.h"
+#include "map.h"
+#include "tile.h"
+#include "item.h"
+#include "tile_delta.h"
+
+namespace {
+	// Item ids without a type in the item database are created as plain items
+	Tile* createTile(Map& map, const Position& position, uint16_t ground, size_t items)
+	{
+		Tile* tile = map.allocator.allocateTile(map.createTileL(position));
+		tile->ground = Item::Create(ground);
+		for(size_t i = 0; i < items; ++i) {
+			tile->items.push_back(Item::Create(static_cast<uint16_t>(1000 + i)));
+		}
+		return tile;
+	}
+
+	bool hasItems(const Tile* tile, uint16_t ground, size_t items)
+	{
+		if(!tile->ground || tile->ground->getID() != ground || tile->items.size() != items) {
+			return false;
+		}
+		for(size_t i = 0; i < items; ++i) {
+			if(tile->items[i]->getID() != 1000 + i) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+// The ground takes selection bit 0 even when it isn't shared, so 64 shared
+// items would need a 65th bit
+TEST_CASE(tileDeltaRefusesMoreSharedItemsThanSelectionBits)
+{
+	Map map;
+	const Position position(100, 100, 7);
+	Tile* old_tile = createTile(map, position, 100, 64);
+	Tile* new_tile = createTile(map, position, 101, 64);
+
+	TileDelta* delta = TileDelta::Create(old_tile, new_tile);
+	CHECK(delta == nullptr);
+	CHECK(hasItems(old_tile, 100, 64));
+
+	delete delta;
+	delete old_tile;
+	delete new_tile;
+}
+
+TEST_CASE(tileDeltaKeepsLastSelectionBitWithoutSharedGround)
+{
+	Map map;
+	const Position position(100, 100, 7);
+	Tile* old_tile = createTile(map, position, 100, 63);
+	Tile* new_tile = createTile(map, position, 101, 63);
+	old_tile->items.back()->select();
+
+	TileDelta* delta = TileDelta::Create(old_tile, new_tile);
+	CHECK(delta != nullptr);
+	if(delta) {
+		Tile* rebuilt = delta->rebuild(map);
+		CHECK(hasItems(rebuilt, 100, 63));
+		CHECK(rebuilt->items.back()->isSelected());
+		CHECK(!rebuilt->items.front()->isSelected());
+		delete rebuilt;
+	}
+
+	delete delta;
+	delete old_tile;
+	delete new_tile;
+}
+
+TEST_CASE(tileDeltaKeepsLastSelectionBitWithSharedGround)
+{
+	Map map;
+	const Position position(100, 100, 7);
+	Tile* old_tile = createTile(map, position, 100, 63);
+	Tile* new_tile = createTile(map, position, 100, 63);
+	old_tile->ground->select();
+	old_tile->items.back()->select();
+
+	TileDelta* delta = TileDelta::Create(old_tile, new_tile);
+	CHECK(delta != nullptr);
+	if(delta) {
+		Tile* rebuilt = delta->rebuild(map);
+		CHECK(hasItems(rebuilt, 100, 63));
+		CHECK(rebuilt->ground->isSelected());
+		CHECK(rebuilt->items.back()->isSelected());
+		CHECK(!rebuilt->items.front()->isSelected());
+		delete rebuilt;
+	}
+
+	delete delta;
+	delete old_tile;
+	delete new_tile;
+}
@@ -0,0 +1,925 @@
+//////////////////////////////////////////////////////////////////////
+// This file is part of Remere's Map Editor
+//////////////////////////////////////////////////////////////////////
+// Remere's Map Editor is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Remere's Map Editor is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////
+
+// Load generator for the live mapping protocol. Connects scripted clients to
+// a running server (rme --serve map.otbm) over loopback and reports how long
+// change and cursor broadcasts take to reach the other clients, and how much
+// CPU time the server spends per packet type.
+//
+// The run goes through four phases, so the server's CPU time can be split
+// per packet type by sampling it between them (Linux only, see --server-pid):
+//   join     hello and ready from every client
+//   nodes    every client requests the whole area
+//   changes  change lists, one tile each, at --change-rate per client
+//   cursors  cursor updates at --cursor-rate per client
+
+#include "../../source/definitions.h"
+#include "../../source/live_packets.h"
+
+#include <asio.hpp>
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#	include <unistd.h>
+#endif
+
+namespace {
+	typedef std::chrono::steady_clock Clock;
+	typedef std::shared_ptr<const std::vector<uint8_t>> MessageBuffer;
+
+	// Same values as in iomap_otbm.h and filehandle.h
+	const uint8_t OTBM_TILE = 5;
+	const uint8_t OTBM_ATTR_ITEM = 9;
+	const uint8_t NODE_START = 0xFE;
+	const uint8_t NODE_END = 0xFF;
+	const uint8_t ESCAPE_CHAR = 0xFD;
+
+	const uint32_t CompressedFlag = 0x80000000;
+	const uint32_t MaxPacketSize = 64 * 1024 * 1024;
+
+	struct Options
+	{
+		std::string host = "127.0.0.1";
+		uint16_t port = 31313;
+		std::string password;
+		int32_t clients = 8;
+		int32_t duration = 10; // Seconds spent in the changes and cursors phases
+		double changeRate = 5; // Per client and second
+		double cursorRate = 20;
+		int32_t area = 8; // Nodes along each side of the area every client looks at
+		int32_t x = 1024;
+		int32_t y = 1024;
+		int32_t z = 7;
+		uint16_t ground = 4526;
+		int32_t serverPid = 0;
+		bool compression = true;
+	};
+
+	// Written like NetworkMessage, the size header is filled in by finish()
+	struct OutMessage
+	{
+		OutMessage() : buffer(4) {}
+
+		template<typename T> void write(const T& value)
+		{
+			const size_t position = buffer.size();
+			buffer.resize(position + sizeof(T));
+			memcpy(&buffer[position], &value, sizeof(T));
+		}
+
+		void writeString(const std::string& value)
+		{
+			write<uint16_t>(value.size());
+			buffer.insert(buffer.end(), value.begin(), value.end());
+		}
+
+		MessageBuffer finish()
+		{
+			const uint32_t size = buffer.size() - 4;
+			memcpy(&buffer[0], &size, 4);
+			return std::make_shared<const std::vector<uint8_t>>(std::move(buffer));
+		}
+
+		std::vector<uint8_t> buffer;
+	};
+
+	struct Percentiles
+	{
+		size_t count = 0;
+		double p50 = 0;
+		double p99 = 0;
+		double max = 0;
+	};
+
+	Percentiles getPercentiles(std::vector<double> samples)
+	{
+		Percentiles result;
+		result.count = samples.size();
+		if(samples.empty()) {
+			return result;
+		}
+
+		std::sort(samples.begin(), samples.end());
+		result.p50 = samples[(samples.size() - 1) * 50 / 100];
+		result.p99 = samples[(samples.size() - 1) * 99 / 100];
+		result.max = samples.back();
+		return result;
+	}
+
+	double millisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	// User and system time of a process in milliseconds, -1 if unknown
+	double getProcessCpuTime(int32_t pid)
+	{
+#ifdef __linux__
+		if(pid <= 0) {
+			return -1;
+		}
+
+		std::ifstream file("/proc/" + std::to_string(pid) + "/stat");
+		std::string line;
+		if(!std::getline(file, line)) {
+			return -1;
+		}
+
+		// The command name may contain spaces, the fields after it never do
+		std::istringstream fields(line.substr(line.rfind(')') + 2));
+		std::string field;
+		unsigned long long utime = 0, stime = 0;
+		for(int32_t index = 3; index <= 15 && fields >> field; ++index) {
+			if(index == 14) {
+				utime = std::stoull(field);
+			} else if(index == 15) {
+				stime = std::stoull(field);
+			}
+		}
+		return (utime + stime) * 1000.0 / sysconf(_SC_CLK_TCK);
+#else
+		return -1;
+#endif
+	}
+}
+
+class LoadTest;
+
+// One scripted mapper, speaks the same protocol as LiveClient
+class LoadClient
+{
+	public:
+		LoadClient(LoadTest& test, uint32_t index);
+
+		void connect(const asio::ip::tcp::endpoint& endpoint);
+		void close();
+
+		void requestNodes();
+		void sendChange();
+		void sendCursor();
+
+		bool isJoined() const { return joined; }
+		bool isDone() const { return failed || (joined && pendingNodes == 0); }
+
+	protected:
+		void receiveHeader();
+		void receive(uint32_t packetSize);
+		void parsePacket();
+		void send(OutMessage& message);
+		void fail(const std::string& reason);
+
+		LoadTest& test;
+		asio::ip::tcp::socket socket;
+		uint32_t index;
+
+		std::vector<uint8_t> readBuffer;
+		bool joined;
+		bool failed;
+		bool compression;
+
+		Clock::time_point connectTime;
+		Clock::time_point requestTime;
+		uint32_t pendingNodes;
+		uint32_t cursorsSent;
+
+		std::vector<uint32_t> changesReceived; // Per area node
+		std::vector<uint32_t> cursorsReceived; // Per sending client
+		std::mt19937 random;
+};
+
+class LoadTest
+{
+	public:
+		explicit LoadTest(const Options& options);
+
+		int run();
+
+		// Called by the clients
+		asio::io_context& getContext() { return context; }
+		const Options& getOptions() const { return options; }
+
+		int32_t getAreaNode(int32_t ndx, int32_t ndy) const;
+		void getNodePosition(int32_t node, int32_t& ndx, int32_t& ndy) const;
+		int32_t getNodeCount() const { return options.area * options.area; }
+
+		void onJoined(double milliseconds);
+		void onNodesReceived(double milliseconds);
+		void onChangeSent(int32_t node);
+		void onChangeReceived(int32_t node, uint32_t sequence);
+		void onCursorSent(uint32_t client);
+		void onCursorReceived(uint32_t client, uint32_t sequence);
+		void onFailed(uint32_t client, const std::string& reason);
+		void checkPhase();
+
+	protected:
+		enum Phase {
+			PHASE_JOIN,
+			PHASE_NODES,
+			PHASE_CHANGES,
+			PHASE_CURSORS,
+			PHASE_DONE,
+		};
+
+		struct PhaseResult {
+			std::string name;
+			uint64_t packets = 0;
+			double cpu = -1; // Milliseconds
+		};
+
+		void startPhase(Phase phase);
+		void finishPhase();
+		void scheduleSend(uint32_t client, double rate, std::function<void(LoadClient&)> sendFunction);
+		void report() const;
+
+		Options options;
+		asio::io_context context;
+		asio::steady_timer phaseTimer;
+		std::vector<std::unique_ptr<LoadClient>> clients;
+		std::vector<std::unique_ptr<asio::steady_timer>> sendTimers;
+
+		Phase phase;
+		bool sending;
+		double phaseCpuStart;
+		uint64_t phasePackets;
+		uint64_t expectedBroadcasts;
+		uint64_t receivedBroadcasts;
+		uint32_t joinedClients;
+		uint32_t failedClients;
+
+		// A node is only ever changed by one client and a client's packets are
+		// handled in order, so the n-th broadcast of a node belongs to its n-th change
+		std::vector<std::vector<Clock::time_point>> changeTimes;
+		std::vector<std::vector<Clock::time_point>> cursorTimes;
+
+		std::vector<double> joinLatency;
+		std::vector<double> nodeLatency;
+		std::vector<double> changeLatency;
+		std::vector<double> cursorLatency;
+		std::vector<PhaseResult> results;
+};
+
+LoadClient::LoadClient(LoadTest& test, uint32_t index) :
+	test(test),
+	socket(test.getContext()),
+	index(index),
+	joined(false),
+	failed(false),
+	compression(false),
+	pendingNodes(0),
+	cursorsSent(0),
+	changesReceived(test.getNodeCount(), 0),
+	cursorsReceived(test.getOptions().clients, 0),
+	random(index)
+{
+	//
+}
+
+void LoadClient::connect(const asio::ip::tcp::endpoint& endpoint)
+{
+	connectTime = Clock::now();
+	socket.async_connect(endpoint, [this](const asio::error_code& error) {
+		if(error) {
+			fail(error.message());
+			return;
+		}
+
+		asio::error_code ignored;
+		socket.set_option(asio::ip::tcp::no_delay(true), ignored);
+
+		const Options& options = test.getOptions();
+		OutMessage message;
+		message.write<uint8_t>(PACKET_HELLO_FROM_CLIENT);
+		message.write<uint32_t>(__RME_VERSION_ID__);
+		message.write<uint32_t>(__LIVE_NET_VERSION__);
+		message.write<uint32_t>(0); // The server tells us its client version
+		message.writeString("loadtest-" + std::to_string(index));
+		message.writeString(options.password);
+		message.write<uint32_t>(options.compression ? LIVE_CAPABILITY_COMPRESSION : 0);
+		send(message);
+
+		receiveHeader();
+	});
+}
+
+void LoadClient::close()
+{
+	asio::error_code ignored;
+	socket.close(ignored);
+}
+
+void LoadClient::requestNodes()
+{
+	if(!joined) {
+		return;
+	}
+
+	OutMessage message;
+	message.write<uint8_t>(PACKET_REQUEST_NODES);
+	message.write<uint32_t>(test.getNodeCount());
+	for(int32_t node = 0; node < test.getNodeCount(); ++node) {
+		int32_t ndx, ndy;
+		test.getNodePosition(node, ndx, ndy);
+		message.write<uint32_t>((ndx << 18) | (ndy << 4) | (test.getOptions().z > 7 ? 1 : 0));
+	}
+
+	pendingNodes = test.getNodeCount();
+	requestTime = Clock::now();
+	send(message);
+}
+
+void LoadClient::sendChange()
+{
+	const Options& options = test.getOptions();
+
+	// Only the nodes this client owns, see LoadTest::changeTimes
+	std::vector<int32_t> nodes;
+	for(int32_t node = index; node < test.getNodeCount(); node += options.clients) {
+		nodes.push_back(node);
+	}
+	if(nodes.empty()) {
+		return;
+	}
+
+	const int32_t node = nodes[random() % nodes.size()];
+	int32_t ndx, ndy;
+	test.getNodePosition(node, ndx, ndy);
+
+	const uint16_t x = ndx * 4 + random() % 4;
+	const uint16_t y = ndy * 4 + random() % 4;
+	const uint8_t z = options.z;
+
+	// The bytes LiveClient::sendChanges writes for a tile with only a ground,
+	// starting right after the root node's NODE_START
+	std::string data;
+	auto addEscaped = [&data](const void* value, size_t size) {
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(value);
+		for(size_t i = 0; i < size; ++i) {
+			if(bytes[i] == NODE_START || bytes[i] == NODE_END || bytes[i] == ESCAPE_CHAR) {
+				data.push_back(static_cast<char>(ESCAPE_CHAR));
+			}
+			data.push_back(static_cast<char>(bytes[i]));
+		}
+	};
+	data.push_back(static_cast<char>(NODE_START));
+	data.push_back(static_cast<char>(OTBM_TILE));
+	addEscaped(&x, sizeof(x));
+	addEscaped(&y, sizeof(y));
+	addEscaped(&z, sizeof(z));
+	addEscaped(&OTBM_ATTR_ITEM, sizeof(OTBM_ATTR_ITEM));
+	addEscaped(&options.ground, sizeof(options.ground));
+	data.push_back(static_cast<char>(NODE_END));
+	data.push_back(static_cast<char>(NODE_END));
+
+	OutMessage message;
+	message.write<uint8_t>(PACKET_CHANGE_LIST);
+	message.writeString(data);
+
+	test.onChangeSent(node);
+	send(message);
+}
+
+void LoadClient::sendCursor()
+{
+	// The server replaces the id with its own, so the sender and sequence
+	// number travel in the position instead
+	OutMessage message;
+	message.write<uint8_t>(PACKET_CLIENT_UPDATE_CURSOR);
+	message.write<uint32_t>(0);
+	message.write<uint32_t>(0xFF0000FF); // Color
+	message.write<uint16_t>(index);
+	message.write<uint16_t>(cursorsSent++ & 0xFFFF);
+	message.write<uint8_t>(test.getOptions().z);
+
+	test.onCursorSent(index);
+	send(message);
+}
+
+void LoadClient::receiveHeader()
+{
+	readBuffer.resize(4);
+	asio::async_read(socket, asio::buffer(readBuffer.data(), 4), [this](const asio::error_code& error, size_t) {
+		if(error) {
+			fail(error.message());
+			return;
+		}
+
+		uint32_t packetSize;
+		memcpy(&packetSize, readBuffer.data(), 4);
+		receive(packetSize);
+	});
+}
+
+void LoadClient::receive(uint32_t packetSize)
+{
+	const bool compressed = (packetSize & CompressedFlag) != 0;
+	packetSize &= ~CompressedFlag;
+	if(packetSize > MaxPacketSize) {
+		fail("packet too large");
+		return;
+	}
+
+	readBuffer.resize(4 + packetSize);
+	asio::async_read(socket, asio::buffer(readBuffer.data() + 4, packetSize), [this, compressed](const asio::error_code& error, size_t) {
+		if(error) {
+			fail(error.message());
+			return;
+		}
+
+		if(compressed) {
+			uint32_t length = 0;
+			if(readBuffer.size() >= 8) {
+				memcpy(&length, &readBuffer[4], 4);
+			}
+
+			std::vector<uint8_t> inflated(length + 4);
+			uLongf inflatedLength = length;
+			if(length == 0 || length > MaxPacketSize || uncompress(&inflated[4], &inflatedLength, &readBuffer[8], readBuffer.size() - 8) != Z_OK || inflatedLength != length) {
+				fail("could not decompress packet");
+				return;
+			}
+			readBuffer.swap(inflated);
+		}
+
+		parsePacket();
+		if(!failed) {
+			receiveHeader();
+		}
+	});
+}
+
+void LoadClient::parsePacket()
+{
+	// The server sends one packet per message, so nothing after the fields
+	// read here needs to be understood
+	size_t position = 4;
+	auto read = [this, &position](void* value, size_t size) {
+		if(position + size > readBuffer.size()) {
+			memset(value, 0, size);
+			return;
+		}
+		memcpy(value, &readBuffer[position], size);
+		position += size;
+	};
+
+	uint8_t packetType;
+	read(&packetType, 1);
+	switch(packetType) {
+		case PACKET_ACCEPTED_CLIENT:
+		case PACKET_CHANGE_CLIENT_VERSION: {
+			OutMessage message;
+			message.write<uint8_t>(PACKET_READY_CLIENT);
+			send(message);
+			break;
+		}
+		case PACKET_HELLO_FROM_SERVER: {
+			uint16_t nameLength;
+			read(&nameLength, 2);
+			position += nameLength + 4; // Name, width and height
+			uint32_t capabilities;
+			read(&capabilities, 4);
+			compression = (capabilities & LIVE_CAPABILITY_COMPRESSION) != 0;
+
+			joined = true;
+			test.onJoined(millisecondsSince(connectTime));
+			break;
+		}
+		case PACKET_KICK: {
+			uint16_t length;
+			read(&length, 2);
+			std::string reason;
+			if(position + length <= readBuffer.size()) {
+				reason.assign(reinterpret_cast<const char*>(&readBuffer[position]), length);
+			}
+			fail("kicked: " + reason);
+			break;
+		}
+		case PACKET_NODE: {
+			uint32_t ind;
+			read(&ind, 4);
+			const int32_t node = test.getAreaNode(ind >> 18, (ind >> 4) & 0x3FFF);
+			if(node < 0) {
+				break;
+			}
+
+			if(pendingNodes > 0) {
+				if(--pendingNodes == 0) {
+					test.onNodesReceived(millisecondsSince(requestTime));
+				}
+			} else {
+				test.onChangeReceived(node, changesReceived[node]++);
+			}
+			break;
+		}
+		case PACKET_CURSOR_UPDATE: {
+			uint32_t id, color;
+			uint16_t sender, sequence;
+			read(&id, 4);
+			read(&color, 4);
+			read(&sender, 2);
+			read(&sequence, 2);
+			if(sender < cursorsReceived.size() && sequence == (cursorsReceived[sender] & 0xFFFF)) {
+				test.onCursorReceived(sender, cursorsReceived[sender]++);
+			}
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+void LoadClient::send(OutMessage& message)
+{
+	// Sent uncompressed, the server takes both
+	MessageBuffer buffer = message.finish();
+	asio::async_write(socket, asio::buffer(*buffer), [this, buffer](const asio::error_code& error, size_t) {
+		if(error) {
+			fail(error.message());
+		}
+	});
+}
+
+void LoadClient::fail(const std::string& reason)
+{
+	if(failed) {
+		return;
+	}
+
+	failed = true;
+	close();
+	test.onFailed(index, reason);
+}
+
+LoadTest::LoadTest(const Options& options) :
+	options(options),
+	context(),
+	phaseTimer(context),
+	phase(PHASE_JOIN),
+	sending(false),
+	phaseCpuStart(-1),
+	phasePackets(0),
+	expectedBroadcasts(0),
+	receivedBroadcasts(0),
+	joinedClients(0),
+	failedClients(0),
+	changeTimes(options.area * options.area),
+	cursorTimes(options.clients)
+{
+	//
+}
+
+int LoadTest::run()
+{
+	asio::ip::tcp::resolver resolver(context);
+	asio::error_code error;
+	auto endpoints = resolver.resolve(options.host, std::to_string(options.port), error);
+	if(error || endpoints.empty()) {
+		std::cerr << "Could not resolve " << options.host << ": " << error.message() << std::endl;
+		return 1;
+	}
+
+	for(int32_t index = 0; index < options.clients; ++index) {
+		clients.emplace_back(new LoadClient(*this, index));
+		sendTimers.emplace_back(new asio::steady_timer(context));
+	}
+
+	startPhase(PHASE_JOIN);
+	for(auto& client : clients) {
+		client->connect(*endpoints.begin());
+	}
+
+	context.run();
+	report();
+	return joinedClients == 0 ? 1 : 0;
+}
+
+int32_t LoadTest::getAreaNode(int32_t ndx, int32_t ndy) const
+{
+	ndx -= options.x >> 2;
+	ndy -= options.y >> 2;
+	if(ndx < 0 || ndy < 0 || ndx >= options.area || ndy >= options.area) {
+		return -1;
+	}
+	return ndy * options.area + ndx;
+}
+
+void LoadTest::getNodePosition(int32_t node, int32_t& ndx, int32_t& ndy) const
+{
+	ndx = (options.x >> 2) + node % options.area;
+	ndy = (options.y >> 2) + node / options.area;
+}
+
+void LoadTest::onJoined(double milliseconds)
+{
+	++joinedClients;
+	phasePackets += 2; // Hello and ready
+	joinLatency.push_back(milliseconds);
+	checkPhase();
+}
+
+void LoadTest::onNodesReceived(double milliseconds)
+{
+	nodeLatency.push_back(milliseconds);
+	checkPhase();
+}
+
+void LoadTest::onChangeSent(int32_t node)
+{
+	changeTimes[node].push_back(Clock::now());
+	expectedBroadcasts += joinedClients - 1;
+	++phasePackets;
+}
+
+void LoadTest::onChangeReceived(int32_t node, uint32_t sequence)
+{
+	if(sequence < changeTimes[node].size()) {
+		changeLatency.push_back(millisecondsSince(changeTimes[node][sequence]));
+	}
+	++receivedBroadcasts;
+	checkPhase();
+}
+
+void LoadTest::onCursorSent(uint32_t client)
+{
+	cursorTimes[client].push_back(Clock::now());
+	expectedBroadcasts += joinedClients - 1;
+	++phasePackets;
+}
+
+void LoadTest::onCursorReceived(uint32_t client, uint32_t sequence)
+{
+	if(sequence < cursorTimes[client].size()) {
+		cursorLatency.push_back(millisecondsSince(cursorTimes[client][sequence]));
+	}
+	++receivedBroadcasts;
+	checkPhase();
+}
+
+void LoadTest::onFailed(uint32_t client, const std::string& reason)
+{
+	std::cerr << "Client " << client << ": " << reason << std::endl;
+	if(clients[client]->isJoined()) {
+		--joinedClients;
+	}
+	++failedClients;
+	checkPhase();
+}
+
+void LoadTest::checkPhase()
+{
+	switch(phase) {
+		case PHASE_JOIN:
+			if(joinedClients + failedClients == clients.size()) {
+				finishPhase();
+			}
+			break;
+		case PHASE_NODES:
+			if(std::all_of(clients.begin(), clients.end(), [](const std::unique_ptr<LoadClient>& client) { return client->isDone(); })) {
+				finishPhase();
+			}
+			break;
+		case PHASE_CHANGES:
+		case PHASE_CURSORS:
+			// Only once sending stopped and everything sent has come back
+			if(!sending && receivedBroadcasts >= expectedBroadcasts) {
+				finishPhase();
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+void LoadTest::startPhase(Phase newPhase)
+{
+	static const char* names[] = { "join", "nodes", "changes", "cursors" };
+
+	phase = newPhase;
+	if(phase == PHASE_DONE || (phase != PHASE_JOIN && joinedClients == 0)) {
+		phase = PHASE_DONE;
+		for(auto& client : clients) {
+			client->close();
+		}
+		context.stop();
+		return;
+	}
+
+	PhaseResult result;
+	result.name = names[phase];
+	results.push_back(result);
+
+	phasePackets = 0;
+	expectedBroadcasts = 0;
+	receivedBroadcasts = 0;
+	phaseCpuStart = getProcessCpuTime(options.serverPid);
+	std::cout << "Phase " << result.name << "..." << std::endl;
+
+	switch(phase) {
+		case PHASE_NODES:
+			for(auto& client : clients) {
+				client->requestNodes();
+			}
+			phasePackets = joinedClients;
+			checkPhase();
+			break;
+		case PHASE_CHANGES:
+		case PHASE_CURSORS: {
+			sending = true;
+			const bool changes = phase == PHASE_CHANGES;
+			for(uint32_t index = 0; index < clients.size(); ++index) {
+				if(clients[index]->isJoined()) {
+					scheduleSend(index, changes ? options.changeRate : options.cursorRate,
+						changes ? std::function<void(LoadClient&)>(&LoadClient::sendChange) : std::function<void(LoadClient&)>(&LoadClient::sendCursor));
+				}
+			}
+
+			phaseTimer.expires_after(std::chrono::seconds(options.duration));
+			phaseTimer.async_wait([this](const asio::error_code& error) {
+				if(error) {
+					return;
+				}
+				sending = false;
+				for(auto& timer : sendTimers) {
+					timer->cancel();
+				}
+
+				// Give up on broadcasts that never arrive
+				phaseTimer.expires_after(std::chrono::seconds(5));
+				phaseTimer.async_wait([this](const asio::error_code& error) {
+					if(!error) {
+						std::cerr << "Gave up waiting for " << (expectedBroadcasts - receivedBroadcasts) << " broadcasts." << std::endl;
+						finishPhase();
+					}
+				});
+				checkPhase();
+			});
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+void LoadTest::finishPhase()
+{
+	phaseTimer.cancel();
+
+	PhaseResult& result = results.back();
+	result.packets = phasePackets;
+	const double cpuEnd = getProcessCpuTime(options.serverPid);
+	if(phaseCpuStart >= 0 && cpuEnd >= 0) {
+		result.cpu = cpuEnd - phaseCpuStart;
+	}
+
+	// Let the handlers that finished this phase return before the next starts
+	const Phase next = static_cast<Phase>(phase + 1);
+	phase = PHASE_DONE;
+	asio::post(context, [this, next]() { startPhase(next); });
+}
+
+void LoadTest::scheduleSend(uint32_t client, double rate, std::function<void(LoadClient&)> sendFunction)
+{
+	if(!sending || rate <= 0) {
+		return;
+	}
+
+	asio::steady_timer& timer = *sendTimers[client];
+	timer.expires_after(std::chrono::microseconds(static_cast<int64_t>(1000000 / rate)));
+	timer.async_wait([this, client, rate, sendFunction](const asio::error_code& error) {
+		if(error || !sending || !clients[client]->isJoined()) {
+			return;
+		}
+		sendFunction(*clients[client]);
+		scheduleSend(client, rate, sendFunction);
+	});
+}
+
+void LoadTest::report() const
+{
+	auto printLatency = [](const char* name, const std::vector<double>& samples) {
+		const Percentiles percentiles = getPercentiles(samples);
+		std::cout << std::left << std::setw(20) << name << std::right
+			<< std::setw(10) << percentiles.count
+			<< std::setw(12) << percentiles.p50
+			<< std::setw(12) << percentiles.p99
+			<< std::setw(12) << percentiles.max << std::endl;
+	};
+
+	std::cout << std::fixed << std::setprecision(2) << std::endl;
+	std::cout << joinedClients << " of " << clients.size() << " clients joined." << std::endl << std::endl;
+
+	std::cout << std::left << std::setw(20) << "Latency (ms)" << std::right
+		<< std::setw(10) << "samples" << std::setw(12) << "p50" << std::setw(12) << "p99" << std::setw(12) << "max" << std::endl;
+	printLatency("join", joinLatency);
+	printLatency("node request", nodeLatency);
+	printLatency("change broadcast", changeLatency);
+	printLatency("cursor broadcast", cursorLatency);
+	std::cout << std::endl;
+
+	std::cout << std::left << std::setw(20) << "Server CPU" << std::right
+		<< std::setw(10) << "packets" << std::setw(12) << "total ms" << std::setw(12) << "us/packet" << std::endl;
+	for(const PhaseResult& result : results) {
+		std::cout << std::left << std::setw(20) << result.name << std::right << std::setw(10) << result.packets;
+		if(result.cpu < 0) {
+			std::cout << std::setw(12) << "-" << std::setw(12) << "-";
+		} else {
+			std::cout << std::setw(12) << result.cpu << std::setw(12) << (result.packets ? result.cpu * 1000 / result.packets : 0.0);
+		}
+		std::cout << std::endl;
+	}
+
+	if(options.serverPid <= 0) {
+		std::cout << "Pass --server-pid to measure the server's CPU time." << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	for(int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		const std::string value = i + 1 < argc ? argv[i + 1] : "";
+		if(arg == "--host") {
+			options.host = value;
+		} else if(arg == "--port") {
+			options.port = std::stoi(value);
+		} else if(arg == "--password") {
+			options.password = value;
+		} else if(arg == "--clients") {
+			options.clients = std::stoi(value);
+		} else if(arg == "--duration") {
+			options.duration = std::stoi(value);
+		} else if(arg == "--change-rate") {
+			options.changeRate = std::stod(value);
+		} else if(arg == "--cursor-rate") {
+			options.cursorRate = std::stod(value);
+		} else if(arg == "--area") {
+			options.area = std::stoi(value);
+		} else if(arg == "--position") {
+			char separator;
+			std::istringstream(value) >> options.x >> separator >> options.y >> separator >> options.z;
+		} else if(arg == "--ground") {
+			options.ground = std::stoi(value);
+		} else if(arg == "--server-pid") {
+			options.serverPid = std::stoi(value);
+		} else if(arg == "--no-compression") {
+			options.compression = false;
+			continue;
+		} else {
+			std::cout << "Usage: " << argv[0] << " [options]" << std::endl
+				<< "  --host H            server address (127.0.0.1)" << std::endl
+				<< "  --port N            server port (31313)" << std::endl
+				<< "  --password P        server password" << std::endl
+				<< "  --clients N         simulated clients, a server takes at most 64 (8)" << std::endl
+				<< "  --duration S        seconds of changes and of cursor updates (10)" << std::endl
+				<< "  --change-rate R     change lists per client and second (5)" << std::endl
+				<< "  --cursor-rate R     cursor updates per client and second (20)" << std::endl
+				<< "  --area N            nodes along each side of the shared area (8)" << std::endl
+				<< "  --position X,Y,Z    top left corner of the area (1024,1024,7)" << std::endl
+				<< "  --ground ID         item id the changed tiles get as ground (4526)" << std::endl
+				<< "  --server-pid PID    server process to sample the CPU time of (Linux)" << std::endl
+				<< "  --no-compression    do not ask the server for compression" << std::endl;
+			return arg == "--help" ? 0 : 1;
+		}
+		++i;
+	}
+
+	if(options.clients < 1 || options.area < 1 || options.duration < 1) {
+		std::cerr << "--clients, --area and --duration must be at least 1." << std::endl;
+		return 1;
+	}
+	if(options.area * options.area < options.clients) {
+		std::cerr << "Every client needs a node of its own, use a larger --area." << std::endl;
+		return 1;
+	}
+
+	LoadTest test(options);
+	return test.run();
+}